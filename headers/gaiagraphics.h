@@ -68,6 +68,32 @@ extern "C"
 #define GGRAPH_TIFF_COMPRESSION_DEFLATE		3005
 #define GGRAPH_TIFF_COMPRESSION_JPEG		3006
 
+#define GGRAPH_ADAM7_COMPRESSION_NONE		3101
+#define GGRAPH_ADAM7_COMPRESSION_DEFLATE	3102
+#define GGRAPH_ADAM7_COMPRESSION_DEFLATE_FAST	3103
+
+#define GGRAPH_JPEG_DECODE_ACCURATE	3201
+#define GGRAPH_JPEG_DECODE_FAST		3202
+
+#define GGRAPH_JPEG_SUBSAMPLING_420	3211
+#define GGRAPH_JPEG_SUBSAMPLING_422	3212
+#define GGRAPH_JPEG_SUBSAMPLING_444	3213
+
+#define GGRAPH_PNG_PRESET_NONE		3321
+#define GGRAPH_PNG_PRESET_FAST		3322
+
+#define GGRAPH_PNG_FILTER_ADAPTIVE	3301
+#define GGRAPH_PNG_FILTER_NONE		3302
+#define GGRAPH_PNG_FILTER_SUB		3303
+#define GGRAPH_PNG_FILTER_UP		3304
+#define GGRAPH_PNG_FILTER_AVERAGE	3305
+#define GGRAPH_PNG_FILTER_PAETH		3306
+
+#define GGRAPH_PNG_STRATEGY_DEFAULT	3311
+#define GGRAPH_PNG_STRATEGY_FILTERED	3312
+#define GGRAPH_PNG_STRATEGY_RLE		3313
+#define GGRAPH_PNG_STRATEGY_HUFFMAN_ONLY	3314
+
 #define GGRAPH_IMAGE_UNKNOWN	-4000
 #define GGRAPH_IMAGE_GIF	4001
 #define GGRAPH_IMAGE_PNG	4002
@@ -123,6 +149,8 @@ extern "C"
 #define GGRAPH_INVALID_PAINT_BRUSH		-24
 #define GGRAPH_INVALID_PAINT_FONT		-25
 #define GGRAPH_INVALID_SVG			-26
+#define GGRAPH_INVALID_THREAD_POOL		-27
+#define GGRAPH_INVALID_TILE_CACHE		-28
 
 #define GGRAPH_TRUE	-1
 #define GGRAPH_FALSE	-2
@@ -330,8 +358,24 @@ extern "C"
     GGRAPH_DECLARE int gGraphImageColorSpaceOptimize (const void *img);
     GGRAPH_DECLARE int gGraphImageResampleAsRgb (const void *img);
     GGRAPH_DECLARE int gGraphImageResampleAsMonochrome (const void *img);
+    GGRAPH_DECLARE int gGraphImageResampleAsMonochromeDithered (const void
+								*img);
     GGRAPH_DECLARE int gGraphImageResampleAsPalette (const void *img,
 						     int num_colors);
+    GGRAPH_DECLARE int gGraphImageResampleAsPaletteDithered (const void *img,
+							     int num_colors);
+    GGRAPH_DECLARE int gGraphImageResampleAsPaletteByThreads (const void
+							      *img,
+							      int num_colors,
+							      int sampling,
+							      int num_threads);
+    GGRAPH_DECLARE int gGraphImageResampleAsPaletteByThreadPool (const void
+								 *img,
+								 int
+								 num_colors,
+								 int sampling,
+								 const void
+								 *thread_pool);
     GGRAPH_DECLARE int gGraphImageResampleAsGrayscale (const void *img);
     GGRAPH_DECLARE int gGraphImageResampleAsPhotographic (const void *img);
     GGRAPH_DECLARE int gGraphImageResampleAsGridInt16 (const void *img);
@@ -366,14 +410,64 @@ extern "C"
     GGRAPH_DECLARE int gGraphImageResizeNormal (const void *orig,
 						const void **dest, int width,
 						int height);
+    GGRAPH_DECLARE int gGraphImageResizeNormalByThreads (const void *orig,
+							 const void **dest,
+							 int width, int height,
+							 int num_threads);
+    GGRAPH_DECLARE int gGraphImageResizeNormalByThreadPool (const void
+							    *orig,
+							    const void **dest,
+							    int width,
+							    int height,
+							    const void
+							    *thread_pool);
     GGRAPH_DECLARE int gGraphImageResizeHighQuality (const void *orig,
 						     const void **dest,
 						     int width, int height);
+    GGRAPH_DECLARE int gGraphImageResizeHighQualityByThreads (const void
+							      *orig,
+							      const void
+							      **dest,
+							      int width,
+							      int height,
+							      int num_threads);
+    GGRAPH_DECLARE int gGraphImageResizeHighQualityByThreadPool (const void
+								 *orig,
+								 const void
+								 **dest,
+								 int width,
+								 int height,
+								 const void
+								 *thread_pool);
     GGRAPH_DECLARE int gGraphImageResizeToResolution (const void *orig,
 						      const void **dest,
 						      double pixel_x_size,
 						      double pixel_y_size,
 						      int *width, int *height);
+    GGRAPH_DECLARE int gGraphImageResizeToResolutionByThreads (const void
+							       *orig,
+							       const void
+							       **dest,
+							       double
+							       pixel_x_size,
+							       double
+							       pixel_y_size,
+							       int *width,
+							       int *height,
+							       int
+							       num_threads);
+    GGRAPH_DECLARE int gGraphImageResizeToResolutionByThreadPool (const void
+								  *orig,
+								  const void
+								  **dest,
+								  double
+								  pixel_x_size,
+								  double
+								  pixel_y_size,
+								  int *width,
+								  int *height,
+								  const void
+								  *thread_pool);
     GGRAPH_DECLARE int gGraphImageSubSet (const void *orig, const void **dest,
 					  int upper_left_x, int upper_left_y,
 					  int width, int height);
@@ -433,6 +527,20 @@ extern "C"
 					      int mem_buf_size, int image_type,
 					      const void **image_handle,
 					      int scale);
+    GGRAPH_DECLARE int gGraphImageFromFileEx (const char *path,
+					      int image_type,
+					      const void **image_handle,
+					      int scale, int decode_mode);
+    GGRAPH_DECLARE int gGraphImageFromMemBufEx (const void *mem_buf,
+						int mem_buf_size,
+						int image_type,
+						const void **image_handle,
+						int scale, int decode_mode);
+    GGRAPH_DECLARE int gGraphImageFromFileWindow (const char *path,
+						  int image_type, int x,
+						  int y, int width,
+						  int height,
+						  const void **image_handle);
 
 /*
 / utility functions returning image infos
@@ -464,10 +572,24 @@ extern "C"
 */
     GGRAPH_DECLARE int gGraphImageToJpegFile (const void *img, const char *path,
 					      int quality);
+    GGRAPH_DECLARE int gGraphImageToJpegFileEx (const void *img,
+						const char *path, int quality,
+						int progressive,
+						int optimize_coding,
+						int subsampling,
+						int restart_interval);
     GGRAPH_DECLARE int gGraphImageToPngFile (const void *img, const char *path,
 					     int compression_level,
 					     int quantization_factor,
 					     int interlaced);
+    GGRAPH_DECLARE int gGraphImageToPngFileEx (const void *img,
+					       const char *path,
+					       int compression_level,
+					       int quantization_factor,
+					       int interlaced, int preset,
+					       int filter, int strategy,
+					       int window_bits,
+					       int mem_level);
     GGRAPH_DECLARE int gGraphImageToGifFile (const void *img, const char *path);
 
 /*
@@ -476,12 +598,31 @@ extern "C"
     GGRAPH_DECLARE int gGraphImageToJpegMemBuf (const void *img, void **mem_buf,
 						int *mem_buf_size,
 						int jpeg_quality);
+    GGRAPH_DECLARE int gGraphImageToJpegMemBufEx (const void *img,
+						  void **mem_buf,
+						  int *mem_buf_size,
+						  int jpeg_quality,
+						  int progressive,
+						  int optimize_coding,
+						  int subsampling,
+						  int restart_interval);
     GGRAPH_DECLARE int gGraphImageToPngMemBuf (const void *img, void **mem_buf,
 					       int *mem_buf_size,
 					       int compression_level,
 					       int quantization_factor,
 					       int interlaced,
 					       int is_transparent);
+    GGRAPH_DECLARE int gGraphImageToPngMemBufEx (const void *img,
+						 void **mem_buf,
+						 int *mem_buf_size,
+						 int compression_level,
+						 int quantization_factor,
+						 int interlaced,
+						 int is_transparent,
+						 int preset, int filter,
+						 int strategy,
+						 int window_bits,
+						 int mem_level);
     GGRAPH_DECLARE int gGraphImageToGifMemBuf (const void *img, void **mem_buf,
 					       int *mem_buf_size,
 					       int is_transparent);
@@ -492,11 +633,24 @@ extern "C"
     GGRAPH_DECLARE int gGraphImageToAdam7 (const void *img, void *mem_bufs[7],
 					   int mem_buf_sizes[7], void **palette,
 					   int *palette_size);
+    GGRAPH_DECLARE int gGraphImageToAdam7Compressed (const void *img,
+						     void *mem_bufs[7],
+						     int mem_buf_sizes[7],
+						     void **palette,
+						     int *palette_size,
+						     int compression);
     GGRAPH_DECLARE int gGraphImageFromAdam7 (void *mem_bufs[7],
 					     int mem_buf_sizes[7],
 					     void *palette, int palette_size,
 					     const void **image_handle,
 					     int scale);
+    GGRAPH_DECLARE int gGraphAdam7PassesForScale (int scale, int *num_passes);
+    GGRAPH_DECLARE int gGraphImageFromAdam7Passes (void *mem_bufs[],
+						   int mem_buf_sizes[],
+						   int num_passes,
+						   void *palette,
+						   int palette_size,
+						   const void **image_handle);
     GGRAPH_DECLARE int gGraphImageToMonochrome (const void *img, void **mem_buf,
 						int *mem_buf_size);
     GGRAPH_DECLARE int gGraphImageFromMonochrome (const void *mem_buf,
@@ -536,6 +690,31 @@ extern "C"
     GGRAPH_DECLARE int gGraphImageFromFileByStrips (const char *path,
 						    int image_type,
 						    const void **strip_handle);
+    GGRAPH_DECLARE int gGraphImageFromFileByStripsScaled (const char *path,
+							  int image_type,
+							  int scale,
+							  const void
+							  **strip_handle);
+    GGRAPH_DECLARE int gGraphImageFromFileByStripsEx (const char *path,
+						      int image_type,
+						      int scale,
+						      int decode_mode,
+						      const void
+						      **strip_handle);
+    GGRAPH_DECLARE int gGraphImageResizeByStrips (const void
+						  *in_strip_handle, int width,
+						  int height,
+						  const void **strip_handle);
+    GGRAPH_DECLARE int gGraphImageResizeToResolutionByStrips (const void
+							      *in_strip_handle,
+							      double
+							      pixel_x_size,
+							      double
+							      pixel_y_size,
+							      int *width,
+							      int *height,
+							      const void
+							      **strip_handle);
     GGRAPH_DECLARE int gGraphReadNextStrip (const void *strip_handle,
 					    int *progress);
 
@@ -544,6 +723,16 @@ extern "C"
 						      int width, int height,
 						      int color_model,
 						      int quality);
+    GGRAPH_DECLARE int gGraphImageToJpegFileByStripsEx (const void
+							**strip_handle,
+							const char *path,
+							int width, int height,
+							int color_model,
+							int quality,
+							int progressive,
+							int optimize_coding,
+							int subsampling,
+							int restart_interval);
     GGRAPH_DECLARE int gGraphImageToPngFileByStrips (const void **strip_handle,
 						     const char *path,
 						     int width, int height,
@@ -555,6 +744,23 @@ extern "C"
 						     unsigned char *blue,
 						     int compression_level,
 						     int quantization_factor);
+    GGRAPH_DECLARE int gGraphImageToPngFileByStripsEx (const void
+						       **strip_handle,
+						       const char *path,
+						       int width, int height,
+						       int color_model,
+						       int bits_per_sample,
+						       int num_palette,
+						       unsigned char *red,
+						       unsigned char *green,
+						       unsigned char *blue,
+						       int compression_level,
+						       int quantization_factor,
+						       int preset,
+						       int filter,
+						       int strategy,
+						       int window_bits,
+						       int mem_level);
     GGRAPH_DECLARE int gGraphImageToTiffFileByStrips (const void **strip_handle,
 						      const char *path,
 						      int width, int height,
@@ -593,6 +799,17 @@ extern "C"
 							 double upper_left_y,
 							 double pixel_x_size,
 							 double pixel_y_size);
+    GGRAPH_DECLARE int gGraphStripImageSetTiffOverviews (const void
+							 *strip_handle,
+							 int num_levels,
+							 double no_data_value);
+    GGRAPH_DECLARE int gGraphStripImageSetTiffThreads (const void
+						       *strip_handle,
+						       int num_threads);
+    GGRAPH_DECLARE int gGraphStripImageSetTiffThreadPool (const void
+							  *strip_handle,
+							  const void
+							  *thread_pool);
     GGRAPH_DECLARE int gGraphImageToBinHdrFileByStrips (const void
 							**strip_handle,
 							const char *path,
@@ -642,6 +859,10 @@ extern "C"
     GGRAPH_DECLARE int gGraphStripImageCopyPixels (const void *in_strip_handle,
 						   const void
 						   *out_strip_handle);
+    GGRAPH_DECLARE int gGraphStripImageCopyPixelsDithered (const void
+							   *in_strip_handle,
+							   const void
+							   *out_strip_handle);
     GGRAPH_DECLARE int gGraphStripImageRenderGridPixels (const void
 							 *in_strip_handle,
 							 const void
@@ -649,6 +870,18 @@ extern "C"
 							 const void
 							 *color_map_handle,
 							 int num_threads);
+    GGRAPH_DECLARE int gGraphStripImageRenderGridPixelsByThreadPool (const
+									  void
+									  *in_strip_handle,
+									  const
+									  void
+									  *out_strip_handle,
+									  const
+									  void
+									  *color_map_handle,
+									  const
+									  void
+									  *thread_pool);
     GGRAPH_DECLARE int gGraphStripImageSubSetPixels (const void
 						     *in_strip_handle,
 						     const void
@@ -740,6 +973,12 @@ extern "C"
 						       *triple_row_handle,
 						       int num_threads,
 						       int *out_row_ready);
+    GGRAPH_DECLARE int gGraphShadedReliefRenderPixelsByThreadPool (const void
+									*triple_row_handle,
+									const void
+									*thread_pool,
+									int
+									*out_row_ready);
     GGRAPH_DECLARE int gGraphStripImageGetShadedReliefScanline (const void
 								*in_img_handle,
 								int row_index,
@@ -761,6 +1000,20 @@ extern "C"
 					int width, int num_rows,
 					gGraphLandsatRecalibrationPtr params,
 					int num_threads);
+    GGRAPH_DECLARE int gGraphLandsatRGBByThreadPool (const void *img_red,
+						     const void *img_green,
+						     const void *img_blue,
+						     const void *img_rgb,
+						     int width, int num_rows,
+						     gGraphLandsatRecalibrationPtr
+						     params,
+						     const void *thread_pool);
+    GGRAPH_DECLARE int gGraphLandsatBWByThreadPool (const void *img_in,
+						    const void *img_out,
+						    int width, int num_rows,
+						    gGraphLandsatRecalibrationPtr
+						    params,
+						    const void *thread_pool);
     GGRAPH_DECLARE int gGraphGetLandsatSceneExtent (const void *img_in,
 						    int base_row, double *top_x,
 						    double *top_y,
@@ -789,6 +1042,47 @@ extern "C"
 						  int start_line,
 						  const void **img_out);
 
+/*
+/ reusable worker threads
+/ a Thread Pool can be shared by any multithreaded method
+/ supporting the ...ByThreadPool() interface
+*/
+    GGRAPH_DECLARE int gGraphCreateThreadPool (int num_threads,
+					       const void **thread_pool);
+    GGRAPH_DECLARE void gGraphDestroyThreadPool (const void *thread_pool);
+    GGRAPH_DECLARE int gGraphGetThreadPoolSize (const void *thread_pool,
+						int *num_threads);
+
+/*
+/ uniform images [single color, fully transparent] detection
+/ a Tile Cache keeps the encoded uniform tiles, so to skip
+/ encoding them over and over again
+*/
+    GGRAPH_DECLARE int gGraphImageIsUniform (const void *img,
+					     int *is_uniform,
+					     int *is_transparent,
+					     unsigned char *red,
+					     unsigned char *green,
+					     unsigned char *blue,
+					     unsigned char *alpha);
+    GGRAPH_DECLARE int gGraphCreateTileCache (int max_entries,
+					      const void **tile_cache);
+    GGRAPH_DECLARE void gGraphDestroyTileCache (const void *tile_cache);
+    GGRAPH_DECLARE int gGraphImageToPngMemBufCached (const void *img,
+						     void **mem_buf,
+						     int *mem_buf_size,
+						     int compression_level,
+						     int quantization_factor,
+						     int interlaced,
+						     int is_transparent,
+						     const void *tile_cache);
+    GGRAPH_DECLARE int gGraphImageToJpegMemBufCached (const void *img,
+						      void **mem_buf,
+						      int *mem_buf_size,
+						      int jpeg_quality,
+						      const void
+						      *tile_cache);
+
 /* SVG images */
     GGRAPH_DECLARE int gGraphCreateSVG (const unsigned char *svg_document,
 					int svg_bytes, void **svg_handle);
@@ -59,6 +59,24 @@
 #define GG_PIXEL_PALETTE	207
 #define GG_PIXEL_GRID		208
 
+#define GG_MAX_THREADS		64
+
+/* compiled Color Map lookup tables */
+#define GG_COLOR_MAP_INT16_MIN		-32768
+#define GG_COLOR_MAP_INT16_MAX		65535
+#define GG_COLOR_MAP_BUCKETS		4096
+
+/* inverse colormap [palette matching] */
+#define GG_PALETTE_HASH_SIZE		1024
+#define GG_PALETTE_CUBE_SHIFT		3
+#define GG_PALETTE_CUBE_CELLS		32768
+
+/* max number of TIFF Overview levels */
+#define GG_TIFF_MAX_OVERVIEWS		16
+
+/* pseudo-codec: a Strip Image resampled on the fly */
+#define GG_STRIP_RESIZER		4900
+
 #define GG_TARGET_IS_MEMORY	2001
 #define GG_TARGET_IS_FILE	2002
 
@@ -68,6 +86,8 @@
 #define GG_COLOR_RULE_MAGIC_SIGNATURE		23713
 #define GG_COLOR_MAP_MAGIC_SIGNATURE		27317
 #define GG_SHADED_RELIEF_3ROWS_MAGIC_SIGNATURE	18573
+#define GG_THREAD_POOL_MAGIC_SIGNATURE		29341
+#define GG_TILE_CACHE_MAGIC_SIGNATURE		31247
 
 #define GG_GRAPHICS_CONTEXT_MAGIC_SIGNATURE	1314
 #define GG_GRAPHICS_SVG_CONTEXT_MAGIC_SIGNATURE	1334
@@ -208,6 +228,11 @@
 #define GG_ADAM7_5_DOUBLE_END		3816
 #define GG_ADAM7_6_DOUBLE_START		3807
 #define GG_ADAM7_6_DOUBLE_END		3817
+#define GG_ADAM7_COMPRESSED_START	3951
+#define GG_ADAM7_COMPRESSED_END		3961
+
+/* ADAM7 compressed payloads */
+#define GG_ADAM7_CODEC_DEFLATE	1
 
 /* SVG constants */
 #define GG_SVG_UNKNOWN		0
@@ -285,6 +310,57 @@ typedef struct gaia_graphics_image_infos
 } gGraphImageInfos;
 typedef gGraphImageInfos *gGraphImageInfosPtr;
 
+typedef struct gaia_graphics_palette_cache
+{
+/* an inverse colormap supporting fast palette matching */
+    int max_palette;
+    int palette_version;	/* the palette version being mirrored */
+    unsigned char red[256];
+    unsigned char green[256];
+    unsigned char blue[256];
+    short hash[GG_PALETTE_HASH_SIZE];	/* exact matches: index + 1 */
+    int *cells;			/* nearest color candidates: offset + 1 */
+    unsigned char *candidates;
+    int candidates_size;
+    int candidates_used;
+} gGraphPaletteCache;
+typedef gGraphPaletteCache *gGraphPaletteCachePtr;
+
+typedef struct gaia_graphics_dither
+{
+/* Floyd-Steinberg error diffusion state: just two rows of errors */
+    int width;
+    int channels;
+    int row;			/* odd rows are scanned right-to-left */
+    unsigned char *pixels;	/* the next input row [RGB or GRAYSCALE] */
+    int *this_errors;		/* errors x 16 for the current row */
+    int *next_errors;		/* errors x 16 for the following row */
+} gGraphDither;
+typedef gGraphDither *gGraphDitherPtr;
+
+typedef struct gaia_graphics_jpeg_options
+{
+/* JPEG compression options */
+    int quality;		/* negative: the libjpeg default */
+    int progressive;
+    int optimize_coding;	/* optimized Huffman tables */
+    int subsampling;		/* GGRAPH_JPEG_SUBSAMPLING_xxx */
+    int restart_interval;	/* in MCU rows, zero: none */
+} gGraphJpegOptions;
+typedef gGraphJpegOptions *gGraphJpegOptionsPtr;
+
+typedef struct gaia_graphics_png_options
+{
+/* PNG compression options */
+    int preset;			/* GGRAPH_PNG_PRESET_xxx */
+    int compression_level;	/* zlib level: 0 to 9 */
+    int filter;			/* GGRAPH_PNG_FILTER_xxx */
+    int strategy;		/* GGRAPH_PNG_STRATEGY_xxx, zero: preset's */
+    int window_bits;		/* 8 to 15, zero: libpng's default */
+    int mem_level;		/* 1 to 9, zero: libpng's default */
+} gGraphPngOptions;
+typedef gGraphPngOptions *gGraphPngOptionsPtr;
+
 typedef struct gaia_graphics_image
 {
 /* a generic image  */
@@ -302,6 +378,8 @@ typedef struct gaia_graphics_image
     unsigned char palette_red[256];
     unsigned char palette_green[256];
     unsigned char palette_blue[256];
+    gGraphPaletteCachePtr palette_cache;
+    int palette_version;	/* bumped whenever the palette is edited */
     int is_transparent;
     unsigned char transparent_red;
     unsigned char transparent_green;
@@ -346,6 +424,9 @@ typedef struct gaia_graphics_strip_image
     unsigned char palette_red[256];
     unsigned char palette_green[256];
     unsigned char palette_blue[256];
+    gGraphPaletteCachePtr palette_cache;
+    int palette_version;	/* bumped whenever the palette is edited */
+    gGraphDitherPtr dither;
     int is_transparent;
     unsigned char transparent_red;
     unsigned char transparent_green;
@@ -421,6 +502,11 @@ typedef struct gaia_graphics_color_map
     struct gaia_graphics_color_map_entry *last;
     int num_entries;
     struct gaia_graphics_color_map_entry **array;
+    unsigned char *int16_lut;
+    int num_buckets;
+    double bucket_min;
+    double bucket_scale;
+    struct gaia_graphics_color_map_entry **buckets;
 } gGraphColorMap;
 typedef gGraphColorMap *gGraphColorMapPtr;
 
@@ -449,6 +535,14 @@ typedef struct shaded_relief_triple_row
 } gGraphShadedReliefTripleRow;
 typedef gGraphShadedReliefTripleRow *gGraphShadedReliefTripleRowPtr;
 
+/* a pool of reusable worker threads [opaque] */
+typedef struct gaia_graphics_thread_pool gGraphThreadPool;
+typedef gGraphThreadPool *gGraphThreadPoolPtr;
+
+/* a cache of encoded uniform tiles [opaque] */
+typedef struct gaia_graphics_tile_cache gGraphTileCache;
+typedef gGraphTileCache *gGraphTileCachePtr;
+
 struct gaia_graphics_pen
 {
 /* a struct wrapping a Cairo Pen */
@@ -847,6 +941,17 @@ gg_shaded_relief_triple_row_create (void);
 GGRAPH_PRIVATE void
 gg_shaded_relief_triple_row_destroy (gGraphShadedReliefTripleRowPtr triple_row);
 
+GGRAPH_PRIVATE gGraphThreadPoolPtr gg_thread_pool_create (int num_threads);
+GGRAPH_PRIVATE void gg_thread_pool_destroy (gGraphThreadPoolPtr pool);
+GGRAPH_PRIVATE int gg_thread_pool_size (gGraphThreadPoolPtr pool);
+GGRAPH_PRIVATE void gg_thread_pool_run (gGraphThreadPoolPtr pool,
+					int num_threads, void (*job) (void *),
+					void *args, int arg_size,
+					int num_jobs);
+GGRAPH_PRIVATE int gg_is_valid_thread_pool (const void *pool);
+
+GGRAPH_PRIVATE int gg_is_valid_tile_cache (const void *tile_cache);
+
 GGRAPH_PRIVATE gGraphImageInfosPtr gg_image_infos_create (int pixel_format,
 							  int width, int height,
 							  int bits_per_sample,
@@ -890,12 +995,42 @@ GGRAPH_PRIVATE void gg_png_codec_destroy (void *p);
 GGRAPH_PRIVATE void gg_jpeg_codec_destroy (void *p);
 GGRAPH_PRIVATE void gg_tiff_codec_destroy (void *p);
 GGRAPH_PRIVATE void gg_grid_codec_destroy (void *p);
+GGRAPH_PRIVATE void gg_grid_codec_restore_pixels (gGraphStripImagePtr img);
 GGRAPH_PRIVATE void gg_image_fill (const gGraphImagePtr img, unsigned char r,
 				   unsigned char g, unsigned char b,
 				   unsigned char alpha);
 GGRAPH_PRIVATE unsigned char gg_match_palette (const gGraphImagePtr img,
 					       unsigned char r, unsigned char g,
 					       unsigned char b);
+GGRAPH_PRIVATE unsigned char gg_palette_cache_match (gGraphPaletteCachePtr *
+						     cache, int *max_palette,
+						     int palette_version,
+						     unsigned char *red,
+						     unsigned char *green,
+						     unsigned char *blue,
+						     unsigned char r,
+						     unsigned char g,
+						     unsigned char b);
+GGRAPH_PRIVATE void gg_palette_cache_destroy (gGraphPaletteCachePtr cache);
+GGRAPH_PRIVATE gGraphPaletteCachePtr
+gg_palette_cache_prepare (gGraphPaletteCachePtr * cache, int max_palette,
+			  int palette_version, const unsigned char *red,
+			  const unsigned char *green,
+			  const unsigned char *blue);
+GGRAPH_PRIVATE unsigned char gg_palette_cache_nearest (gGraphPaletteCachePtr
+						       cache, unsigned char r,
+						       unsigned char g,
+						       unsigned char b);
+GGRAPH_PRIVATE gGraphDitherPtr gg_dither_create (int width, int channels);
+GGRAPH_PRIVATE void gg_dither_destroy (gGraphDitherPtr dither);
+GGRAPH_PRIVATE void gg_dither_reset (gGraphDitherPtr dither, int row);
+GGRAPH_PRIVATE void gg_dither_rgb_row (gGraphDitherPtr dither,
+				       unsigned char *p_out,
+				       gGraphPaletteCachePtr cache);
+GGRAPH_PRIVATE void gg_dither_gray_row (gGraphDitherPtr dither,
+					unsigned char *p_out,
+					unsigned char black,
+					unsigned char white);
 GGRAPH_PRIVATE int gg_set_image_transparent_color (unsigned char r,
 						   unsigned char g,
 						   unsigned char b);
@@ -907,33 +1042,59 @@ GGRAPH_PRIVATE int gg_is_image_palette256 (const gGraphImagePtr img);
 GGRAPH_PRIVATE void gg_make_thumbnail (const gGraphImagePtr thumbnail,
 				       const gGraphImagePtr image);
 GGRAPH_PRIVATE void gg_image_resize (const gGraphImagePtr dst,
-				     const gGraphImagePtr src);
+				     const gGraphImagePtr src,
+				     gGraphThreadPoolPtr pool,
+				     int num_threads);
 GGRAPH_PRIVATE void gg_make_grid_thumbnail (const gGraphImagePtr thumbnail,
 					    const gGraphImagePtr image);
 GGRAPH_PRIVATE void gg_grid_resize (const gGraphImagePtr dst,
-				    const gGraphImagePtr src);
+				    const gGraphImagePtr src,
+				    gGraphThreadPoolPtr pool, int num_threads);
+GGRAPH_PRIVATE int gg_image_resample (const gGraphImagePtr dst,
+				      const gGraphImagePtr src,
+				      gGraphThreadPoolPtr pool,
+				      int num_threads);
+GGRAPH_PRIVATE int gg_strip_image_resize (const gGraphStripImagePtr input,
+					  int width, int height,
+					  gGraphStripImagePtr * strip);
+GGRAPH_PRIVATE void gg_strip_resizer_destroy (void *p);
+GGRAPH_PRIVATE int gg_image_strip_read_from_resizer (gGraphStripImagePtr
+						     img, int *progress);
 GGRAPH_PRIVATE void gg_image_clone_georeferencing (const gGraphImagePtr dst,
 						   const gGraphImagePtr src);
 GGRAPH_PRIVATE void gg_image_sub_set (const gGraphImagePtr dst,
 				      const gGraphImagePtr src,
 				      int upper_left_x, int upper_left_y);
 
+GGRAPH_PRIVATE void gg_jpeg_default_options (gGraphJpegOptionsPtr options,
+					     int quality);
+GGRAPH_PRIVATE int gg_jpeg_check_options (const gGraphJpegOptionsPtr options);
 GGRAPH_PRIVATE int gg_image_to_jpeg (const gGraphImagePtr img, void **mem_buf,
 				     int *mem_buf_size, FILE * out,
-				     int dest_type, int quality);
+				     int dest_type,
+				     const gGraphJpegOptionsPtr options);
 GGRAPH_PRIVATE int gg_image_prepare_to_jpeg_by_strip (const gGraphStripImagePtr
 						      img, FILE * out,
-						      int quality);
+						      const
+						      gGraphJpegOptionsPtr
+						      options);
 GGRAPH_PRIVATE int gg_image_write_to_jpeg_by_strip (const gGraphStripImagePtr
 						    img, int *progress);
+GGRAPH_PRIVATE void gg_png_default_options (gGraphPngOptionsPtr options,
+					    int preset,
+					    int compression_level);
+GGRAPH_PRIVATE int gg_png_check_options (const gGraphPngOptionsPtr options);
 GGRAPH_PRIVATE int gg_image_to_png (const gGraphImagePtr img, void **mem_buf,
 				    int *mem_buf_size, FILE * out,
-				    int dest_type, int compression_level,
+				    int dest_type,
+				    const gGraphPngOptionsPtr options,
 				    int quantization_factor, int interlaced,
 				    int is_transparent);
 GGRAPH_PRIVATE int gg_image_prepare_to_png_by_strip (const gGraphStripImagePtr
 						     img, FILE * out,
-						     int compression_level,
+						     const
+						     gGraphPngOptionsPtr
+						     options,
 						     int quantization_factor);
 GGRAPH_PRIVATE int gg_image_write_to_png_by_strip (const gGraphStripImagePtr
 						   img, int *progress);
@@ -987,6 +1148,12 @@ GGRAPH_PRIVATE int gg_image_prepare_to_ascii_grid_by_strip (const
 							    img, FILE * out);
 GGRAPH_PRIVATE int gg_image_write_to_tiff_by_strip (const gGraphStripImagePtr
 						    img, int *progress);
+GGRAPH_PRIVATE int gg_tiff_set_overviews (const gGraphStripImagePtr img,
+					  int num_levels,
+					  double no_data_value);
+GGRAPH_PRIVATE int gg_tiff_set_threads (const gGraphStripImagePtr img,
+					gGraphThreadPoolPtr pool,
+					int num_threads);
 
 GGRAPH_PRIVATE int gg_convert_image_to_rgb (const gGraphImagePtr img);
 GGRAPH_PRIVATE int gg_convert_image_to_rgba (const gGraphImagePtr img);
@@ -996,8 +1163,11 @@ GGRAPH_PRIVATE int gg_convert_image_to_bgra (const gGraphImagePtr img);
 GGRAPH_PRIVATE int gg_convert_image_to_grayscale (const gGraphImagePtr img);
 GGRAPH_PRIVATE int gg_convert_image_to_palette (const gGraphImagePtr img);
 GGRAPH_PRIVATE int gg_image_resample_as_palette (const gGraphImagePtr img,
-						 int num_colors);
-GGRAPH_PRIVATE int gg_convert_image_to_monochrome (const gGraphImagePtr img);
+						 int num_colors, int sampling,
+						 gGraphThreadPoolPtr pool,
+						 int num_threads, int dither);
+GGRAPH_PRIVATE int gg_convert_image_to_monochrome (const gGraphImagePtr img,
+						   int dither);
 GGRAPH_PRIVATE int gg_convert_image_to_grid_int16 (const gGraphImagePtr img);
 GGRAPH_PRIVATE int gg_convert_image_to_grid_uint16 (const gGraphImagePtr img);
 GGRAPH_PRIVATE int gg_convert_image_to_grid_int32 (const gGraphImagePtr img);
@@ -1015,7 +1185,7 @@ GGRAPH_PRIVATE int gg_image_from_raw (int size, const void *data,
 GGRAPH_PRIVATE int gg_image_from_jpeg (int size, const void *data,
 				       int source_type,
 				       gGraphImagePtr * image_handle,
-				       int scale);
+				       int scale, int decode_mode);
 GGRAPH_PRIVATE int gg_image_from_png (int size, const void *data,
 				      int source_type,
 				      gGraphImagePtr * image_handle, int scale);
@@ -1024,20 +1194,27 @@ GGRAPH_PRIVATE int gg_image_from_gif (int size, const void *data,
 				      gGraphImagePtr * image_handle);
 GGRAPH_PRIVATE int gg_image_from_mem_tiff (int size, const void *data,
 					   gGraphImagePtr * image_handle);
+GGRAPH_PRIVATE int gg_image_window_from_tiff (const char *path,
+					      int is_geotiff, int x, int y,
+					      int width, int height,
+					      gGraphImagePtr * image_handle);
+GGRAPH_PRIVATE int gg_image_from_tiff (const char *path, int is_geotiff,
+				       int scale,
+				       gGraphImagePtr * image_handle);
 
 GGRAPH_PRIVATE int gg_image_strip_prepare_from_png (FILE * in,
 						    gGraphStripImagePtr *
 						    image_handle);
 GGRAPH_PRIVATE int gg_image_strip_prepare_from_jpeg (FILE * in,
-						     gGraphStripImagePtr *
-						     image_handle);
-GGRAPH_PRIVATE int gg_image_strip_prepare_from_jpeg (FILE * in,
+						     int decode_mode,
 						     gGraphStripImagePtr *
 						     image_handle);
 GGRAPH_PRIVATE int gg_image_strip_prepare_from_tiff (const char *path,
+						     int scale,
 						     gGraphStripImagePtr *
 						     image_handle);
 GGRAPH_PRIVATE int gg_image_strip_prepare_from_geotiff (const char *path,
+							int scale,
 							gGraphStripImagePtr *
 							image_handle);
 GGRAPH_PRIVATE int gg_image_strip_prepare_from_hgt (FILE * in, int lon, int lat,
@@ -1131,6 +1308,15 @@ GGRAPH_PRIVATE void gg_export_double (double value, unsigned char *p,
 				      int little_endian,
 				      int little_endian_arch);
 
+GGRAPH_PRIVATE int gg_is_adam7_compressed (const void *mem_buf,
+					   int mem_buf_size);
+GGRAPH_PRIVATE int gg_adam7_uncompress (const void *mem_buf, int mem_buf_size,
+					void **raw_buf, int *raw_buf_size);
+GGRAPH_PRIVATE int gg_adam7_uncompress_head (const void *mem_buf,
+					     int mem_buf_size,
+					     unsigned char *head,
+					     int head_size);
+
 
 GGRAPH_PRIVATE struct gg_svg_transform *gg_svg_alloc_transform (int type,
 								void *data);
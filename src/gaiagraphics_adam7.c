@@ -29,6 +29,8 @@
 #include <string.h>
 #include <float.h>
 
+#include <zlib.h>
+
 #include "gaiagraphics.h"
 #include "gaiagraphics_internals.h"
 
@@ -434,6 +436,234 @@ gGraphImageToAdam7 (const void *ptr_img, void *mem_bufs[7],
     return GGRAPH_INSUFFICIENT_MEMORY;
 }
 
+GGRAPH_PRIVATE int
+gg_is_adam7_compressed (const void *mem_buf, int mem_buf_size)
+{
+/* checks if this one is a compressed Adam7 (or RAW) memory buffer */
+    unsigned char *p = (unsigned char *) mem_buf;
+    short start_signature;
+    short end_signature;
+    int endian_arch = gg_endian_arch ();
+
+    if (mem_buf == NULL)
+	return 0;
+    if (mem_buf_size < (int) ((sizeof (short) * 2) + sizeof (int) + 1))
+	return 0;
+
+/* compressed markers always are LITTLE-ENDIAN */
+    start_signature = gg_import_int16 (p, 1, endian_arch);
+    p = (unsigned char *) mem_buf + mem_buf_size - sizeof (short);
+    end_signature = gg_import_int16 (p, 1, endian_arch);
+    if (start_signature != GG_ADAM7_COMPRESSED_START
+	|| end_signature != GG_ADAM7_COMPRESSED_END)
+	return 0;
+    p = (unsigned char *) mem_buf + sizeof (short);
+    if (*p != GG_ADAM7_CODEC_DEFLATE)
+	return 0;
+    return 1;
+}
+
+static int
+adam7_uncompressed_size (const void *mem_buf, int mem_buf_size)
+{
+/*
+/ retrieving the uncompressed size declared by a compressed Adam7
+/ (or RAW) memory buffer [returns -1 if not valid]
+/ no Deflate stream can expand more than 1032:1, so any larger
+/ declared size can only come from a corrupted buffer
+*/
+    unsigned char *p;
+    int endian_arch = gg_endian_arch ();
+    int size;
+    int header = sizeof (short) + 1 + sizeof (int);
+    double max_size;
+
+    if (!gg_is_adam7_compressed (mem_buf, mem_buf_size))
+	return -1;
+    p = (unsigned char *) mem_buf + sizeof (short) + 1;
+    size = gg_import_int32 (p, 1, endian_arch);
+    if (size < (int) (sizeof (short) * 4))
+	return -1;
+    max_size =
+	(double) (mem_buf_size - header - (int) sizeof (short)) * 1032.0;
+    if ((double) size > max_size)
+	return -1;
+    return size;
+}
+
+GGRAPH_PRIVATE int
+gg_adam7_uncompress (const void *mem_buf, int mem_buf_size, void **raw_buf,
+		     int *raw_buf_size)
+{
+/*
+/ uncompressing a compressed Adam7 (or RAW) memory buffer
+/
+/ layout [all LITTLE-ENDIAN]:
+/ - GG_ADAM7_COMPRESSED_START
+/ - codec [1 byte]
+/ - uncompressed size [int32]
+/ - compressed payload
+/ - GG_ADAM7_COMPRESSED_END
+*/
+    int size;
+    int header = sizeof (short) + 1 + sizeof (int);
+    uLongf out_size;
+    void *out;
+
+    *raw_buf = NULL;
+    *raw_buf_size = 0;
+    size = adam7_uncompressed_size (mem_buf, mem_buf_size);
+    if (size < 0)
+	return GGRAPH_INVALID_IMAGE;
+    out = malloc (size);
+    if (!out)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    out_size = size;
+    if (uncompress
+	(out, &out_size, (unsigned char *) mem_buf + header,
+	 mem_buf_size - header - sizeof (short)) != Z_OK
+	|| out_size != (uLongf) size)
+      {
+	  free (out);
+	  return GGRAPH_INVALID_IMAGE;
+      }
+    *raw_buf = out;
+    *raw_buf_size = size;
+    return GGRAPH_OK;
+}
+
+GGRAPH_PRIVATE int
+gg_adam7_uncompress_head (const void *mem_buf, int mem_buf_size,
+			  unsigned char *head, int head_size)
+{
+/*
+/ uncompressing just the leading bytes of a compressed Adam7 (or RAW)
+/ memory buffer [quickly checking its magic signature]
+*/
+    z_stream strm;
+    int header = sizeof (short) + 1 + sizeof (int);
+    int size = adam7_uncompressed_size (mem_buf, mem_buf_size);
+    int ret;
+
+    if (size < head_size)
+	return GGRAPH_INVALID_IMAGE;
+    memset (&strm, 0, sizeof (z_stream));
+    if (inflateInit (&strm) != Z_OK)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    strm.next_in = (unsigned char *) mem_buf + header;
+    strm.avail_in = mem_buf_size - header - sizeof (short);
+    strm.next_out = head;
+    strm.avail_out = head_size;
+    ret = inflate (&strm, Z_SYNC_FLUSH);
+    inflateEnd (&strm);
+    if ((ret != Z_OK && ret != Z_STREAM_END) || strm.avail_out != 0)
+	return GGRAPH_INVALID_IMAGE;
+    return GGRAPH_OK;
+}
+
+static int
+adam7_compress (void **mem_buf, int *mem_buf_size, int level)
+{
+/*
+/ replacing an Adam7 sub-image by its compressed equivalent
+/ [the raw sub-image is kept whenever compression doesn't pay]
+*/
+    unsigned char *p;
+    int endian_arch = gg_endian_arch ();
+    int header = sizeof (short) + 1 + sizeof (int);
+    uLongf payload_size = compressBound (*mem_buf_size);
+    int size;
+    unsigned char *out = malloc (header + payload_size + sizeof (short));
+    if (!out)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+
+    if (compress2
+	(out + header, &payload_size, *mem_buf, *mem_buf_size, level) != Z_OK)
+      {
+	  free (out);
+	  return GGRAPH_ERROR;
+      }
+    size = header + payload_size + sizeof (short);
+    if (size >= *mem_buf_size)
+      {
+	  /* useless: keeping the raw sub-image */
+	  free (out);
+	  return GGRAPH_OK;
+      }
+
+/* compressed markers always are LITTLE-ENDIAN */
+    p = out;
+    gg_export_int16 (GG_ADAM7_COMPRESSED_START, p, 1, endian_arch);
+    p += sizeof (short);
+    *p++ = GG_ADAM7_CODEC_DEFLATE;
+    gg_export_int32 (*mem_buf_size, p, 1, endian_arch);
+    p = out + size - sizeof (short);
+    gg_export_int16 (GG_ADAM7_COMPRESSED_END, p, 1, endian_arch);
+
+    free (*mem_buf);
+    *mem_buf = out;
+    *mem_buf_size = size;
+    return GGRAPH_OK;
+}
+
+GGRAPH_DECLARE int
+gGraphImageToAdam7Compressed (const void *ptr_img, void *mem_bufs[7],
+			      int mem_buf_sizes[7], void **palette,
+			      int *palette_size, int compression)
+{
+/*
+/ encoding an image as Adam7 - compressed sub-images
+/ gGraphImageFromAdam7() and gGraphIsRawImage() transparently
+/ support both the compressed and the raw sub-images
+*/
+    int i;
+    int ret;
+    int level;
+
+    switch (compression)
+      {
+      case GGRAPH_ADAM7_COMPRESSION_NONE:
+	  level = -1;
+	  break;
+      case GGRAPH_ADAM7_COMPRESSION_DEFLATE:
+	  level = Z_DEFAULT_COMPRESSION;
+	  break;
+      case GGRAPH_ADAM7_COMPRESSION_DEFLATE_FAST:
+	  level = Z_BEST_SPEED;
+	  break;
+      default:
+	  return GGRAPH_ERROR;
+      };
+
+    ret =
+	gGraphImageToAdam7 (ptr_img, mem_bufs, mem_buf_sizes, palette,
+			    palette_size);
+    if (ret != GGRAPH_OK || compression == GGRAPH_ADAM7_COMPRESSION_NONE)
+	return ret;
+
+    for (i = 0; i < 7; i++)
+      {
+	  ret = adam7_compress (&(mem_bufs[i]), &(mem_buf_sizes[i]), level);
+	  if (ret != GGRAPH_OK)
+	      goto stop;
+      }
+    return GGRAPH_OK;
+
+  stop:
+    for (i = 0; i < 7; i++)
+      {
+	  if (mem_bufs[i])
+	      free (mem_bufs[i]);
+	  mem_bufs[i] = NULL;
+	  mem_buf_sizes[i] = 0;
+      }
+    if (*palette)
+	free (*palette);
+    *palette = NULL;
+    *palette_size = 0;
+    return ret;
+}
+
 static gGraphImagePtr
 adam7_decode (int img_no, void *mem_buf, int mem_buf_size)
 {
@@ -454,6 +684,19 @@ adam7_decode (int img_no, void *mem_buf, int mem_buf_size)
     int size;
     gGraphImagePtr img = NULL;
 
+    if (gg_is_adam7_compressed (mem_buf, mem_buf_size))
+      {
+	  /* transparently uncompressing the sub-image */
+	  void *raw_buf;
+	  int raw_buf_size;
+	  if (gg_adam7_uncompress
+	      (mem_buf, mem_buf_size, &raw_buf, &raw_buf_size) != GGRAPH_OK)
+	      return NULL;
+	  img = adam7_decode (img_no, raw_buf, raw_buf_size);
+	  free (raw_buf);
+	  return img;
+      }
+
     if (mem_buf_size < (int) (sizeof (short) * 4))
 	return NULL;
 /*
@@ -1223,1443 +1466,174 @@ get_adam7_dims_1 (gGraphImagePtr img_0, gGraphImagePtr img_1,
     return 1;
 }
 
-static gGraphImagePtr
-merge_adam7_scale_1 (gGraphImagePtr img_0, gGraphImagePtr img_1,
-		     gGraphImagePtr img_2, gGraphImagePtr img_3,
-		     gGraphImagePtr img_4, gGraphImagePtr img_5,
-		     gGraphImagePtr img_6, int width, int height)
+static void
+adam7_scatter_row (unsigned char *p_out, const unsigned char *p_in,
+		   int count, int step, int pixel_bytes)
 {
-/* decoding an Adam7 image (1:1) */
+/*
+/ scattering a sub-image row into an output row
+/ [kernels specialized by pixel size, so to avoid any per-pixel switch]
+*/
     int x;
+    int out_step = step * pixel_bytes;
+
+    if (step == 1)
+      {
+	  /* contiguous pixels */
+	  memcpy (p_out, p_in, count * pixel_bytes);
+	  return;
+      }
+    switch (pixel_bytes)
+      {
+      case 1:
+	  for (x = 0; x < count; x++)
+	    {
+		*p_out = *p_in++;
+		p_out += out_step;
+	    }
+	  break;
+      case 2:
+	  for (x = 0; x < count; x++)
+	    {
+		memcpy (p_out, p_in, 2);
+		p_in += 2;
+		p_out += out_step;
+	    }
+	  break;
+      case 3:
+	  for (x = 0; x < count; x++)
+	    {
+		p_out[0] = p_in[0];
+		p_out[1] = p_in[1];
+		p_out[2] = p_in[2];
+		p_in += 3;
+		p_out += out_step;
+	    }
+	  break;
+      case 4:
+	  for (x = 0; x < count; x++)
+	    {
+		memcpy (p_out, p_in, 4);
+		p_in += 4;
+		p_out += out_step;
+	    }
+	  break;
+      case 8:
+	  for (x = 0; x < count; x++)
+	    {
+		memcpy (p_out, p_in, 8);
+		p_in += 8;
+		p_out += out_step;
+	    }
+	  break;
+      default:
+	  for (x = 0; x < count; x++)
+	    {
+		memcpy (p_out, p_in, pixel_bytes);
+		p_in += pixel_bytes;
+		p_out += out_step;
+	    }
+	  break;
+      };
+}
+
+static gGraphImagePtr
+merge_adam7 (gGraphImagePtr * subs, int num_subs, int scale, int width,
+	     int height)
+{
+/*
+/ decoding an Adam7 image (1:1, 1:2 or 1:4 scale)
+/ each output row gathers the rows of the sub-images contributing
+/ to it, so the output is written sequentially just once
+*/
+    static const int x_base[7] = { 0, 4, 0, 2, 0, 1, 0 };
+    static const int y_base[7] = { 0, 0, 4, 0, 2, 0, 1 };
+    static const int x_step[7] = { 8, 8, 4, 4, 2, 2, 1 };
+    static const int y_step[7] = { 8, 8, 8, 4, 4, 2, 2 };
+    int i;
     int y;
-    unsigned char *p_in;
+    int yy;
+    int row;
+    int x_out;
+    int step;
+    int count;
+    int max_count;
+    int pixel_bytes;
     unsigned char *p_out;
-    gGraphImagePtr img = gg_image_create (img_0->pixel_format, width, height,
-					  img_0->bits_per_sample,
-					  img_0->samples_per_pixel,
-					  img_0->sample_format, NULL,
+    gGraphImagePtr sub;
+    gGraphImagePtr img = gg_image_create (subs[0]->pixel_format, width, height,
+					  subs[0]->bits_per_sample,
+					  subs[0]->samples_per_pixel,
+					  subs[0]->sample_format, NULL,
 					  NULL);
     if (!img)
 	return NULL;
 
-/* expanding SubImage-0 */
-    for (y = 0; y < img_0->height; y++)
+    pixel_bytes = (subs[0]->bits_per_sample / 8) * subs[0]->samples_per_pixel;
+    for (y = 0; y < height; y++)
       {
-	  p_in = img_0->pixels + (y * img_0->scanline_width);
-	  p_out = img->pixels + ((y * 8) * img->scanline_width);
-	  for (x = 0; x < img_0->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += (7 * 3);
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 8;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 8;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 8;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 8;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 8;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 8;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 8;
-			      }
-			    break;
-			};
-		      break;
-		  };
+	  yy = y * scale;
+	  p_out = img->pixels + (y * img->scanline_width);
+	  for (i = 0; i < num_subs; i++)
+	    {
+		sub = subs[i];
+		if (yy < y_base[i] || ((yy - y_base[i]) % y_step[i]) != 0)
+		    continue;
+		row = (yy - y_base[i]) / y_step[i];
+		if (row >= sub->height)
+		    continue;
+		x_out = x_base[i] / scale;
+		step = x_step[i] / scale;
+		count = sub->width;
+		max_count = (width - x_out + step - 1) / step;
+		if (count > max_count)
+		    count = max_count;
+		if (count <= 0)
+		    continue;
+		adam7_scatter_row (p_out + (x_out * pixel_bytes),
+				   sub->pixels + (row * sub->scanline_width),
+				   count, step, pixel_bytes);
 	    }
       }
+    return img;
+}
+
+static int
+adam7_set_palette (gGraphImagePtr img, void *palette, int palette_size)
+{
+/* setting up a palette */
+    unsigned char *p_in;
+    int endian_arch = gg_endian_arch ();
+    short palette_start;
+    short palette_end;
+    int i;
+
+    if (img->pixel_format != GG_PIXEL_PALETTE)
+	return 0;
 
-/* expanding SubImage-1 */
-    for (y = 0; y < img_1->height; y++)
+/* checking signatures */
+    if (palette_size < (int) ((sizeof (short) * 2) + 1))
+	return 0;
+    p_in = palette;
+    palette_start = gg_import_int16 (p_in, 1, endian_arch);
+    p_in = (unsigned char *) palette + palette_size - sizeof (short);
+    palette_end = gg_import_int16 (p_in, 1, endian_arch);
+    if (palette_start == GG_ADAM7_PALETTE_START
+	&& palette_end == GG_ADAM7_PALETTE_END)
+	;
+    else
+	return 0;
+
+    p_in = (unsigned char *) palette + sizeof (short);
+    img->max_palette = *p_in++;
+    for (i = 0; i < img->max_palette; i++)
       {
-	  p_in = img_1->pixels + (y * img_1->scanline_width);
-	  p_out =
-	      img->pixels + ((y * 8) * img->scanline_width) +
-	      (4 * img->pixel_size);
-	  for (x = 0; x < img_1->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += (7 * 3);
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 8;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 8;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 8;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 8;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 8;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 8;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 8;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
+	  img->palette_red[i] = *p_in++;
+	  img->palette_green[i] = *p_in++;
+	  img->palette_blue[i] = *p_in++;
       }
-
-/* expanding SubImage-2 */
-    for (y = 0; y < img_2->height; y++)
-      {
-	  p_in = img_2->pixels + (y * img_2->scanline_width);
-	  p_out = img->pixels + (((y * 8) + 4) * img->scanline_width);
-	  for (x = 0; x < img_2->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += (3 * 3);
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 4;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 4;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 4;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 4;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 4;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-3 */
-    for (y = 0; y < img_3->height; y++)
-      {
-	  p_in = img_3->pixels + (y * img_3->scanline_width);
-	  p_out =
-	      img->pixels + ((y * 4) * img->scanline_width) +
-	      (2 * img->pixel_size);
-	  for (x = 0; x < img_3->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += (3 * 3);
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 4;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 4;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 4;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 4;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 4;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-4 */
-    for (y = 0; y < img_4->height; y++)
-      {
-	  p_in = img_4->pixels + (y * img_4->scanline_width);
-	  p_out = img->pixels + (((y * 4) + 2) * img->scanline_width);
-	  for (x = 0; x < img_4->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += 3;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 2;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 2;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 2;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 2;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 2;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-5 */
-    for (y = 0; y < img_5->height; y++)
-      {
-	  p_in = img_5->pixels + (y * img_5->scanline_width);
-	  p_out =
-	      img->pixels + ((y * 2) * img->scanline_width) + img->pixel_size;
-	  for (x = 0; x < img_5->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += 3;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 2;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 2;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 2;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 2;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 2;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-6 */
-    for (y = 0; y < img_6->height; y++)
-      {
-	  p_in = img_6->pixels + (y * img_6->scanline_width);
-	  p_out = img->pixels + (((y * 2) + 1) * img->scanline_width);
-	  for (x = 0; x < img_6->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out++ = *p_in++;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short);
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int);
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short);
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int);
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float);
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double);
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-    return img;
-}
-
-static gGraphImagePtr
-merge_adam7_scale_2 (gGraphImagePtr img_0, gGraphImagePtr img_1,
-		     gGraphImagePtr img_2, gGraphImagePtr img_3,
-		     gGraphImagePtr img_4, int width, int height)
-{
-/* decoding an Adam7 image (1:2) */
-    int x;
-    int y;
-    unsigned char *p_in;
-    unsigned char *p_out;
-    gGraphImagePtr img = gg_image_create (img_0->pixel_format, width, height,
-					  img_0->bits_per_sample,
-					  img_0->samples_per_pixel,
-					  img_0->sample_format, NULL,
-					  NULL);
-    if (!img)
-	return NULL;
-
-/* expanding SubImage-0 */
-    for (y = 0; y < img_0->height; y++)
-      {
-	  p_in = img_0->pixels + (y * img_0->scanline_width);
-	  p_out = img->pixels + ((y * 4) * img->scanline_width);
-	  for (x = 0; x < img_0->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += (3 * 3);
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 4;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 4;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 4;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 4;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 4;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-1 */
-    for (y = 0; y < img_1->height; y++)
-      {
-	  p_in = img_1->pixels + (y * img_1->scanline_width);
-	  p_out =
-	      img->pixels + ((y * 4) * img->scanline_width) +
-	      (2 * img->pixel_size);
-	  for (x = 0; x < img_1->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += (3 * 3);
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 4;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 4;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 4;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 4;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 4;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 4;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-2 */
-    for (y = 0; y < img_2->height; y++)
-      {
-	  p_in = img_2->pixels + (y * img_2->scanline_width);
-	  p_out = img->pixels + (((y * 4) + 2) * img->scanline_width);
-	  for (x = 0; x < img_2->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += 3;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 2;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 2;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 2;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 2;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 2;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-3 */
-    for (y = 0; y < img_3->height; y++)
-      {
-	  p_in = img_3->pixels + (y * img_3->scanline_width);
-	  p_out =
-	      img->pixels + ((y * 2) * img->scanline_width) + img->pixel_size;
-	  for (x = 0; x < img_3->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += 3;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 2;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 2;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 2;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 2;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 2;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-4 */
-    for (y = 0; y < img_4->height; y++)
-      {
-	  p_in = img_4->pixels + (y * img_4->scanline_width);
-	  p_out = img->pixels + (((y * 2) + 1) * img->scanline_width);
-	  for (x = 0; x < img_4->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out++ = *p_in++;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short);
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int);
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short);
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int);
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float);
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double);
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-    return img;
-}
-
-static gGraphImagePtr
-merge_adam7_scale_4 (gGraphImagePtr img_0, gGraphImagePtr img_1,
-		     gGraphImagePtr img_2, int width, int height)
-{
-/* decoding an Adam7 image (1:4) */
-    int x;
-    int y;
-    unsigned char *p_in;
-    unsigned char *p_out;
-    gGraphImagePtr img = gg_image_create (img_0->pixel_format, width, height,
-					  img_0->bits_per_sample,
-					  img_0->samples_per_pixel,
-					  img_0->sample_format, NULL,
-					  NULL);
-    if (!img)
-	return NULL;
-
-/* expanding SubImage-0 */
-    for (y = 0; y < img_0->height; y++)
-      {
-	  p_in = img_0->pixels + (y * img_0->scanline_width);
-	  p_out = img->pixels + ((y * 2) * img->scanline_width);
-	  for (x = 0; x < img_0->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += 3;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 2;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 2;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 2;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 2;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 2;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-1 */
-    for (y = 0; y < img_1->height; y++)
-      {
-	  p_in = img_1->pixels + (y * img_1->scanline_width);
-	  p_out =
-	      img->pixels + ((y * 2) * img->scanline_width) + img->pixel_size;
-	  for (x = 0; x < img_1->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      p_out += 3;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out = *p_in++;
-		      p_out += 2;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short) * 2;
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short) * 2;
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int) * 2;
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float) * 2;
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double) * 2;
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-/* expanding SubImage-2 */
-    for (y = 0; y < img_2->height; y++)
-      {
-	  p_in = img_2->pixels + (y * img_2->scanline_width);
-	  p_out = img->pixels + (((y * 2) + 1) * img->scanline_width);
-	  for (x = 0; x < img_2->width; x++)
-	    {
-		switch (img->pixel_format)
-		  {
-		  case GG_PIXEL_RGB:
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      *p_out++ = *p_in++;
-		      break;
-		  case GG_PIXEL_GRAYSCALE:
-		  case GG_PIXEL_PALETTE:
-		      *p_out++ = *p_in++;
-		      break;
-		  case GG_PIXEL_GRID:
-		      switch (img_0->pixel_format)
-			{
-			case GGRAPH_SAMPLE_INT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  short *p = (short *) p_in;
-				  short value = *p;
-				  p_in += sizeof (short);
-				  p = (short *) p_out;
-				  *p = value;
-				  p_out += sizeof (short);
-			      }
-			    else
-			      {
-				  int *p = (int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (int);
-				  p = (int *) p_out;
-				  *p = value;
-				  p_out += sizeof (int);
-			      }
-			    break;
-			case GGRAPH_SAMPLE_UINT:
-			    if (img_0->bits_per_sample == 16)
-			      {
-				  unsigned short *p = (unsigned short *) p_in;
-				  unsigned short value = *p;
-				  p_in += sizeof (unsigned short);
-				  p = (unsigned short *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned short);
-			      }
-			    else
-			      {
-				  unsigned int *p = (unsigned int *) p_in;
-				  int value = *p;
-				  p_in += sizeof (unsigned int);
-				  p = (unsigned int *) p_out;
-				  *p = value;
-				  p_out += sizeof (unsigned int);
-			      }
-			    break;
-			case GGRAPH_SAMPLE_FLOAT:
-			    if (img_0->bits_per_sample == 32)
-			      {
-				  float *p = (float *) p_in;
-				  float value = *p;
-				  p_in += sizeof (float);
-				  p = (float *) p_out;
-				  *p = value;
-				  p_out += sizeof (float);
-			      }
-			    else
-			      {
-				  double *p = (double *) p_in;
-				  double value = *p;
-				  p_in += sizeof (double);
-				  p = (double *) p_out;
-				  *p = value;
-				  p_out += sizeof (double);
-			      }
-			    break;
-			};
-		      break;
-		  };
-	    }
-      }
-
-    return img;
-}
-
-static int
-adam7_set_palette (gGraphImagePtr img, void *palette, int palette_size)
-{
-/* setting up a palette */
-    unsigned char *p_in;
-    int endian_arch = gg_endian_arch ();
-    short palette_start;
-    short palette_end;
-    int i;
-
-    if (img->pixel_format != GG_PIXEL_PALETTE)
-	return 0;
-
-/* checking signatures */
-    if (palette_size < (int) ((sizeof (short) * 2) + 1))
-	return 0;
-    p_in = palette;
-    palette_start = gg_import_int16 (p_in, 1, endian_arch);
-    p_in = (unsigned char *) palette + palette_size - sizeof (short);
-    palette_end = gg_import_int16 (p_in, 1, endian_arch);
-    if (palette_start == GG_ADAM7_PALETTE_START
-	&& palette_end == GG_ADAM7_PALETTE_END)
-	;
-    else
-	return 0;
-
-    p_in = (unsigned char *) palette + sizeof (short);
-    img->max_palette = *p_in++;
-    for (i = 0; i < img->max_palette; i++)
-      {
-	  img->palette_red[i] = *p_in++;
-	  img->palette_green[i] = *p_in++;
-	  img->palette_blue[i] = *p_in++;
-      }
-    return 1;
-}
+    return 1;
+}
 
 GGRAPH_DECLARE int
 gGraphImageFromAdam7 (void *mem_bufs[7], int mem_buf_sizes[7], void *palette,
@@ -2674,6 +1648,7 @@ gGraphImageFromAdam7 (void *mem_bufs[7], int mem_buf_sizes[7], void *palette,
     gGraphImagePtr img_5 = NULL;
     gGraphImagePtr img_6 = NULL;
     gGraphImagePtr img;
+    gGraphImagePtr subs[7];
     int width;
     int height;
 
@@ -2718,7 +1693,10 @@ gGraphImageFromAdam7 (void *mem_bufs[7], int mem_buf_sizes[7], void *palette,
 	      goto stop;
 	  if (!get_adam7_dims_4 (img_0, img_1, img_2, &width, &height))
 	      goto stop;
-	  img = merge_adam7_scale_4 (img_0, img_1, img_2, width, height);
+	  subs[0] = img_0;
+	  subs[1] = img_1;
+	  subs[2] = img_2;
+	  img = merge_adam7 (subs, 3, 4, width, height);
 	  if (!img)
 	      goto stop;
 	  gGraphDestroyImage (img_0);
@@ -2770,9 +1748,12 @@ gGraphImageFromAdam7 (void *mem_bufs[7], int mem_buf_sizes[7], void *palette,
 	  if (!get_adam7_dims_2
 	      (img_0, img_1, img_2, img_3, img_4, &width, &height))
 	      goto stop;
-	  img =
-	      merge_adam7_scale_2 (img_0, img_1, img_2, img_3, img_4, width,
-				   height);
+	  subs[0] = img_0;
+	  subs[1] = img_1;
+	  subs[2] = img_2;
+	  subs[3] = img_3;
+	  subs[4] = img_4;
+	  img = merge_adam7 (subs, 5, 2, width, height);
 	  if (!img)
 	      goto stop;
 	  gGraphDestroyImage (img_0);
@@ -2841,9 +1822,14 @@ gGraphImageFromAdam7 (void *mem_bufs[7], int mem_buf_sizes[7], void *palette,
 	      (img_0, img_1, img_2, img_3, img_4, img_5, img_6, &width,
 	       &height))
 	      goto stop;
-	  img =
-	      merge_adam7_scale_1 (img_0, img_1, img_2, img_3, img_4, img_5,
-				   img_6, width, height);
+	  subs[0] = img_0;
+	  subs[1] = img_1;
+	  subs[2] = img_2;
+	  subs[3] = img_3;
+	  subs[4] = img_4;
+	  subs[5] = img_5;
+	  subs[6] = img_6;
+	  img = merge_adam7 (subs, 7, 1, width, height);
 	  if (!img)
 	      goto stop;
 	  gGraphDestroyImage (img_0);
@@ -2880,6 +1866,85 @@ gGraphImageFromAdam7 (void *mem_bufs[7], int mem_buf_sizes[7], void *palette,
     return GGRAPH_INVALID_IMAGE;
 }
 
+GGRAPH_DECLARE int
+gGraphAdam7PassesForScale (int scale, int *num_passes)
+{
+/*
+/ how many Adam7 sub-images are required for some scale:
+/ the first one alone for 1:8, the first three for 1:4,
+/ the first five for 1:2 and all them for 1:1
+*/
+    *num_passes = 0;
+    switch (scale)
+      {
+      case 1:
+	  *num_passes = 7;
+	  break;
+      case 2:
+	  *num_passes = 5;
+	  break;
+      case 4:
+	  *num_passes = 3;
+	  break;
+      case 8:
+	  *num_passes = 1;
+	  break;
+      default:
+	  return GGRAPH_ERROR;
+      };
+    return GGRAPH_OK;
+}
+
+GGRAPH_DECLARE int
+gGraphImageFromAdam7Passes (void *mem_bufs[], int mem_buf_sizes[],
+			    int num_passes, void *palette, int palette_size,
+			    const void **image_handle)
+{
+/*
+/ decoding an image from the leading Adam7 sub-images only
+/ [1, 3, 5 or 7 of them, respectively for 1:8, 1:4, 1:2 and 1:1]
+/ the caller is never required to fetch the remaining ones
+*/
+    void *bufs[7];
+    int sizes[7];
+    int scale;
+    int i;
+
+    *image_handle = NULL;
+    switch (num_passes)
+      {
+      case 1:
+	  scale = 8;
+	  break;
+      case 3:
+	  scale = 4;
+	  break;
+      case 5:
+	  scale = 2;
+	  break;
+      case 7:
+	  scale = 1;
+	  break;
+      default:
+	  return GGRAPH_ERROR;
+      };
+    for (i = 0; i < 7; i++)
+      {
+	  if (i < num_passes)
+	    {
+		bufs[i] = mem_bufs[i];
+		sizes[i] = mem_buf_sizes[i];
+	    }
+	  else
+	    {
+		bufs[i] = NULL;
+		sizes[i] = 0;
+	    }
+      }
+    return gGraphImageFromAdam7 (bufs, sizes, palette, palette_size,
+				 image_handle, scale);
+}
+
 GGRAPH_DECLARE int
 gGraphImageToMonochrome (const void *ptr_img, void **mem_buf, int *mem_buf_size)
 {
@@ -253,6 +253,7 @@ gGraphImageBackgroundFill (const void *ptr, unsigned char red,
       {
 	  /* resetting an empty palette */
 	  img->max_palette = 1;
+	  img->palette_version++;
 	  img->palette_red[0] = red;
 	  img->palette_green[0] = green;
 	  img->palette_blue[0] = blue;
@@ -488,10 +489,29 @@ gGraphImageFromMemBuf (const void *mem_buf, int mem_buf_size, int image_type,
 		       const void **image_handle, int scale)
 {
 /* decompressing a memory block containing an encoded image */
+    return gGraphImageFromMemBufEx (mem_buf, mem_buf_size, image_type,
+				    image_handle, scale,
+				    GGRAPH_JPEG_DECODE_ACCURATE);
+}
+
+GGRAPH_DECLARE int
+gGraphImageFromMemBufEx (const void *mem_buf, int mem_buf_size,
+			 int image_type, const void **image_handle, int scale,
+			 int decode_mode)
+{
+/* 
+/ decompressing a memory block containing an encoded image
+/ decode_mode only affects JPEG: GGRAPH_JPEG_DECODE_FAST trades
+/ some quality for speed [previews, thumbnails]
+/ any other decode_mode is invalid [GGRAPH_ERROR]
+*/
     gGraphImagePtr img = NULL;
     int ret;
 
     *image_handle = NULL;
+    if (decode_mode != GGRAPH_JPEG_DECODE_ACCURATE
+	&& decode_mode != GGRAPH_JPEG_DECODE_FAST)
+	return GGRAPH_ERROR;
     switch (image_type)
       {
       case GGRAPH_IMAGE_GIF:
@@ -507,7 +527,7 @@ gGraphImageFromMemBuf (const void *mem_buf, int mem_buf_size, int image_type,
       case GGRAPH_IMAGE_JPEG:
 	  ret =
 	      gg_image_from_jpeg (mem_buf_size, mem_buf, GG_TARGET_IS_MEMORY,
-				  &img, scale);
+				  &img, scale, decode_mode);
 	  break;
       case GGRAPH_IMAGE_TIFF:
       case GGRAPH_IMAGE_GEOTIFF:
@@ -526,11 +546,28 @@ gGraphImageFromFile (const char *path, int image_type,
 		     const void **image_handle, int scale)
 {
 /* reading an image from file */
+    return gGraphImageFromFileEx (path, image_type, image_handle, scale,
+				  GGRAPH_JPEG_DECODE_ACCURATE);
+}
+
+GGRAPH_DECLARE int
+gGraphImageFromFileEx (const char *path, int image_type,
+		       const void **image_handle, int scale, int decode_mode)
+{
+/* 
+/ reading an image from file
+/ decode_mode only affects JPEG: GGRAPH_JPEG_DECODE_FAST trades
+/ some quality for speed [previews, thumbnails]
+/ any other decode_mode is invalid [GGRAPH_ERROR]
+*/
     FILE *in = NULL;
     gGraphImagePtr img = NULL;
     int ret;
 
     *image_handle = NULL;
+    if (decode_mode != GGRAPH_JPEG_DECODE_ACCURATE
+	&& decode_mode != GGRAPH_JPEG_DECODE_FAST)
+	return GGRAPH_ERROR;
 
 /* attempting to open the image file */
     in = fopen (path, "rb");
@@ -545,7 +582,15 @@ gGraphImageFromFile (const char *path, int image_type,
 	  ret = gg_image_from_png (0, in, GG_TARGET_IS_FILE, &img, scale);
 	  break;
       case GGRAPH_IMAGE_JPEG:
-	  ret = gg_image_from_jpeg (0, in, GG_TARGET_IS_FILE, &img, scale);
+	  ret =
+	      gg_image_from_jpeg (0, in, GG_TARGET_IS_FILE, &img, scale,
+				  decode_mode);
+	  break;
+      case GGRAPH_IMAGE_TIFF:
+	  ret = gg_image_from_tiff (path, 0, scale, &img);
+	  break;
+      case GGRAPH_IMAGE_GEOTIFF:
+	  ret = gg_image_from_tiff (path, 1, scale, &img);
 	  break;
       };
     fclose (in);
@@ -556,16 +601,78 @@ gGraphImageFromFile (const char *path, int image_type,
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphImageFromFileWindow (const char *path, int image_type, int x, int y,
+			   int width, int height, const void **image_handle)
+{
+/* 
+/ reading a rectangular window from an image file
+/ only TIFF and GeoTIFF are supported: any tile or strip
+/ not intersecting the window will never be decoded
+*/
+    gGraphImagePtr img = NULL;
+    int ret;
+
+    *image_handle = NULL;
+    switch (image_type)
+      {
+      case GGRAPH_IMAGE_TIFF:
+	  ret = gg_image_window_from_tiff (path, 0, x, y, width, height, &img);
+	  break;
+      case GGRAPH_IMAGE_GEOTIFF:
+	  ret = gg_image_window_from_tiff (path, 1, x, y, width, height, &img);
+	  break;
+      default:
+	  ret = GGRAPH_ERROR;
+	  break;
+      };
+    if (ret != GGRAPH_OK)
+	return ret;
+
+    *image_handle = img;
+    return GGRAPH_OK;
+}
+
 GGRAPH_DECLARE int
 gGraphImageFromFileByStrips (const char *path, int image_type,
 			     const void **image_handle)
 {
 /* reading an image from file [by strips] */
+    return gGraphImageFromFileByStripsScaled (path, image_type, 1,
+					      image_handle);
+}
+
+GGRAPH_DECLARE int
+gGraphImageFromFileByStripsScaled (const char *path, int image_type,
+				   int scale, const void **image_handle)
+{
+/*
+/ reading an image from file [by strips] at some reduced scale
+/ only TIFF and GeoTIFF support scale [2, 4, 8], by reading from the
+/ best Overview if any: other formats will always return full resolution
+*/
+    return gGraphImageFromFileByStripsEx (path, image_type, scale,
+					  GGRAPH_JPEG_DECODE_ACCURATE,
+					  image_handle);
+}
+
+GGRAPH_DECLARE int
+gGraphImageFromFileByStripsEx (const char *path, int image_type, int scale,
+			       int decode_mode, const void **image_handle)
+{
+/*
+/ reading an image from file [by strips] at some reduced scale
+/ and using the given JPEG decode mode [ACCURATE or FAST]
+/ any other decode_mode is invalid [GGRAPH_ERROR]
+*/
     FILE *in = NULL;
     gGraphStripImagePtr img = NULL;
     int ret;
 
     *image_handle = NULL;
+    if (decode_mode != GGRAPH_JPEG_DECODE_ACCURATE
+	&& decode_mode != GGRAPH_JPEG_DECODE_FAST)
+	return GGRAPH_ERROR;
 
 /* attempting to open the image file */
     if (image_type == GGRAPH_IMAGE_TIFF || image_type == GGRAPH_IMAGE_GEOTIFF)
@@ -582,13 +689,13 @@ gGraphImageFromFileByStrips (const char *path, int image_type,
 	  ret = gg_image_strip_prepare_from_png (in, &img);
 	  break;
       case GGRAPH_IMAGE_JPEG:
-	  ret = gg_image_strip_prepare_from_jpeg (in, &img);
+	  ret = gg_image_strip_prepare_from_jpeg (in, decode_mode, &img);
 	  break;
       case GGRAPH_IMAGE_TIFF:
-	  ret = gg_image_strip_prepare_from_tiff (path, &img);
+	  ret = gg_image_strip_prepare_from_tiff (path, scale, &img);
 	  break;
       case GGRAPH_IMAGE_GEOTIFF:
-	  ret = gg_image_strip_prepare_from_geotiff (path, &img);
+	  ret = gg_image_strip_prepare_from_geotiff (path, scale, &img);
 	  break;
       };
     if (ret != GGRAPH_OK)
@@ -764,13 +871,16 @@ gGraphCountColors (const char *path, int image_type, int rows_per_block)
 	  ret = gg_image_strip_prepare_from_png (in, &img);
 	  break;
       case GGRAPH_IMAGE_JPEG:
-	  ret = gg_image_strip_prepare_from_jpeg (in, &img);
+	  ret =
+	      gg_image_strip_prepare_from_jpeg (in,
+						GGRAPH_JPEG_DECODE_ACCURATE,
+						&img);
 	  break;
       case GGRAPH_IMAGE_TIFF:
-	  ret = gg_image_strip_prepare_from_tiff (path, &img);
+	  ret = gg_image_strip_prepare_from_tiff (path, 1, &img);
 	  break;
       case GGRAPH_IMAGE_GEOTIFF:
-	  ret = gg_image_strip_prepare_from_geotiff (path, &img);
+	  ret = gg_image_strip_prepare_from_geotiff (path, 1, &img);
 	  break;
       };
     if (ret != GGRAPH_OK)
@@ -886,7 +996,22 @@ GGRAPH_DECLARE int
 gGraphImageToJpegFile (const void *ptr, const char *path, int quality)
 {
 /* exporting an image into a JPEG compressed file */
+    return gGraphImageToJpegFileEx (ptr, path, quality, 0, 0,
+				    GGRAPH_JPEG_SUBSAMPLING_420, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageToJpegFileEx (const void *ptr, const char *path, int quality,
+			 int progressive, int optimize_coding, int subsampling,
+			 int restart_interval)
+{
+/* 
+/ exporting an image into a JPEG compressed file
+/ optionally progressive and/or using optimized Huffman tables
+/ restart_interval is measured in MCU rows [zero: none]
+*/
     gGraphImagePtr img = (gGraphImagePtr) ptr;
+    gGraphJpegOptions options;
     int ret;
     FILE *out = NULL;
 
@@ -894,13 +1019,21 @@ gGraphImageToJpegFile (const void *ptr, const char *path, int quality)
 	return GGRAPH_INVALID_IMAGE;
     if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
 	return GGRAPH_INVALID_IMAGE;
+    gg_jpeg_default_options (&options, quality);
+    options.progressive = progressive;
+    options.optimize_coding = optimize_coding;
+    options.subsampling = subsampling;
+    options.restart_interval = restart_interval;
+    if (!gg_jpeg_check_options (&options))
+	return GGRAPH_ERROR;
 
 /* opening the output image file */
     out = fopen (path, "wb");
     if (out == NULL)
 	return GGRAPH_FILE_OPEN_ERROR;
 /* compressing as JPEG */
-    ret = gg_image_to_jpeg (img, NULL, NULL, out, GG_TARGET_IS_FILE, quality);
+    ret =
+	gg_image_to_jpeg (img, NULL, NULL, out, GG_TARGET_IS_FILE, &options);
     fclose (out);
     if (ret != GGRAPH_OK)
       {
@@ -917,7 +1050,25 @@ gGraphImageToJpegFileByStrips (const void **ptr, const char *path, int width,
 			       int height, int color_model, int quality)
 {
 /* exporting an image into a JPEG compressed file [by strips] */
+    return gGraphImageToJpegFileByStripsEx (ptr, path, width, height,
+					    color_model, quality, 0, 0,
+					    GGRAPH_JPEG_SUBSAMPLING_420, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageToJpegFileByStripsEx (const void **ptr, const char *path,
+				 int width, int height, int color_model,
+				 int quality, int progressive,
+				 int optimize_coding, int subsampling,
+				 int restart_interval)
+{
+/* 
+/ exporting an image into a JPEG compressed file [by strips]
+/ progressive and optimized output are still written strip by strip:
+/ libjpeg buffers the coefficients internally until the last strip
+*/
     gGraphStripImagePtr img;
+    gGraphJpegOptions options;
     int ret;
     FILE *out = NULL;
 
@@ -927,6 +1078,13 @@ gGraphImageToJpegFileByStrips (const void **ptr, const char *path, int width,
 	;
     else
 	return GGRAPH_INVALID_IMAGE;
+    gg_jpeg_default_options (&options, quality);
+    options.progressive = progressive;
+    options.optimize_coding = optimize_coding;
+    options.subsampling = subsampling;
+    options.restart_interval = restart_interval;
+    if (!gg_jpeg_check_options (&options))
+	return GGRAPH_ERROR;
 
 /* opening the output image file */
     out = fopen (path, "wb");
@@ -961,7 +1119,7 @@ gGraphImageToJpegFileByStrips (const void **ptr, const char *path, int width,
 	    }
       }
 
-    ret = gg_image_prepare_to_jpeg_by_strip (img, out, quality);
+    ret = gg_image_prepare_to_jpeg_by_strip (img, out, &options);
     if (ret != GGRAPH_OK)
       {
 	  gg_strip_image_destroy (img);
@@ -977,7 +1135,22 @@ gGraphImageToJpegMemBuf (const void *ptr, void **mem_buf, int *mem_buf_size,
 			 int quality)
 {
 /* exporting an image into a JPEG compressed memory buffer */
+    return gGraphImageToJpegMemBufEx (ptr, mem_buf, mem_buf_size, quality, 0,
+				      0, GGRAPH_JPEG_SUBSAMPLING_420, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageToJpegMemBufEx (const void *ptr, void **mem_buf, int *mem_buf_size,
+			   int quality, int progressive, int optimize_coding,
+			   int subsampling, int restart_interval)
+{
+/* 
+/ exporting an image into a JPEG compressed memory buffer
+/ optionally progressive and/or using optimized Huffman tables
+/ restart_interval is measured in MCU rows [zero: none]
+*/
     gGraphImagePtr img = (gGraphImagePtr) ptr;
+    gGraphJpegOptions options;
     void *buf = NULL;
     int size;
     int ret;
@@ -988,10 +1161,18 @@ gGraphImageToJpegMemBuf (const void *ptr, void **mem_buf, int *mem_buf_size,
 	return GGRAPH_INVALID_IMAGE;
     if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
 	return GGRAPH_INVALID_IMAGE;
+    gg_jpeg_default_options (&options, quality);
+    options.progressive = progressive;
+    options.optimize_coding = optimize_coding;
+    options.subsampling = subsampling;
+    options.restart_interval = restart_interval;
+    if (!gg_jpeg_check_options (&options))
+	return GGRAPH_ERROR;
 
 /* compressing as JPEG */
     ret =
-	gg_image_to_jpeg (img, &buf, &size, NULL, GG_TARGET_IS_MEMORY, quality);
+	gg_image_to_jpeg (img, &buf, &size, NULL, GG_TARGET_IS_MEMORY,
+			  &options);
     if (ret != GGRAPH_OK)
 	return ret;
 
@@ -1006,7 +1187,28 @@ gGraphImageToPngFile (const void *ptr, const char *path, int compression_level,
 		      int quantization_factor, int interlaced)
 {
 /* exporting an image into a PNG compressed file */
+    return gGraphImageToPngFileEx (ptr, path, compression_level,
+				   quantization_factor, interlaced,
+				   GGRAPH_PNG_PRESET_NONE,
+				   GGRAPH_PNG_FILTER_ADAPTIVE,
+				   GGRAPH_PNG_STRATEGY_DEFAULT, 0, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageToPngFileEx (const void *ptr, const char *path,
+			int compression_level, int quantization_factor,
+			int interlaced, int preset, int filter, int strategy,
+			int window_bits, int mem_level)
+{
+/* 
+/ exporting an image into a PNG compressed file
+/ preset: GGRAPH_PNG_PRESET_NONE or GGRAPH_PNG_PRESET_FAST
+/ zero filter or strategy (and any compression_level outside 0 to 9)
+/ select the preset's own choice; anything else is always enforced
+/ window_bits and mem_level: zero means libpng's default
+*/
     gGraphImagePtr img = (gGraphImagePtr) ptr;
+    gGraphPngOptions options;
     int ret;
     FILE *out = NULL;
 
@@ -1014,6 +1216,15 @@ gGraphImageToPngFile (const void *ptr, const char *path, int compression_level,
 	return GGRAPH_INVALID_IMAGE;
     if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
 	return GGRAPH_INVALID_IMAGE;
+    gg_png_default_options (&options, preset, compression_level);
+    if (filter != 0)
+	options.filter = filter;
+    if (strategy != 0)
+	options.strategy = strategy;
+    options.window_bits = window_bits;
+    options.mem_level = mem_level;
+    if (!gg_png_check_options (&options))
+	return GGRAPH_ERROR;
 
 /* opening the output image file */
     out = fopen (path, "wb");
@@ -1021,8 +1232,8 @@ gGraphImageToPngFile (const void *ptr, const char *path, int compression_level,
 	return GGRAPH_FILE_OPEN_ERROR;
 /* compressing as PNG */
     ret =
-	gg_image_to_png (img, NULL, NULL, out, GG_TARGET_IS_FILE,
-			 compression_level, quantization_factor, interlaced, 0);
+	gg_image_to_png (img, NULL, NULL, out, GG_TARGET_IS_FILE, &options,
+			 quantization_factor, interlaced, 0);
     fclose (out);
     if (ret != GGRAPH_OK)
       {
@@ -1042,12 +1253,46 @@ gGraphImageToPngFileByStrips (const void **ptr, const char *path, int width,
 			      int compression_level, int quantization_factor)
 {
 /* exporting an image into a PNG compressed file [by strips] */
+    return gGraphImageToPngFileByStripsEx (ptr, path, width, height,
+					   color_model, bits_per_sample,
+					   num_palette, red, green, blue,
+					   compression_level,
+					   quantization_factor,
+					   GGRAPH_PNG_PRESET_NONE,
+					   GGRAPH_PNG_FILTER_ADAPTIVE,
+					   GGRAPH_PNG_STRATEGY_DEFAULT, 0, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageToPngFileByStripsEx (const void **ptr, const char *path, int width,
+				int height, int color_model,
+				int bits_per_sample, int num_palette,
+				unsigned char *red, unsigned char *green,
+				unsigned char *blue, int compression_level,
+				int quantization_factor, int preset,
+				int filter, int strategy, int window_bits,
+				int mem_level)
+{
+/* 
+/ exporting an image into a PNG compressed file [by strips]
+/ the compression options are the same as gGraphImageToPngFileEx()
+*/
     gGraphStripImagePtr img;
+    gGraphPngOptions options;
     int ret;
     int i;
     FILE *out = NULL;
 
     *ptr = NULL;
+    gg_png_default_options (&options, preset, compression_level);
+    if (filter != 0)
+	options.filter = filter;
+    if (strategy != 0)
+	options.strategy = strategy;
+    options.window_bits = window_bits;
+    options.mem_level = mem_level;
+    if (!gg_png_check_options (&options))
+	return GGRAPH_ERROR;
     if (color_model == GGRAPH_COLORSPACE_PALETTE
 	|| color_model == GGRAPH_COLORSPACE_GRAYSCALE
 	|| color_model == GGRAPH_COLORSPACE_TRUECOLOR
@@ -1150,7 +1395,7 @@ gGraphImageToPngFileByStrips (const void **ptr, const char *path, int width,
       }
 
     ret =
-	gg_image_prepare_to_png_by_strip (img, out, compression_level,
+	gg_image_prepare_to_png_by_strip (img, out, &options,
 					  quantization_factor);
     if (ret != GGRAPH_OK)
       {
@@ -1438,6 +1683,59 @@ gGraphImageToGeoTiffFileByStrips (const void **ptr, const char *path,
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphStripImageSetTiffOverviews (const void *ptr, int num_levels,
+				  double no_data_value)
+{
+/*
+/ enabling the Overviews for a TIFF being written [by strips]
+/
+/ num_levels reduced-resolution IFDs (each one halving the previous one)
+/ will be appended after the full resolution image once the last strip
+/ has been written; no_data_value is only meaningful for GRID data
+*/
+    gGraphStripImagePtr img = (gGraphStripImagePtr) ptr;
+
+    if (img == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img->signature != GG_STRIP_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    return gg_tiff_set_overviews (img, num_levels, no_data_value);
+}
+
+GGRAPH_DECLARE int
+gGraphStripImageSetTiffThreads (const void *ptr, int num_threads)
+{
+/*
+/ enabling multithreaded compression for a TIFF being written [by strips]
+/
+/ LZW or DEFLATE strips (or tiles) will be compressed by num_threads
+/ threads; must be called before writing the first strip
+*/
+    gGraphStripImagePtr img = (gGraphStripImagePtr) ptr;
+
+    if (img == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img->signature != GG_STRIP_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    return gg_tiff_set_threads (img, NULL, num_threads);
+}
+
+GGRAPH_DECLARE int
+gGraphStripImageSetTiffThreadPool (const void *ptr, const void *thread_pool)
+{
+/* enabling multithreaded compression for a TIFF [using a Thread Pool] */
+    gGraphStripImagePtr img = (gGraphStripImagePtr) ptr;
+
+    if (img == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img->signature != GG_STRIP_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return gg_tiff_set_threads (img, (gGraphThreadPoolPtr) thread_pool, 1);
+}
+
 GGRAPH_DECLARE int
 gGraphImageToBinHdrFileByStrips (const void **ptr, const char *path, int width,
 				 int height, int bits_per_sample,
@@ -1663,7 +1961,27 @@ gGraphImageToPngMemBuf (const void *ptr, void **mem_buf, int *mem_buf_size,
 			int interlaced, int is_transparent)
 {
 /* exporting an image into a PNG compressed memory buffer */
+    return gGraphImageToPngMemBufEx (ptr, mem_buf, mem_buf_size,
+				     compression_level, quantization_factor,
+				     interlaced, is_transparent,
+				     GGRAPH_PNG_PRESET_NONE,
+				     GGRAPH_PNG_FILTER_ADAPTIVE,
+				     GGRAPH_PNG_STRATEGY_DEFAULT, 0, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageToPngMemBufEx (const void *ptr, void **mem_buf, int *mem_buf_size,
+			  int compression_level, int quantization_factor,
+			  int interlaced, int is_transparent, int preset,
+			  int filter, int strategy, int window_bits,
+			  int mem_level)
+{
+/* 
+/ exporting an image into a PNG compressed memory buffer
+/ the compression options are the same as gGraphImageToPngFileEx()
+*/
     gGraphImagePtr img = (gGraphImagePtr) ptr;
+    gGraphPngOptions options;
     void *buf = NULL;
     int size;
     int ret;
@@ -1674,11 +1992,20 @@ gGraphImageToPngMemBuf (const void *ptr, void **mem_buf, int *mem_buf_size,
 	return GGRAPH_INVALID_IMAGE;
     if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
 	return GGRAPH_INVALID_IMAGE;
+    gg_png_default_options (&options, preset, compression_level);
+    if (filter != 0)
+	options.filter = filter;
+    if (strategy != 0)
+	options.strategy = strategy;
+    options.window_bits = window_bits;
+    options.mem_level = mem_level;
+    if (!gg_png_check_options (&options))
+	return GGRAPH_ERROR;
 
 /* compressing as PNG */
     ret =
 	gg_image_to_png (img, &buf, &size, NULL, GG_TARGET_IS_MEMORY,
-			 compression_level, quantization_factor, interlaced,
+			 &options, quantization_factor, interlaced,
 			 is_transparent);
     if (ret != GGRAPH_OK)
 	return ret;
@@ -1835,6 +2162,11 @@ gGraphStripImageAllocPixels (const void *ptr, int rows_per_block)
     if (!pixels)
 	return GGRAPH_INSUFFICIENT_MEMORY;
 /* freeing an already allocated buffer (if any) */
+    if (img->codec_id == GGRAPH_IMAGE_HGT
+	|| img->codec_id == GGRAPH_IMAGE_BIN_HDR
+	|| img->codec_id == GGRAPH_IMAGE_FLT_HDR
+	|| img->codec_id == GGRAPH_IMAGE_DEM_HDR)
+	gg_grid_codec_restore_pixels (img);
     if (img->pixels)
 	free (img->pixels);
     img->pixels = pixels;
@@ -2017,6 +2349,7 @@ gGraphStripImageCopyPixels (const void *in_ptr, const void *out_ptr)
 /* copying the pixels buffer between two images */
     int x;
     int y;
+    gGraphPaletteCachePtr cache = NULL;
     gGraphStripImagePtr img_in = (gGraphStripImagePtr) in_ptr;
     gGraphStripImagePtr img_out = (gGraphStripImagePtr) out_ptr;
 
@@ -2070,6 +2403,22 @@ gGraphStripImageCopyPixels (const void *in_ptr, const void *out_ptr)
 		  }
 	    }
       }
+    if (img_out->pixel_format == GG_PIXEL_PALETTE
+	&& img_in->pixel_format != GG_PIXEL_PALETTE)
+      {
+	  /* mapping any pixel to the nearest color of the output palette */
+	  if (img_out->max_palette < 1)
+	      return GGRAPH_ERROR;
+	  cache =
+	      gg_palette_cache_prepare (&(img_out->palette_cache),
+					img_out->max_palette,
+					img_out->palette_version,
+					img_out->palette_red,
+					img_out->palette_green,
+					img_out->palette_blue);
+	  if (!cache)
+	      return GGRAPH_INSUFFICIENT_MEMORY;
+      }
     for (y = 0; y < img_in->current_available_rows; y++)
       {
 	  unsigned char *p_in = img_in->pixels + (y * img_in->scanline_width);
@@ -2176,6 +2525,10 @@ gGraphStripImageCopyPixels (const void *in_ptr, const void *out_ptr)
 			    *p_out++ = red;
 			    *p_out++ = alpha;
 			}
+		      else if (img_out->pixel_format == GG_PIXEL_PALETTE)
+			  *p_out++ =
+			      gg_palette_cache_nearest (cache, red, green,
+							blue);
 		  }
 	    }
 	  img_out->current_available_rows = img_in->current_available_rows;
@@ -2183,6 +2536,180 @@ gGraphStripImageCopyPixels (const void *in_ptr, const void *out_ptr)
     return GGRAPH_OK;
 }
 
+static void
+dither_fetch_row (gGraphStripImagePtr img, int row, gGraphDitherPtr dither)
+{
+/* copying a row into the error diffusion buffer [RGB or GRAYSCALE] */
+    int x;
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
+    unsigned char *p_in = img->pixels + (row * img->scanline_width);
+    unsigned char *p_out = dither->pixels;
+    for (x = 0; x < img->width; x++)
+      {
+	  if (img->pixel_format == GG_PIXEL_RGB)
+	    {
+		red = *p_in++;
+		green = *p_in++;
+		blue = *p_in++;
+	    }
+	  else if (img->pixel_format == GG_PIXEL_RGBA)
+	    {
+		red = *p_in++;
+		green = *p_in++;
+		blue = *p_in++;
+		p_in++;         /* skipping alpha */
+	    }
+	  else if (img->pixel_format == GG_PIXEL_ARGB)
+	    {
+		p_in++;         /* skipping alpha */
+		red = *p_in++;
+		green = *p_in++;
+		blue = *p_in++;
+	    }
+	  else if (img->pixel_format == GG_PIXEL_BGR)
+	    {
+		blue = *p_in++;
+		green = *p_in++;
+		red = *p_in++;
+	    }
+	  else if (img->pixel_format == GG_PIXEL_BGRA)
+	    {
+		blue = *p_in++;
+		green = *p_in++;
+		red = *p_in++;
+		p_in++;         /* skipping alpha */
+	    }
+	  else if (img->pixel_format == GG_PIXEL_GRAYSCALE)
+	    {
+		red = *p_in++;
+		green = red;
+		blue = red;
+	    }
+	  else
+	    {
+		/* PALETTE */
+		int index = *p_in++;
+		red = img->palette_red[index];
+		green = img->palette_green[index];
+		blue = img->palette_blue[index];
+	    }
+	  if (dither->channels == 3)
+	    {
+		*p_out++ = red;
+		*p_out++ = green;
+		*p_out++ = blue;
+	    }
+	  else if (red == green && green == blue)
+	      *p_out++ = red;
+	  else
+	      *p_out++ = to_grayscale2 (red, green, blue);
+      }
+}
+
+GGRAPH_DECLARE int
+gGraphStripImageCopyPixelsDithered (const void *in_ptr, const void *out_ptr)
+{
+/*
+/ copying the pixels buffer between two images [PALETTE output]
+/ applying Floyd-Steinberg error diffusion; the pending errors are
+/ kept by the output image, so to flow across consecutive strips
+/ a BLACK & WHITE output palette will be handled as MONOCHROME
+*/
+    int y;
+    int i;
+    int black = -1;
+    int white = -1;
+    int channels = 3;
+    gGraphPaletteCachePtr cache = NULL;
+    gGraphDitherPtr dither;
+    gGraphStripImagePtr img_in = (gGraphStripImagePtr) in_ptr;
+    gGraphStripImagePtr img_out = (gGraphStripImagePtr) out_ptr;
+
+    if (img_in == NULL || img_out == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img_in->signature != GG_STRIP_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    if (img_out->signature != GG_STRIP_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+
+/* checking if the strip buffers does actually have the same size */
+    if (img_in->width == img_out->width
+	&& img_in->rows_per_block == img_out->rows_per_block)
+	;
+    else
+	return GGRAPH_ERROR;
+    if (img_in->pixel_format == GG_PIXEL_GRID)
+	return GGRAPH_INVALID_IMAGE;
+    if (img_out->pixel_format != GG_PIXEL_PALETTE || img_out->max_palette < 1)
+	return GGRAPH_INVALID_IMAGE;
+
+    if (img_out->max_palette == 2)
+      {
+	  /* checking for a MONOCHROME palette */
+	  for (i = 0; i < 2; i++)
+	    {
+		if (img_out->palette_red[i] == 0
+		    && img_out->palette_green[i] == 0
+		    && img_out->palette_blue[i] == 0)
+		    black = i;
+		if (img_out->palette_red[i] == 255
+		    && img_out->palette_green[i] == 255
+		    && img_out->palette_blue[i] == 255)
+		    white = i;
+	    }
+	  if (black >= 0 && white >= 0)
+	      channels = 1;
+      }
+    if (channels == 3)
+      {
+	  cache =
+	      gg_palette_cache_prepare (&(img_out->palette_cache),
+					img_out->max_palette,
+					img_out->palette_version,
+					img_out->palette_red,
+					img_out->palette_green,
+					img_out->palette_blue);
+	  if (!cache)
+	      return GGRAPH_INSUFFICIENT_MEMORY;
+      }
+
+    dither = img_out->dither;
+    if (dither != NULL
+	&& (dither->width != img_out->width || dither->channels != channels))
+      {
+	  gg_dither_destroy (dither);
+	  dither = NULL;
+	  img_out->dither = NULL;
+      }
+    if (dither == NULL)
+      {
+	  dither = gg_dither_create (img_out->width, channels);
+	  if (!dither)
+	      return GGRAPH_INSUFFICIENT_MEMORY;
+	  img_out->dither = dither;
+      }
+    if (dither->row != img_out->next_row)
+      {
+	  /* not contiguous to the previous strip: restarting */
+	  gg_dither_reset (dither, img_out->next_row);
+      }
+
+    for (y = 0; y < img_in->current_available_rows; y++)
+      {
+	  unsigned char *p_out =
+	      img_out->pixels + (y * img_out->scanline_width);
+	  dither_fetch_row (img_in, y, dither);
+	  if (channels == 3)
+	      gg_dither_rgb_row (dither, p_out, cache);
+	  else
+	      gg_dither_gray_row (dither, p_out, black, white);
+      }
+    img_out->current_available_rows = img_in->current_available_rows;
+    return GGRAPH_OK;
+}
+
 static int
 subset_pixels_float (gGraphStripImagePtr img_in, gGraphStripImagePtr img_out,
 		     int start_from, int row)
@@ -2484,6 +3011,72 @@ gGraphStripImageSubSetPixels (const void *in_ptr, const void *out_ptr,
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphImageResizeByStrips (const void *in_ptr, int width, int height,
+			   const void **strip_handle)
+{
+/*
+/ preparing a resized image [High Quality], accessed by strips
+/
+/ reading the next strip from the resized image will transparently read
+/ as many strips as required from the input image, which must have already
+/ allocated its pixels buffer and must not be destroyed before the resized one
+*/
+    int ret;
+    gGraphStripImagePtr img = NULL;
+    gGraphStripImagePtr img_in = (gGraphStripImagePtr) in_ptr;
+
+    *strip_handle = NULL;
+    if (img_in == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img_in->signature != GG_STRIP_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+
+    ret = gg_strip_image_resize (img_in, width, height, &img);
+    if (ret != GGRAPH_OK)
+	return ret;
+    *strip_handle = img;
+    return GGRAPH_OK;
+}
+
+GGRAPH_DECLARE int
+gGraphImageResizeToResolutionByStrips (const void *in_ptr,
+				       double pixel_x_size,
+				       double pixel_y_size, int *x_width,
+				       int *x_height,
+				       const void **strip_handle)
+{
+/* preparing a resized image [High Quality], accessed by strips */
+    int width;
+    int height;
+    double ww;
+    double wh;
+    int ret;
+    gGraphStripImagePtr img_in = (gGraphStripImagePtr) in_ptr;
+
+    *strip_handle = NULL;
+    *x_width = 0;
+    *x_height = 0;
+    if (img_in == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img_in->signature != GG_STRIP_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    if (pixel_x_size <= 0.0 || pixel_y_size <= 0.0)
+	return GGRAPH_ERROR;
+
+    ww = (double) (img_in->width) * img_in->pixel_x_size;
+    wh = (double) (img_in->height) * img_in->pixel_y_size;
+    width = (int) (ww / pixel_x_size);
+    height = (int) (wh / pixel_y_size);
+
+    ret = gGraphImageResizeByStrips (img_in, width, height, strip_handle);
+    if (ret != GGRAPH_OK)
+	return ret;
+    *x_width = width;
+    *x_height = height;
+    return GGRAPH_OK;
+}
+
 GGRAPH_DECLARE int
 gGraphReadNextStrip (const void *ptr, int *progress)
 {
@@ -2514,6 +3107,8 @@ gGraphReadNextStrip (const void *ptr, int *progress)
 	      return gg_image_strip_read_from_dem_grid (img, progress);
 	  if (img->codec_id == GGRAPH_IMAGE_ASCII_GRID)
 	      return gg_image_strip_read_from_ascii_grid (img, progress);
+	  if (img->codec_id == GG_STRIP_RESIZER)
+	      return gg_image_strip_read_from_resizer (img, progress);
       }
 
     return GGRAPH_INVALID_IMAGE;
@@ -2693,45 +3288,10 @@ match_palette2 (const gGraphStripImagePtr img, unsigned char r, unsigned char g,
 		unsigned char b)
 {
 /* handling palette colors */
-    int index;
-    double min_dist = DBL_MAX;
-    double dist;
-    int min_index;
-    for (index = 0; index < img->max_palette; index++)
-      {
-	  /* searching if already defined */
-	  if (img->palette_red[index] == r && img->palette_green[index] == g
-	      && img->palette_blue[index] == b)
-	      return (unsigned char) index;
-      }
-    if (img->max_palette < 255)
-      {
-	  /* inserting a new palette entry */
-	  unsigned char i = img->max_palette;
-	  img->max_palette += 1;
-	  img->palette_red[i] = r;
-	  img->palette_green[i] = g;
-	  img->palette_blue[i] = b;
-	  return i;
-      }
-/* all right, the palette is already fully populated */
-    for (index = 0; index < img->max_palette; index++)
-      {
-	  /* computing the minimal euclidean distance */
-	  dist =
-	      sqrt (((img->palette_red[index] - r) * (img->palette_red[index] -
-						      r)) +
-		    ((img->palette_green[index] -
-		      g) * (img->palette_green[index] - g)) +
-		    ((img->palette_blue[index] -
-		      b) * (img->palette_blue[index] - b)));
-	  if (dist < min_dist)
-	    {
-		min_dist = dist;
-		min_index = index;
-	    }
-      }
-    return (unsigned char) min_index;
+    return gg_palette_cache_match (&(img->palette_cache), &(img->max_palette),
+				   img->palette_version, img->palette_red,
+				   img->palette_green, img->palette_blue, r,
+				   g, b);
 }
 
 GGRAPH_DECLARE int
@@ -3104,7 +3664,7 @@ gGraphImageColorSpaceOptimize (const void *ptr)
     if (gg_is_image_monochrome (img) == GGRAPH_TRUE)
       {
 	  /* attempting to optimize into MONOCHROME */
-	  return gg_convert_image_to_monochrome (img);
+	  return gg_convert_image_to_monochrome (img, 0);
       }
     if (gg_is_image_grayscale (img) == GGRAPH_TRUE)
       {
@@ -3241,7 +3801,19 @@ gGraphImageResampleAsMonochrome (const void *ptr)
     if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
 	return GGRAPH_INVALID_IMAGE;
 
-    return gg_convert_image_to_monochrome (img);
+    return gg_convert_image_to_monochrome (img, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResampleAsMonochromeDithered (const void *ptr)
+{
+/* applying BILEVEL quantization [Floyd-Steinberg dithering] */
+    gGraphImagePtr img = (gGraphImagePtr) ptr;
+
+    if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+
+    return gg_convert_image_to_monochrome (img, 1);
 }
 
 GGRAPH_DECLARE int
@@ -3253,7 +3825,54 @@ gGraphImageResampleAsPalette (const void *ptr, int num_colors)
     if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
 	return GGRAPH_INVALID_IMAGE;
 
-    return gg_image_resample_as_palette (img, num_colors);
+    return gg_image_resample_as_palette (img, num_colors, 1, NULL, 1, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResampleAsPaletteDithered (const void *ptr, int num_colors)
+{
+/* applying quantization [PALETTE colorspace - Floyd-Steinberg dithering] */
+    gGraphImagePtr img = (gGraphImagePtr) ptr;
+
+    if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+
+    return gg_image_resample_as_palette (img, num_colors, 1, NULL, 1, 1);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResampleAsPaletteByThreads (const void *ptr, int num_colors,
+				       int sampling, int num_threads)
+{
+/*
+/ applying quantization in order to fit into PALETTE colorspace
+/ [multithreaded; the histogram will be built by sampling a pixel
+/ every 'sampling' along both directions]
+*/
+    gGraphImagePtr img = (gGraphImagePtr) ptr;
+
+    if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+
+    return gg_image_resample_as_palette (img, num_colors, sampling, NULL,
+					 num_threads, 0);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResampleAsPaletteByThreadPool (const void *ptr, int num_colors,
+					  int sampling, const void *thread_pool)
+{
+/* applying quantization [PALETTE colorspace - using a Thread Pool] */
+    gGraphImagePtr img = (gGraphImagePtr) ptr;
+
+    if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+
+    return gg_image_resample_as_palette (img, num_colors, sampling,
+					 (gGraphThreadPoolPtr) thread_pool, 1,
+					 0);
 }
 
 GGRAPH_DECLARE int
@@ -3723,9 +4342,9 @@ gGraphReadWorldFile (const char *path, double *ul_x, double *ul_y,
     return GGRAPH_ERROR;
 }
 
-GGRAPH_DECLARE int
-gGraphImageResizeNormal (const void *orig, const void **dest, int width,
-			 int height)
+static int
+image_resize_normal (const void *orig, const void **dest, int width,
+		     int height, gGraphThreadPoolPtr pool, int num_threads)
 {
 /* generating a resized image [Normal Quality] */
     gGraphImagePtr img2 = NULL;
@@ -3744,9 +4363,9 @@ gGraphImageResizeNormal (const void *orig, const void **dest, int width,
     if (!img2)
 	return GGRAPH_INSUFFICIENT_MEMORY;
     if (img->pixel_format == GG_PIXEL_GRID)
-	gg_grid_resize (img2, img);
+	gg_grid_resize (img2, img, pool, num_threads);
     else
-	gg_image_resize (img2, img);
+	gg_image_resize (img2, img, pool, num_threads);
     gg_image_clone_georeferencing (img2, img);
     *dest = img2;
 
@@ -3754,8 +4373,61 @@ gGraphImageResizeNormal (const void *orig, const void **dest, int width,
 }
 
 GGRAPH_DECLARE int
-gGraphImageResizeHighQuality (const void *orig, const void **dest, int width,
-			      int height)
+gGraphImageResizeNormal (const void *orig, const void **dest, int width,
+			 int height)
+{
+/* generating a resized image [Normal Quality] */
+    return image_resize_normal (orig, dest, width, height, NULL, 1);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResizeNormalByThreads (const void *orig, const void **dest,
+				  int width, int height, int num_threads)
+{
+/* generating a resized image [Normal Quality - multithreaded] */
+    return image_resize_normal (orig, dest, width, height, NULL, num_threads);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResizeNormalByThreadPool (const void *orig, const void **dest,
+				     int width, int height,
+				     const void *thread_pool)
+{
+/* generating a resized image [Normal Quality - using a Thread Pool] */
+    *dest = NULL;
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return image_resize_normal (orig, dest, width, height,
+				(gGraphThreadPoolPtr) thread_pool, 1);
+}
+
+static gGraphImagePtr
+image_resize_high_quality (const gGraphImagePtr img, int width, int height,
+			   gGraphThreadPoolPtr pool, int num_threads)
+{
+/* generating a resized image [High Quality] */
+    gGraphImagePtr img2 =
+	gg_image_create (img->pixel_format, width, height, img->bits_per_sample,
+			 img->samples_per_pixel, img->sample_format,
+			 img->srs_name, img->proj4text);
+    if (!img2)
+	return NULL;
+    img2->no_data_value = img->no_data_value;
+    if (gg_image_resample (img2, img, pool, num_threads) != GGRAPH_OK)
+      {
+	  /* falling back to the plain interpolating thumbnail */
+	  if (img->pixel_format == GG_PIXEL_GRID)
+	      gg_make_grid_thumbnail (img2, img);
+	  else
+	      gg_make_thumbnail (img2, img);
+      }
+    gg_image_clone_georeferencing (img2, img);
+    return img2;
+}
+
+static int
+image_resize_to_size (const void *orig, const void **dest, int width,
+		      int height, gGraphThreadPoolPtr pool, int num_threads)
 {
 /* generating a resized image [High Quality] */
     gGraphImagePtr img2 = NULL;
@@ -3767,26 +4439,49 @@ gGraphImageResizeHighQuality (const void *orig, const void **dest, int width,
     if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
 	return GGRAPH_ERROR;
 
-    img2 =
-	gg_image_create (img->pixel_format, width, height, img->bits_per_sample,
-			 img->samples_per_pixel, img->sample_format,
-			 img->srs_name, img->proj4text);
+    img2 = image_resize_high_quality (img, width, height, pool, num_threads);
     if (!img2)
 	return GGRAPH_INSUFFICIENT_MEMORY;
-    if (img->pixel_format == GG_PIXEL_GRID)
-	gg_make_grid_thumbnail (img2, img);
-    else
-	gg_make_thumbnail (img2, img);
-    gg_image_clone_georeferencing (img2, img);
     *dest = img2;
 
     return GGRAPH_OK;
 }
 
 GGRAPH_DECLARE int
-gGraphImageResizeToResolution (const void *orig, const void **dest,
-			       double pixel_x_size, double pixel_y_size,
-			       int *x_width, int *x_height)
+gGraphImageResizeHighQuality (const void *orig, const void **dest, int width,
+			      int height)
+{
+/* generating a resized image [High Quality] */
+    return image_resize_to_size (orig, dest, width, height, NULL, 1);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResizeHighQualityByThreads (const void *orig, const void **dest,
+				       int width, int height, int num_threads)
+{
+/* generating a resized image [High Quality - multithreaded] */
+    return image_resize_to_size (orig, dest, width, height, NULL,
+				 num_threads);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResizeHighQualityByThreadPool (const void *orig,
+					  const void **dest, int width,
+					  int height, const void *thread_pool)
+{
+/* generating a resized image [High Quality - using a Thread Pool] */
+    *dest = NULL;
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return image_resize_to_size (orig, dest, width, height,
+				 (gGraphThreadPoolPtr) thread_pool, 1);
+}
+
+static int
+image_resize_to_resolution (const void *orig, const void **dest,
+			    double pixel_x_size, double pixel_y_size,
+			    int *x_width, int *x_height,
+			    gGraphThreadPoolPtr pool, int num_threads)
 {
 /* generating a resized image [High Quality] */
     int width;
@@ -3809,17 +4504,9 @@ gGraphImageResizeToResolution (const void *orig, const void **dest,
     width = (int) (ww / pixel_x_size);
     height = (int) (wh / pixel_y_size);
 
-    img2 =
-	gg_image_create (img->pixel_format, width, height, img->bits_per_sample,
-			 img->samples_per_pixel, img->sample_format,
-			 img->srs_name, img->proj4text);
+    img2 = image_resize_high_quality (img, width, height, pool, num_threads);
     if (!img2)
 	return GGRAPH_INSUFFICIENT_MEMORY;
-    if (img->pixel_format == GG_PIXEL_GRID)
-	gg_make_grid_thumbnail (img2, img);
-    else
-	gg_make_thumbnail (img2, img);
-    gg_image_clone_georeferencing (img2, img);
     *dest = img2;
     *x_width = width;
     *x_height = height;
@@ -3827,6 +4514,48 @@ gGraphImageResizeToResolution (const void *orig, const void **dest,
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphImageResizeToResolution (const void *orig, const void **dest,
+			       double pixel_x_size, double pixel_y_size,
+			       int *x_width, int *x_height)
+{
+/* generating a resized image [High Quality] */
+    return image_resize_to_resolution (orig, dest, pixel_x_size,
+				       pixel_y_size, x_width, x_height, NULL,
+				       1);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResizeToResolutionByThreads (const void *orig, const void **dest,
+					double pixel_x_size,
+					double pixel_y_size, int *x_width,
+					int *x_height, int num_threads)
+{
+/* generating a resized image [High Quality - multithreaded] */
+    return image_resize_to_resolution (orig, dest, pixel_x_size,
+				       pixel_y_size, x_width, x_height, NULL,
+				       num_threads);
+}
+
+GGRAPH_DECLARE int
+gGraphImageResizeToResolutionByThreadPool (const void *orig,
+					   const void **dest,
+					   double pixel_x_size,
+					   double pixel_y_size, int *x_width,
+					   int *x_height,
+					   const void *thread_pool)
+{
+/* generating a resized image [High Quality - using a Thread Pool] */
+    *dest = NULL;
+    *x_width = 0;
+    *x_height = 0;
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return image_resize_to_resolution (orig, dest, pixel_x_size,
+				       pixel_y_size, x_width, x_height,
+				       (gGraphThreadPoolPtr) thread_pool, 1);
+}
+
 GGRAPH_DECLARE int
 gGraphImageSubSet (const void *orig, const void **dest, int upper_left_x,
 		   int upper_left_y, int width, int height)
@@ -4357,12 +5086,26 @@ GGRAPH_DECLARE int
 gGraphImageFromRawMemBuf (const void *mem_buf, int mem_buf_size,
 			  const void **image_handle)
 {
-/* importing an image from a RAW un-compressed memory buffer */
+/* importing an image from a RAW memory buffer */
     gGraphImagePtr img = NULL;
     int ret;
 
     *image_handle = NULL;
-    ret = gg_image_from_raw (mem_buf_size, mem_buf, &img);
+    if (gg_is_adam7_compressed (mem_buf, mem_buf_size))
+      {
+	  /* transparently uncompressing */
+	  void *raw_buf;
+	  int raw_buf_size;
+	  ret =
+	      gg_adam7_uncompress (mem_buf, mem_buf_size, &raw_buf,
+				   &raw_buf_size);
+	  if (ret != GGRAPH_OK)
+	      return ret;
+	  ret = gg_image_from_raw (raw_buf_size, raw_buf, &img);
+	  free (raw_buf);
+      }
+    else
+	ret = gg_image_from_raw (mem_buf_size, mem_buf, &img);
     if (ret != GGRAPH_OK)
 	return ret;
 
@@ -4370,22 +5113,24 @@ gGraphImageFromRawMemBuf (const void *mem_buf, int mem_buf_size,
     return GGRAPH_OK;
 }
 
-GGRAPH_DECLARE int
-gGraphIsRawImage (const void *mem_buf, int mem_buf_size)
+static int
+raw_signatures (const unsigned char *start, const unsigned char *end)
 {
-/* checks if this one is a RAW un-compressed memory buffer */
-    unsigned char *p = (unsigned char *) mem_buf;
+/*
+/ checks the magic signatures of some RAW memory buffer
+/ end is NULL when only the start signature is available; any
+/ RAW end signature always follows its start signature by 10
+*/
     short start_signature;
     short end_signature;
     int endian_arch = gg_endian_arch ();
 
-    if (mem_buf_size < (int) (sizeof (short) * 4))
-	return GGRAPH_ERROR;
-
 /* checking the magic signature */
-    start_signature = gg_import_int16 (p, 1, endian_arch);
-    p = (unsigned char *) mem_buf + mem_buf_size - sizeof (short);
-    end_signature = gg_import_int16 (p, 1, endian_arch);
+    start_signature = gg_import_int16 (start, 1, endian_arch);
+    if (end)
+	end_signature = gg_import_int16 (end, 1, endian_arch);
+    else
+	end_signature = start_signature + 10;
     if (start_signature == GG_MONOCHROME_START
 	&& end_signature == GG_MONOCHROME_END)
 	return GGRAPH_OK;
@@ -4471,10 +5216,11 @@ gGraphIsRawImage (const void *mem_buf, int mem_buf_size)
 	&& end_signature == GG_ADAM7_5_DOUBLE_END)
 	return GGRAPH_OK;
 
-    p = (unsigned char *) mem_buf;
-    start_signature = gg_import_int16 (p, 0, endian_arch);
-    p = (unsigned char *) mem_buf + mem_buf_size - sizeof (short);
-    end_signature = gg_import_int16 (p, 0, endian_arch);
+    start_signature = gg_import_int16 (start, 0, endian_arch);
+    if (end)
+	end_signature = gg_import_int16 (end, 0, endian_arch);
+    else
+	end_signature = start_signature + 10;
     if (start_signature == GG_ADAM7_0_RGB_START
 	&& end_signature == GG_ADAM7_0_RGB_END)
 	return GGRAPH_OK;
@@ -4587,6 +5333,27 @@ gGraphIsRawImage (const void *mem_buf, int mem_buf_size)
     return GGRAPH_ERROR;
 }
 
+GGRAPH_DECLARE int
+gGraphIsRawImage (const void *mem_buf, int mem_buf_size)
+{
+/* checks if this one is a RAW (possibly compressed) memory buffer */
+    unsigned char *p = (unsigned char *) mem_buf;
+    unsigned char head[2];
+
+    if (gg_is_adam7_compressed (mem_buf, mem_buf_size))
+      {
+	  /* checking the envelope and the start signature alone */
+	  if (gg_adam7_uncompress_head
+	      (mem_buf, mem_buf_size, head, sizeof (short)) != GGRAPH_OK)
+	      return GGRAPH_ERROR;
+	  return raw_signatures (head, NULL);
+      }
+
+    if (mem_buf_size < (int) (sizeof (short) * 4))
+	return GGRAPH_ERROR;
+    return raw_signatures (p, p + mem_buf_size - sizeof (short));
+}
+
 GGRAPH_DECLARE int
 gGraphOutputPixelsToStripImage (const void *ptr_in, const void *ptr_out,
 				int in_row, int out_row)
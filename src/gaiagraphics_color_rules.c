@@ -30,19 +30,19 @@
 #include <math.h>
 #include <stdlib.h>
 
-#ifdef _WIN32
-#include <windows.h>
-#include <process.h>
-#include <io.h>
-#else
-#include <pthread.h>
-#include <unistd.h>
-#endif
-
 #include "gaiagraphics.h"
 #include "gaiagraphics_internals.h"
 
-#define GG_MAX_THREADS		64
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+/* SIMD kernels (runtime dispatched) are supported */
+#define GG_SHADED_RELIEF_SIMD
+#define GG_SIMD_TARGET(isa)	__attribute__ ((target (isa)))
+#include <immintrin.h>
+#endif
+
+/* how many Shaded Relief pixels are computed by a single kernel call */
+#define GG_SHADED_RELIEF_CHUNK	512
 
 #define LANDSAT_RED		1
 #define LANDSAT_GREEN	2
@@ -60,6 +60,10 @@ struct thread_grid_render
     int base;
     int num_pixels;
     unsigned char *p_rgb;
+    gGraphStripImagePtr img_in;
+    gGraphStripImagePtr img_out;
+    int min_row;
+    int max_row;
 };
 
 struct thread_shaded_relief_render
@@ -224,6 +228,11 @@ gg_color_map_create (void)
     ptr->not_found_blue = 255;
     ptr->num_entries = 0;
     ptr->array = NULL;
+    ptr->int16_lut = NULL;
+    ptr->num_buckets = 0;
+    ptr->bucket_min = 0.0;
+    ptr->bucket_scale = 0.0;
+    ptr->buckets = NULL;
     return ptr;
 }
 
@@ -244,6 +253,10 @@ gg_color_map_destroy (gGraphColorMapPtr ptr)
       }
     if (ptr->array)
 	free (ptr->array);
+    if (ptr->int16_lut)
+	free (ptr->int16_lut);
+    if (ptr->buckets)
+	free (ptr->buckets);
     free (ptr);
 }
 
@@ -990,6 +1003,102 @@ resolve_interval (gGraphColorMapPtr ptr, double min, double max,
     return GGRAPH_OK;
 }
 
+static gGraphColorMapEntryPtr
+color_map_search (gGraphColorMapPtr map, double value)
+{
+/* dicotomic search: identifying the Color Entry corresponding to a value */
+    gGraphColorMapEntryPtr *ret;
+    gGraphColorMapEntry val;
+    val.min = value;
+    val.max = value;
+    ret =
+	(gGraphColorMapEntryPtr *) bsearch (&val, map->array,
+					    map->num_entries,
+					    sizeof (gGraphColorMapEntryPtr),
+					    cmp_color_rules2);
+    if (!ret)
+	return NULL;
+    return *ret;
+}
+
+static void
+color_map_compile (gGraphColorMapPtr map)
+{
+/* 
+/ compiling the Color Map lookup tables:
+/
+/ - a dense RGB table covering any possible INT16 or UINT16 value
+/ - a quantized table of candidate Entries supporting any other value
+/   (only if Entries don't overlap; a candidate Entry is accepted only
+/   when the value lies strictly inside its range, so boundary values
+/   are always resolved by the exact dicotomic search)
+*/
+    int i;
+    int value;
+    unsigned char *p_lut;
+    double min;
+    double max;
+    gGraphColorMapEntryPtr entry;
+
+    if (map->int16_lut)
+	free (map->int16_lut);
+    map->int16_lut = NULL;
+    if (map->buckets)
+	free (map->buckets);
+    map->buckets = NULL;
+    map->num_buckets = 0;
+    if (map->num_entries <= 0)
+	return;
+
+    map->int16_lut =
+	malloc (3 * (GG_COLOR_MAP_INT16_MAX - GG_COLOR_MAP_INT16_MIN + 1));
+    if (map->int16_lut)
+      {
+	  p_lut = map->int16_lut;
+	  for (value = GG_COLOR_MAP_INT16_MIN;
+	       value <= GG_COLOR_MAP_INT16_MAX; value++)
+	    {
+		entry = color_map_search (map, value);
+		if (entry)
+		  {
+		      *p_lut++ = entry->red;
+		      *p_lut++ = entry->green;
+		      *p_lut++ = entry->blue;
+		  }
+		else
+		  {
+		      *p_lut++ = map->not_found_red;
+		      *p_lut++ = map->not_found_green;
+		      *p_lut++ = map->not_found_blue;
+		  }
+	    }
+      }
+
+    for (i = 1; i < map->num_entries; i++)
+      {
+	  /* checking for overlapping Entries */
+	  if (map->array[i - 1]->max > map->array[i]->min)
+	      return;
+      }
+    min = map->array[0]->min;
+    max = map->array[map->num_entries - 1]->max;
+    if (!(max > min) || (max - min) > DBL_MAX)
+	return;
+    map->buckets =
+	malloc (sizeof (gGraphColorMapEntryPtr) * GG_COLOR_MAP_BUCKETS);
+    if (!map->buckets)
+	return;
+    map->num_buckets = GG_COLOR_MAP_BUCKETS;
+    map->bucket_min = min;
+    map->bucket_scale = (double) GG_COLOR_MAP_BUCKETS / (max - min);
+    for (i = 0; i < GG_COLOR_MAP_BUCKETS; i++)
+      {
+	  /* the candidate Entry is the one matching the bucket's middle */
+	  double middle = min + (((double) i + 0.5) / map->bucket_scale);
+	  map->buckets[i] = color_map_search (map, middle);
+      }
+}
+
 static void
 color_map_prepare (gGraphColorMapPtr map)
 {
@@ -1024,6 +1133,7 @@ color_map_prepare (gGraphColorMapPtr map)
 /* sorting the array */
     qsort (map->array, map->num_entries, sizeof (gGraphColorMapEntryPtr),
 	   cmp_color_rules1);
+    color_map_compile (map);
 }
 
 GGRAPH_DECLARE int
@@ -1180,11 +1290,7 @@ match_color (gGraphColorMapPtr map, double value, double no_data,
 	     unsigned char *red, unsigned char *green, unsigned char *blue)
 {
 /* identifying a color corresponding to a value */
-    gGraphColorMapEntryPtr *ret;
     gGraphColorMapEntryPtr p;
-    gGraphColorMapEntry val;
-    val.min = value;
-    val.max = value;
     if (value == no_data)
       {
 	  /* NoData */
@@ -1193,13 +1299,25 @@ match_color (gGraphColorMapPtr map, double value, double no_data,
 	  *blue = map->no_data_blue;
 	  return;
       }
+    if (map->buckets != NULL)
+      {
+	  /* attempting to use the quantized table */
+	  double pos = (value - map->bucket_min) * map->bucket_scale;
+	  if (pos >= 0.0 && pos < (double) (map->num_buckets))
+	    {
+		p = map->buckets[(int) pos];
+		if (p != NULL && value > p->min && value < p->max)
+		  {
+		      *red = p->red;
+		      *green = p->green;
+		      *blue = p->blue;
+		      return;
+		  }
+	    }
+      }
 /* dicotomic search */
-    ret =
-	(gGraphColorMapEntryPtr *) bsearch (&val, map->array,
-					    map->num_entries,
-					    sizeof (gGraphColorMapEntryPtr),
-					    cmp_color_rules2);
-    if (!ret)
+    p = color_map_search (map, value);
+    if (!p)
       {
 	  /* not found */
 	  *red = map->not_found_red;
@@ -1208,12 +1326,59 @@ match_color (gGraphColorMapPtr map, double value, double no_data,
 	  return;
       }
 /* ok, match found */
-    p = *ret;
     *red = p->red;
     *green = p->green;
     *blue = p->blue;
 }
 
+static void
+do_grid_render_int16 (struct thread_grid_render *params)
+{
+/* rendering an INT16 or UINT16 GRID pixels block [lookup table] */
+    short *p_int16 = NULL;
+    unsigned short *p_uint16 = NULL;
+    unsigned char *p_out;
+    const unsigned char *p_lut;
+    const unsigned char *lut = params->color_map->int16_lut;
+    int value;
+    int no_data = 0;
+    int has_no_data = 0;
+    int x;
+
+/* NoData can only match an integer value */
+    if (params->no_data_value >= GG_COLOR_MAP_INT16_MIN
+	&& params->no_data_value <= GG_COLOR_MAP_INT16_MAX)
+      {
+	  no_data = (int) (params->no_data_value);
+	  if ((double) no_data == params->no_data_value)
+	      has_no_data = 1;
+      }
+    if (params->sample_format == GGRAPH_SAMPLE_INT)
+	p_int16 = (short *) (params->pixels) + params->base;
+    else
+	p_uint16 = (unsigned short *) (params->pixels) + params->base;
+    p_out = params->p_rgb + (params->base * 3);
+    for (x = 0; x < params->num_pixels; x++)
+      {
+	  if (p_int16)
+	      value = *p_int16++;
+	  else
+	      value = *p_uint16++;
+	  if (has_no_data && value == no_data)
+	    {
+		/* NoData */
+		*p_out++ = params->color_map->no_data_red;
+		*p_out++ = params->color_map->no_data_green;
+		*p_out++ = params->color_map->no_data_blue;
+		continue;
+	    }
+	  p_lut = lut + ((value - GG_COLOR_MAP_INT16_MIN) * 3);
+	  *p_out++ = *p_lut++;
+	  *p_out++ = *p_lut++;
+	  *p_out++ = *p_lut;
+      }
+}
+
 static void
 do_grid_render (struct thread_grid_render *params)
 {
@@ -1231,6 +1396,14 @@ do_grid_render (struct thread_grid_render *params)
     double value;
     int x;
 
+    if (params->bits_per_sample == 16 && params->color_map->int16_lut != NULL
+	&& (params->sample_format == GGRAPH_SAMPLE_INT
+	    || params->sample_format == GGRAPH_SAMPLE_UINT))
+      {
+	  /* using the lookup table */
+	  do_grid_render_int16 (params);
+	  return;
+      }
     if (params->sample_format == GGRAPH_SAMPLE_FLOAT)
       {
 	  if (params->bits_per_sample == 32)
@@ -1302,45 +1475,39 @@ do_grid_render (struct thread_grid_render *params)
       }
 }
 
-#ifdef _WIN32
-static DWORD WINAPI
-#else
-static void *
-#endif
+static void
 grid_render (void *arg)
 {
 /* threaded function: rendering a GRID pixels block */
+    int y;
     struct thread_grid_render *params = (struct thread_grid_render *) arg;
-    do_grid_render (params);
-#ifdef _WIN32
-    return 0;
-#else
-    pthread_exit (NULL);
-#endif
+    gGraphStripImagePtr img_in = params->img_in;
+    gGraphStripImagePtr img_out = params->img_out;
+    int pixel_size = img_in->bits_per_sample / 8;
+    for (y = params->min_row; y < params->max_row; y++)
+      {
+	  /* rendering a whole row sub-set */
+	  params->pixels = img_in->pixels + (y * img_in->width * pixel_size);
+	  params->p_rgb = img_out->pixels + (y * img_out->scanline_width);
+	  do_grid_render (params);
+      }
 }
 
-GGRAPH_DECLARE int
-gGraphStripImageRenderGridPixels (const void *in_ptr, const void *out_ptr,
-				  const void *map, int num_threads)
+static int
+render_grid_pixels (const void *in_ptr, const void *out_ptr, const void *map,
+		    gGraphThreadPoolPtr pool, int num_threads)
 {
 /* rendering GRID pixels between two images */
-    int y;
-    short *p_int16;
-    unsigned short *p_uint16;
-    int *p_int32;
-    unsigned int *p_uint32;
-    float *p_float;
-    double *p_double;
-    void *p_void;
-    unsigned char *p_out;
     int nt;
-    struct thread_grid_render threads[GG_MAX_THREADS];
-#ifdef _WIN32
-    HANDLE thread_handles[GG_MAX_THREADS];
-    DWORD dwThreadIdArray[GG_MAX_THREADS];
-#else
-    pthread_t thread_ids[GG_MAX_THREADS];
-#endif
+    int num_jobs;
+    int row_blocks;
+    int col_blocks;
+    int rows_per_block;
+    int pixels_per_block;
+    int num_rows;
+    int min_row;
+    int base;
+    struct thread_grid_render jobs[GG_MAX_THREADS * 2];
     gGraphStripImagePtr img_in = (gGraphStripImagePtr) in_ptr;
     gGraphStripImagePtr img_out = (gGraphStripImagePtr) out_ptr;
     gGraphColorMapPtr color_map = (gGraphColorMapPtr) map;
@@ -1356,6 +1523,8 @@ gGraphStripImageRenderGridPixels (const void *in_ptr, const void *out_ptr,
     if (color_map->signature != GG_COLOR_MAP_MAGIC_SIGNATURE)
 	return GGRAPH_INVALID_COLOR_MAP;
 
+    if (pool != NULL)
+	num_threads = gg_thread_pool_size (pool);
     if (num_threads > GG_MAX_THREADS)
 	num_threads = GG_MAX_THREADS;
     if (num_threads < 1)
@@ -1372,117 +1541,74 @@ gGraphStripImageRenderGridPixels (const void *in_ptr, const void *out_ptr,
     if (img_out->pixel_format != GG_PIXEL_RGB)
 	return GGRAPH_INVALID_IMAGE;
 
-    for (y = 0; y < img_in->current_available_rows; y++)
-      {
-	  if (img_in->sample_format == GGRAPH_SAMPLE_FLOAT)
+    num_rows = img_in->current_available_rows;
+    if (num_rows > 0 && img_in->width > 0)
+      {
+	  /*
+	     / splitting the whole strip into blocks of rows;
+	     / each row will be further split into sub-sets
+	     / only when there are less rows than threads
+	   */
+	  row_blocks = num_threads;
+	  if (row_blocks > num_rows)
+	      row_blocks = num_rows;
+	  col_blocks = (num_threads + row_blocks - 1) / row_blocks;
+	  if (col_blocks > img_in->width)
+	      col_blocks = img_in->width;
+	  rows_per_block = (num_rows + row_blocks - 1) / row_blocks;
+	  pixels_per_block = (img_in->width + col_blocks - 1) / col_blocks;
+	  num_jobs = 0;
+	  for (min_row = 0; min_row < num_rows; min_row += rows_per_block)
 	    {
-		if (img_in->bits_per_sample == 32)
+		for (base = 0; base < img_in->width; base += pixels_per_block)
 		  {
-		      p_float = (float *) (img_in->pixels);
-		      p_float += y * img_in->width;
-		      p_void = p_float;
-		  }
-		else
-		  {
-		      p_double = (double *) (img_in->pixels);
-		      p_double += y * img_in->width;
-		      p_void = p_double;
-		  }
-	    }
-	  if (img_in->sample_format == GGRAPH_SAMPLE_INT)
-	    {
-		if (img_in->bits_per_sample == 32)
-		  {
-		      p_int32 = (int *) (img_in->pixels);
-		      p_int32 += y * img_in->width;
-		      p_void = p_int32;
-		  }
-		else
-		  {
-		      p_int16 = (short *) (img_in->pixels);
-		      p_int16 += y * img_in->width;
-		      p_void = p_int16;
+		      nt = num_jobs++;
+		      jobs[nt].color_map = color_map;
+		      jobs[nt].no_data_value = img_in->no_data_value;
+		      jobs[nt].sample_format = img_in->sample_format;
+		      jobs[nt].bits_per_sample = img_in->bits_per_sample;
+		      jobs[nt].pixels = NULL;
+		      jobs[nt].base = base;
+		      jobs[nt].num_pixels = pixels_per_block;
+		      if (base + pixels_per_block > img_in->width)
+			  jobs[nt].num_pixels = img_in->width - base;
+		      jobs[nt].p_rgb = NULL;
+		      jobs[nt].img_in = img_in;
+		      jobs[nt].img_out = img_out;
+		      jobs[nt].min_row = min_row;
+		      jobs[nt].max_row = min_row + rows_per_block;
+		      if (jobs[nt].max_row > num_rows)
+			  jobs[nt].max_row = num_rows;
 		  }
 	    }
-	  if (img_in->sample_format == GGRAPH_SAMPLE_UINT)
-	    {
-		if (img_in->bits_per_sample == 32)
-		  {
-		      p_uint32 = (unsigned int *) (img_in->pixels);
-		      p_uint32 += y * img_in->width;
-		      p_void = p_uint32;
-		  }
-		else
-		  {
-		      p_uint16 = (unsigned short *) (img_in->pixels);
-		      p_uint16 += y * img_in->width;
-		      p_void = p_uint16;
-		  }
-	    }
-	  p_out = img_out->pixels + (y * img_out->scanline_width);
-
-	  if (num_threads < 2)
-	    {
-		/* not using multithreading */
-		threads[0].color_map = color_map;
-		threads[0].no_data_value = img_in->no_data_value;
-		threads[0].sample_format = img_in->sample_format;
-		threads[0].bits_per_sample = img_in->bits_per_sample;
-		threads[0].pixels = p_void;
-		threads[0].base = 0;
-		threads[0].num_pixels = img_in->width;
-		threads[0].p_rgb = p_out;
-		do_grid_render (&(threads[0]));
-	    }
-	  else
-	    {
-		/* using concurrent threads */
-		int base = 0;
-		int pixels_per_thread = img_in->width / num_threads;
-		if ((pixels_per_thread * num_threads) < img_in->width)
-		    pixels_per_thread++;
-		for (nt = 0; nt < num_threads; nt++)
-		  {
-		      int num_pixels;
-		      threads[nt].color_map = color_map;
-		      threads[nt].no_data_value = img_in->no_data_value;
-		      threads[nt].sample_format = img_in->sample_format;
-		      threads[nt].bits_per_sample = img_in->bits_per_sample;
-		      threads[nt].pixels = p_void;
-		      threads[nt].base = base;
-		      num_pixels = pixels_per_thread;
-		      if (base + pixels_per_thread > img_in->width)
-			  num_pixels = img_in->width - base;
-		      threads[nt].num_pixels = num_pixels;
-		      threads[nt].p_rgb = p_out;
-		      base += pixels_per_thread;
-		      if (num_pixels > 0)
-			{
-#ifdef _WIN32
-			    thread_handles[nt] =
-				CreateThread (NULL, 0, grid_render,
-					      &(threads[nt]), 0,
-					      &dwThreadIdArray[nt]);
-#else
-			    pthread_create (&(thread_ids[nt]), NULL,
-					    grid_render, &(threads[nt]));
-#endif
-			}
-		  }
-		/* waiting until any concurrent thread terminates */
-#ifdef _WIN32
-		WaitForMultipleObjects (num_threads, thread_handles, TRUE,
-					INFINITE);
-#else
-		for (nt = 0; nt < num_threads; nt++)
-		    pthread_join (thread_ids[nt], NULL);
-#endif
-	    }
+	  gg_thread_pool_run (pool, num_threads, grid_render, jobs,
+			      sizeof (struct thread_grid_render), num_jobs);
       }
     img_out->current_available_rows = img_in->current_available_rows;
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphStripImageRenderGridPixels (const void *in_ptr, const void *out_ptr,
+				  const void *map, int num_threads)
+{
+/* rendering GRID pixels between two images */
+    return render_grid_pixels (in_ptr, out_ptr, map, NULL, num_threads);
+}
+
+GGRAPH_DECLARE int
+gGraphStripImageRenderGridPixelsByThreadPool (const void *in_ptr,
+					      const void *out_ptr,
+					      const void *map,
+					      const void *thread_pool)
+{
+/* rendering GRID pixels between two images [using a Thread Pool] */
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return render_grid_pixels (in_ptr, out_ptr, map,
+			       (gGraphThreadPoolPtr) thread_pool, 1);
+}
+
 GGRAPH_DECLARE int
 gGraphGetStripImageMinMaxValue (const void *in_ptr, double *min_value,
 				double *max_value, double no_data_value)
@@ -1908,28 +2034,287 @@ gGraphStripImageSetShadedReliefScanline (const void *triple_row_handle,
     return GGRAPH_OK;
 }
 
+struct shaded_relief_kernel
+{
+/* invariant coefficients used by the Shaded Relief kernels */
+    const float *row1;
+    const float *row2;
+    const float *row3;
+    float no_data_value;
+    double z_factor;
+    double divisor;
+    double sin_alt;
+    double cos_alt;
+    double sin_az;
+    double cos_az;
+};
+
+/*
+/ the Hillshade value is computed directly from the slope gradient:
+/
+/   cang = sin(alt) * sin(slope) + cos(alt) * cos(slope) * cos(az - PI/2 - aspect)
+/
+/ where slope = PI/2 - atan(sqrt(x*x + y*y)) and aspect = atan2(x, y),
+/ which simplifies to:
+/
+/   cang = (sin(alt) + cos(alt) * (cos(az - PI/2) * y + sin(az - PI/2) * x))
+/          / sqrt(1 + x*x + y*y)
+/
+/ so that no trigonometric function is required on a per-pixel basis;
+/ both the scalar and the SIMD kernels evaluate exactly the same
+/ expression (in the same order), thus producing identical results
+*/
+
 static void
-do_shaded_relief_render (struct thread_shaded_relief_render *params)
+shaded_relief_kernel_scalar (const struct shaded_relief_kernel *kr, int k,
+			     int count, double *cang, unsigned char *nulls)
 {
-/* performing actual rendering (1 single pixel) */
-    int j;
+/* computing Hillshade values for [count] pixels: plain scalar code */
+    int i;
     int n;
+    float afWin[9];
     double x;
     double y;
-    double aspect;
-    double slope;
+    for (i = 0; i < count; i++, k++)
+      {
+	  afWin[0] = kr->row1[k - 1];
+	  afWin[1] = kr->row1[k];
+	  afWin[2] = kr->row1[k + 1];
+	  afWin[3] = kr->row2[k - 1];
+	  afWin[4] = kr->row2[k];
+	  afWin[5] = kr->row2[k + 1];
+	  afWin[6] = kr->row3[k - 1];
+	  afWin[7] = kr->row3[k];
+	  afWin[8] = kr->row3[k + 1];
+	  nulls[i] = 0;
+	  for (n = 0; n <= 8; n++)
+	    {
+		if (afWin[n] == kr->no_data_value)
+		  {
+		      nulls[i] = 1;
+		      break;
+		  }
+	    }
+	  x = kr->z_factor *
+	      (double) ((afWin[0] + afWin[3] + afWin[3] + afWin[6]) -
+			(afWin[2] + afWin[5] + afWin[5] +
+			 afWin[8])) / kr->divisor;
+	  y = kr->z_factor *
+	      (double) ((afWin[6] + afWin[7] + afWin[7] + afWin[8]) -
+			(afWin[0] + afWin[1] + afWin[1] +
+			 afWin[2])) / kr->divisor;
+	  cang[i] =
+	      (kr->sin_alt +
+	       kr->cos_alt * (kr->cos_az * y +
+			      kr->sin_az * x)) / sqrt (1.0 + x * x + y * y);
+      }
+}
+
+#ifdef GG_SHADED_RELIEF_SIMD
+
+static __m128d GG_SIMD_TARGET ("sse2")
+shaded_relief_cang_sse2 (const struct shaded_relief_kernel *kr, __m128d dx,
+			 __m128d dy)
+{
+/* computing two Hillshade values [SSE2] */
+    __m128d x = _mm_div_pd (_mm_mul_pd (_mm_set1_pd (kr->z_factor), dx),
+			    _mm_set1_pd (kr->divisor));
+    __m128d y = _mm_div_pd (_mm_mul_pd (_mm_set1_pd (kr->z_factor), dy),
+			    _mm_set1_pd (kr->divisor));
+    __m128d num = _mm_add_pd (_mm_mul_pd (_mm_set1_pd (kr->cos_az), y),
+			      _mm_mul_pd (_mm_set1_pd (kr->sin_az), x));
+    __m128d den =
+	_mm_add_pd (_mm_add_pd (_mm_set1_pd (1.0), _mm_mul_pd (x, x)),
+		    _mm_mul_pd (y, y));
+    num = _mm_add_pd (_mm_set1_pd (kr->sin_alt),
+		      _mm_mul_pd (_mm_set1_pd (kr->cos_alt), num));
+    return _mm_div_pd (num, _mm_sqrt_pd (den));
+}
+
+static void GG_SIMD_TARGET ("sse2")
+shaded_relief_kernel_sse2 (const struct shaded_relief_kernel *kr, int k,
+			   int count, double *cang, unsigned char *nulls)
+{
+/* computing Hillshade values for [count] pixels: SSE2, 4 pixels at once */
+    int i;
+    int n;
+    int mask;
+    __m128 w[9];
+    __m128 dx;
+    __m128 dy;
+    __m128 nd = _mm_set1_ps (kr->no_data_value);
+    for (i = 0; i + 4 <= count; i += 4, k += 4)
+      {
+	  w[0] = _mm_loadu_ps (kr->row1 + k - 1);
+	  w[1] = _mm_loadu_ps (kr->row1 + k);
+	  w[2] = _mm_loadu_ps (kr->row1 + k + 1);
+	  w[3] = _mm_loadu_ps (kr->row2 + k - 1);
+	  w[4] = _mm_loadu_ps (kr->row2 + k);
+	  w[5] = _mm_loadu_ps (kr->row2 + k + 1);
+	  w[6] = _mm_loadu_ps (kr->row3 + k - 1);
+	  w[7] = _mm_loadu_ps (kr->row3 + k);
+	  w[8] = _mm_loadu_ps (kr->row3 + k + 1);
+	  /* NoData: exactly the same float comparison as the scalar code */
+	  dx = _mm_cmpeq_ps (w[0], nd);
+	  for (n = 1; n <= 8; n++)
+	      dx = _mm_or_ps (dx, _mm_cmpeq_ps (w[n], nd));
+	  mask = _mm_movemask_ps (dx);
+	  for (n = 0; n < 4; n++)
+	      nulls[i + n] = (mask >> n) & 1;
+	  /* the window sums are evaluated in single precision */
+	  dx = _mm_sub_ps (_mm_add_ps
+			   (_mm_add_ps (_mm_add_ps (w[0], w[3]), w[3]), w[6]),
+			   _mm_add_ps (_mm_add_ps
+				       (_mm_add_ps (w[2], w[5]), w[5]), w[8]));
+	  dy = _mm_sub_ps (_mm_add_ps
+			   (_mm_add_ps (_mm_add_ps (w[6], w[7]), w[7]), w[8]),
+			   _mm_add_ps (_mm_add_ps
+				       (_mm_add_ps (w[0], w[1]), w[1]), w[2]));
+	  _mm_storeu_pd (cang + i,
+			 shaded_relief_cang_sse2 (kr, _mm_cvtps_pd (dx),
+						  _mm_cvtps_pd (dy)));
+	  _mm_storeu_pd (cang + i + 2,
+			 shaded_relief_cang_sse2 (kr,
+						  _mm_cvtps_pd (_mm_movehl_ps
+								(dx, dx)),
+						  _mm_cvtps_pd (_mm_movehl_ps
+								(dy, dy))));
+      }
+    if (i < count)
+	shaded_relief_kernel_scalar (kr, k, count - i, cang + i, nulls + i);
+}
+
+static __m256d GG_SIMD_TARGET ("avx2")
+shaded_relief_cang_avx2 (const struct shaded_relief_kernel *kr, __m256d dx,
+			 __m256d dy)
+{
+/* computing four Hillshade values [AVX2] */
+    __m256d x =
+	_mm256_div_pd (_mm256_mul_pd (_mm256_set1_pd (kr->z_factor), dx),
+		       _mm256_set1_pd (kr->divisor));
+    __m256d y =
+	_mm256_div_pd (_mm256_mul_pd (_mm256_set1_pd (kr->z_factor), dy),
+		       _mm256_set1_pd (kr->divisor));
+    __m256d num =
+	_mm256_add_pd (_mm256_mul_pd (_mm256_set1_pd (kr->cos_az), y),
+		       _mm256_mul_pd (_mm256_set1_pd (kr->sin_az), x));
+    __m256d den =
+	_mm256_add_pd (_mm256_add_pd
+		       (_mm256_set1_pd (1.0), _mm256_mul_pd (x, x)),
+		       _mm256_mul_pd (y, y));
+    num = _mm256_add_pd (_mm256_set1_pd (kr->sin_alt),
+			 _mm256_mul_pd (_mm256_set1_pd (kr->cos_alt), num));
+    return _mm256_div_pd (num, _mm256_sqrt_pd (den));
+}
+
+static void GG_SIMD_TARGET ("avx2")
+shaded_relief_kernel_avx2 (const struct shaded_relief_kernel *kr, int k,
+			   int count, double *cang, unsigned char *nulls)
+{
+/* computing Hillshade values for [count] pixels: AVX2, 8 pixels at once */
+    int i;
+    int n;
+    int mask;
+    __m256 w[9];
+    __m256 dx;
+    __m256 dy;
+    __m256 nd = _mm256_set1_ps (kr->no_data_value);
+    for (i = 0; i + 8 <= count; i += 8, k += 8)
+      {
+	  w[0] = _mm256_loadu_ps (kr->row1 + k - 1);
+	  w[1] = _mm256_loadu_ps (kr->row1 + k);
+	  w[2] = _mm256_loadu_ps (kr->row1 + k + 1);
+	  w[3] = _mm256_loadu_ps (kr->row2 + k - 1);
+	  w[4] = _mm256_loadu_ps (kr->row2 + k);
+	  w[5] = _mm256_loadu_ps (kr->row2 + k + 1);
+	  w[6] = _mm256_loadu_ps (kr->row3 + k - 1);
+	  w[7] = _mm256_loadu_ps (kr->row3 + k);
+	  w[8] = _mm256_loadu_ps (kr->row3 + k + 1);
+	  /* NoData: exactly the same float comparison as the scalar code */
+	  dx = _mm256_cmp_ps (w[0], nd, _CMP_EQ_OQ);
+	  for (n = 1; n <= 8; n++)
+	      dx = _mm256_or_ps (dx, _mm256_cmp_ps (w[n], nd, _CMP_EQ_OQ));
+	  mask = _mm256_movemask_ps (dx);
+	  for (n = 0; n < 8; n++)
+	      nulls[i + n] = (mask >> n) & 1;
+	  /* the window sums are evaluated in single precision */
+	  dx = _mm256_sub_ps (_mm256_add_ps
+			      (_mm256_add_ps
+			       (_mm256_add_ps (w[0], w[3]), w[3]), w[6]),
+			      _mm256_add_ps (_mm256_add_ps
+					     (_mm256_add_ps (w[2], w[5]),
+					      w[5]), w[8]));
+	  dy = _mm256_sub_ps (_mm256_add_ps
+			      (_mm256_add_ps
+			       (_mm256_add_ps (w[6], w[7]), w[7]), w[8]),
+			      _mm256_add_ps (_mm256_add_ps
+					     (_mm256_add_ps (w[0], w[1]),
+					      w[1]), w[2]));
+	  _mm256_storeu_pd (cang + i,
+			    shaded_relief_cang_avx2 (kr,
+						     _mm256_cvtps_pd
+						     (_mm256_castps256_ps128
+						      (dx)),
+						     _mm256_cvtps_pd
+						     (_mm256_castps256_ps128
+						      (dy))));
+	  _mm256_storeu_pd (cang + i + 4,
+			    shaded_relief_cang_avx2 (kr,
+						     _mm256_cvtps_pd
+						     (_mm256_extractf128_ps
+						      (dx, 1)),
+						     _mm256_cvtps_pd
+						     (_mm256_extractf128_ps
+						      (dy, 1))));
+      }
+    if (i < count)
+	shaded_relief_kernel_scalar (kr, k, count - i, cang + i, nulls + i);
+}
+
+#endif /* GG_SHADED_RELIEF_SIMD */
+
+static void
+shaded_relief_kernel (const struct shaded_relief_kernel *kr, int k,
+		      int count, double *cang, unsigned char *nulls)
+{
+/* computing Hillshade values: runtime dispatching to the best kernel */
+#ifdef GG_SHADED_RELIEF_SIMD
+    if (__builtin_cpu_supports ("avx2"))
+      {
+	  shaded_relief_kernel_avx2 (kr, k, count, cang, nulls);
+	  return;
+      }
+    if (__builtin_cpu_supports ("sse2"))
+      {
+	  shaded_relief_kernel_sse2 (kr, k, count, cang, nulls);
+	  return;
+      }
+#endif
+    shaded_relief_kernel_scalar (kr, k, count, cang, nulls);
+}
+
+static void
+do_shaded_relief_render (struct thread_shaded_relief_render *params)
+{
+/* performing actual rendering (a block of pixels) */
+    int j;
+    int k;
+    int first;
+    int last;
+    int count;
+    double cang_buf[GG_SHADED_RELIEF_CHUNK];
+    unsigned char nulls[GG_SHADED_RELIEF_CHUNK];
     double cang;
     int gray;
-    float afWin[9];
     double red;
     double green;
     double blue;
     double alpha;
-    int bContainsNull;
     unsigned char *p_out;
     unsigned char r;
     unsigned char g;
     unsigned char b;
+    struct shaded_relief_kernel kr;
     gGraphShadedReliefTripleRowPtr triple_row;
 
     p_out = params->p_rgb + (params->base * 3);
@@ -1947,6 +2332,16 @@ do_shaded_relief_render (struct thread_shaded_relief_render *params)
 *
 */
 
+    kr.row1 = triple_row->in_row1;
+    kr.row2 = triple_row->in_row2;
+    kr.row3 = triple_row->in_row3;
+    kr.no_data_value = triple_row->no_data_value;
+    kr.z_factor = triple_row->z_factor;
+    kr.divisor = 8.0 * triple_row->scale_factor;
+    kr.sin_alt = sin (params->altRadians);
+    kr.cos_alt = cos (params->altRadians);
+    kr.sin_az = sin (params->azRadians - M_PI / 2);
+    kr.cos_az = cos (params->azRadians - M_PI / 2);
 
 /*
 / Move a 3x3 pafWindow over each cell 
@@ -1955,122 +2350,47 @@ do_shaded_relief_render (struct thread_shaded_relief_render *params)
 /      0 1 2
 /      3 4 5
 /      6 7 8
+/
+/ the edges are excluded
 */
-    for (j = 0; j < params->num_pixels; j++)
-      {
-	  /* Exclude the edges */
-	  int k = j + params->base;
-	  if (j == 0 || j == params->num_pixels - 1)
-	      continue;
-
-	  afWin[0] = triple_row->in_row1[k - 1];
-	  afWin[1] = triple_row->in_row1[k];
-	  afWin[2] = triple_row->in_row1[k + 1];
-	  afWin[3] = triple_row->in_row2[k - 1];
-	  afWin[4] = triple_row->in_row2[k];
-	  afWin[5] = triple_row->in_row2[k + 1];
-	  afWin[6] = triple_row->in_row3[k - 1];
-	  afWin[7] = triple_row->in_row3[k];
-	  afWin[8] = triple_row->in_row3[k + 1];
-
-	  bContainsNull = 0;
-	  for (n = 0; n <= 8; n++)
-	    {
-		if (afWin[n] == triple_row->no_data_value)
-		  {
-		      bContainsNull = 1;
-		      break;
-		  }
-	    }
+    first = params->base + 1;
+    last = params->base + params->num_pixels - 1;
+    for (k = first; k < last; k += count)
+      {
+	  count = last - k;
+	  if (count > GG_SHADED_RELIEF_CHUNK)
+	      count = GG_SHADED_RELIEF_CHUNK;
+	  shaded_relief_kernel (&kr, k, count, cang_buf, nulls);
 
-	  if (bContainsNull)
+	  for (j = 0; j < count; j++)
 	    {
-		/* We have nulls so write nullValue and move on */
-		r = triple_row->no_red;
-		g = triple_row->no_green;
-		b = triple_row->no_blue;
-	    }
-	  else
-	    {
-		/* We have a valid 3x3 window. */
-
-		/* ---------------------------------------
-		 * Compute Hillshade
-		 */
-
-		/* First Slope ... */
-		x = triple_row->z_factor *
-		    ((afWin[0] + afWin[3] + afWin[3] + afWin[6]) -
-		     (afWin[2] + afWin[5] + afWin[5] +
-		      afWin[8])) / (8.0 * triple_row->scale_factor);
-
-		y = triple_row->z_factor *
-		    ((afWin[6] + afWin[7] + afWin[7] + afWin[8]) -
-		     (afWin[0] + afWin[1] + afWin[1] +
-		      afWin[2])) / (8.0 * triple_row->scale_factor);
-
-		slope = M_PI / 2 - atan (sqrt (x * x + y * y));
-
-		/* ... then aspect... */
-		aspect = atan2 (x, y);
-
-		/* ... then the shade value */
-		cang = sin (params->altRadians) * sin (slope) +
-		    cos (params->altRadians) * cos (slope) *
-		    cos (params->azRadians - M_PI / 2 - aspect);
-
-		if (cang <= 0.0)
-		    cang = 1.0;
-		else
-		    cang = 1.0 + (254.0 * cang);
-
-		if (triple_row->color_map != NULL)
+		if (nulls[j])
 		  {
-		      /* Color + Shaded Relief rendering */
-		      match_color (triple_row->color_map, afWin[4],
-				   triple_row->no_data_value, &r, &g, &b);
-		      alpha = cang / 255.0;
-		      red = (double) r *alpha;
-		      green = (double) g *alpha;
-		      blue = (double) b *alpha;
-		      if (red < 0.0)
-			  red = 0.0;
-		      if (green < 0.0)
-			  green = 0.0;
-		      if (blue < 0.0)
-			  blue = 0.0;
-		      if (red > 255.0)
-			  red = 255.0;
-		      if (green > 255.0)
-			  green = 255.0;
-		      if (blue > 255.0)
-			  blue = 255.0;
-		      r = (unsigned char) red;
-		      g = (unsigned char) green;
-		      b = (unsigned) blue;
+		      /* We have nulls so write nullValue and move on */
+		      r = triple_row->no_red;
+		      g = triple_row->no_green;
+		      b = triple_row->no_blue;
 		  }
 		else
 		  {
-		      if ((triple_row->mono_red == 0
-			   && triple_row->mono_green == 0
-			   && triple_row->mono_blue == 0)
-			  || (triple_row->mono_red == 255
-			      && triple_row->mono_green == 255
-			      && triple_row->mono_blue == 255))
-			{
-			    /* plain gray-scale */
-			    gray = (int) cang;
-			    r = (unsigned char) gray;
-			    g = (unsigned char) gray;
-			    b = (unsigned) gray;
-			}
+		      /* We have a valid 3x3 window: applying the Hillshade */
+		      cang = cang_buf[j];
+		      if (cang <= 0.0)
+			  cang = 1.0;
 		      else
+			  cang = 1.0 + (254.0 * cang);
+
+		      if (triple_row->color_map != NULL)
 			{
-			    /* using the monochrome base color + ALPHA */
+			    /* Color + Shaded Relief rendering */
+			    match_color (triple_row->color_map,
+					 triple_row->in_row2[k + j],
+					 triple_row->no_data_value, &r, &g,
+					 &b);
 			    alpha = cang / 255.0;
-			    red = (double) (triple_row->mono_red) * alpha;
-			    green = (double) (triple_row->mono_green) * alpha;
-			    blue = (double) (triple_row->mono_blue) * alpha;
+			    red = (double) r *alpha;
+			    green = (double) g *alpha;
+			    blue = (double) b *alpha;
 			    if (red < 0.0)
 				red = 0.0;
 			    if (green < 0.0)
@@ -2087,47 +2407,77 @@ do_shaded_relief_render (struct thread_shaded_relief_render *params)
 			    g = (unsigned char) green;
 			    b = (unsigned) blue;
 			}
+		      else
+			{
+			    if ((triple_row->mono_red == 0
+				 && triple_row->mono_green == 0
+				 && triple_row->mono_blue == 0)
+				|| (triple_row->mono_red == 255
+				    && triple_row->mono_green == 255
+				    && triple_row->mono_blue == 255))
+			      {
+				  /* plain gray-scale */
+				  gray = (int) cang;
+				  r = (unsigned char) gray;
+				  g = (unsigned char) gray;
+				  b = (unsigned) gray;
+			      }
+			    else
+			      {
+				  /* using the monochrome base color + ALPHA */
+				  alpha = cang / 255.0;
+				  red = (double) (triple_row->mono_red) * alpha;
+				  green =
+				      (double) (triple_row->mono_green) * alpha;
+				  blue =
+				      (double) (triple_row->mono_blue) * alpha;
+				  if (red < 0.0)
+				      red = 0.0;
+				  if (green < 0.0)
+				      green = 0.0;
+				  if (blue < 0.0)
+				      blue = 0.0;
+				  if (red > 255.0)
+				      red = 255.0;
+				  if (green > 255.0)
+				      green = 255.0;
+				  if (blue > 255.0)
+				      blue = 255.0;
+				  r = (unsigned char) red;
+				  g = (unsigned char) green;
+				  b = (unsigned) blue;
+			      }
+			}
 		  }
+		*p_out++ = r;
+		*p_out++ = g;
+		*p_out++ = b;
 	    }
-	  *p_out++ = r;
-	  *p_out++ = g;
-	  *p_out++ = b;
       }
 }
 
-#ifdef _WIN32
-static DWORD WINAPI
-#else
-static void *
-#endif
+static void
 shaded_relief_render (void *arg)
 {
-/* threaded function: rendering a Shaded Relief pixel */
+/* threaded function: rendering a Shaded Relief pixels block */
     struct thread_shaded_relief_render *params =
 	(struct thread_shaded_relief_render *) arg;
     do_shaded_relief_render (params);
-#ifdef _WIN32
-    return 0;
-#else
-    pthread_exit (NULL);
-#endif
 }
 
-GGRAPH_DECLARE int
-gGraphShadedReliefRenderPixels (const void *triple_row_handle, int num_threads,
-				int *out_row_ready)
+static int
+render_shaded_relief_pixels (const void *triple_row_handle,
+			     gGraphThreadPoolPtr pool, int num_threads,
+			     int *out_row_ready)
 {
 /* rendering a Shaded Relief scanline */
     double degreesToRadians;
-    unsigned char *p_out;
     int nt;
-    struct thread_shaded_relief_render threads[GG_MAX_THREADS];
-#ifdef _WIN32
-    HANDLE thread_handles[GG_MAX_THREADS];
-    DWORD dwThreadIdArray[GG_MAX_THREADS];
-#else
-    pthread_t thread_ids[GG_MAX_THREADS];
-#endif
+    int num_jobs;
+    int first;
+    int last;
+    int pixels_per_thread;
+    struct thread_shaded_relief_render jobs[GG_MAX_THREADS];
     gGraphShadedReliefTripleRowPtr triple_row =
 	(gGraphShadedReliefTripleRowPtr) triple_row_handle;
 
@@ -2143,74 +2493,64 @@ gGraphShadedReliefRenderPixels (const void *triple_row_handle, int num_threads,
 	  return GGRAPH_OK;
       }
 
+    if (pool != NULL)
+	num_threads = gg_thread_pool_size (pool);
     if (num_threads > GG_MAX_THREADS)
 	num_threads = GG_MAX_THREADS;
     if (num_threads < 1)
 	num_threads = 1;
     degreesToRadians = M_PI / 180.0;
 
-    p_out = triple_row->out_rgb;
-    if (num_threads < 2)
-      {
-	  /* not using multithreading */
-	  threads[0].triple_row = triple_row;
-	  threads[0].altRadians = triple_row->altitude * degreesToRadians;
-	  threads[0].azRadians = triple_row->azimuth * degreesToRadians;
-	  threads[0].base = 0;
-	  threads[0].num_pixels = triple_row->width;
-	  threads[0].p_rgb = p_out;
-	  do_shaded_relief_render (&(threads[0]));
-      }
-    else
-      {
-	  /* using concurrent threads */
-	  int base = 0;
-	  int pixels_per_thread = triple_row->width / num_threads;
-	  if ((pixels_per_thread * num_threads) < triple_row->width)
-	      pixels_per_thread++;
-	  for (nt = 0; nt < num_threads; nt++)
-	    {
-		int num_pixels;
-		threads[nt].triple_row = triple_row;
-		threads[nt].altRadians =
-		    triple_row->altitude * degreesToRadians;
-		threads[nt].azRadians = triple_row->azimuth * degreesToRadians;
-		if (nt == 0)
-		    threads[nt].base = base;
-		else
-		    threads[nt].base = base - 1;
-		num_pixels = pixels_per_thread + 1;
-		if (base + pixels_per_thread > triple_row->width)
-		    num_pixels = triple_row->width - base;
-		threads[nt].num_pixels = num_pixels;
-		threads[nt].p_rgb = p_out;
-		base += pixels_per_thread;
-		if (num_pixels > 0)
-		  {
-#ifdef _WIN32
-		      thread_handles[nt] =
-			  CreateThread (NULL, 0, shaded_relief_render,
-					&(threads[nt]), 0,
-					&dwThreadIdArray[nt]);
-#else
-		      pthread_create (&(thread_ids[nt]), NULL,
-				      shaded_relief_render, &(threads[nt]));
-#endif
-		  }
-	    }
-	  /* waiting until any concurrent thread terminates */
-#ifdef _WIN32
-	  WaitForMultipleObjects (num_threads, thread_handles, TRUE, INFINITE);
-#else
-	  for (nt = 0; nt < num_threads; nt++)
-	      pthread_join (thread_ids[nt], NULL);
-#endif
-      }
+/*
+/ splitting the inner pixels [1, width - 2] into sub-sets;
+/ each job also reads its left and right neighbours
+*/
+    pixels_per_thread = (triple_row->width - 2) / num_threads;
+    if ((pixels_per_thread * num_threads) < triple_row->width - 2)
+	pixels_per_thread++;
+    num_jobs = 0;
+    for (first = 1; first < triple_row->width - 1; first += pixels_per_thread)
+      {
+	  last = first + pixels_per_thread;
+	  if (last > triple_row->width - 1)
+	      last = triple_row->width - 1;
+	  nt = num_jobs++;
+	  jobs[nt].triple_row = triple_row;
+	  jobs[nt].altRadians = triple_row->altitude * degreesToRadians;
+	  jobs[nt].azRadians = triple_row->azimuth * degreesToRadians;
+	  jobs[nt].base = first - 1;
+	  jobs[nt].num_pixels = (last - first) + 2;
+	  jobs[nt].p_rgb = triple_row->out_rgb;
+      }
+    gg_thread_pool_run (pool, num_threads, shaded_relief_render, jobs,
+			sizeof (struct thread_shaded_relief_render), num_jobs);
 
     *out_row_ready = GGRAPH_TRUE;
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphShadedReliefRenderPixels (const void *triple_row_handle, int num_threads,
+				int *out_row_ready)
+{
+/* rendering a Shaded Relief scanline */
+    return render_shaded_relief_pixels (triple_row_handle, NULL, num_threads,
+					out_row_ready);
+}
+
+GGRAPH_DECLARE int
+gGraphShadedReliefRenderPixelsByThreadPool (const void *triple_row_handle,
+					    const void *thread_pool,
+					    int *out_row_ready)
+{
+/* rendering a Shaded Relief scanline [using a Thread Pool] */
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return render_shaded_relief_pixels (triple_row_handle,
+					(gGraphThreadPoolPtr) thread_pool, 1,
+					out_row_ready);
+}
+
 static void
 landsat_recalibrate (struct thread_landsat_recalibrate *p)
 {
@@ -2395,29 +2735,20 @@ landsat_rgb (struct thread_landsat_recalibrate *ptr)
       }
 }
 
-#ifdef _WIN32
-static DWORD WINAPI
-#else
-static void *
-#endif
+static void
 landsat_rgb_recalibrate (void *arg)
 {
 /* threaded function: rendering an RGB Landsat sub-strip */
     struct thread_landsat_recalibrate *params =
 	(struct thread_landsat_recalibrate *) arg;
     landsat_rgb (params);
-#ifdef _WIN32
-    return 0;
-#else
-    pthread_exit (NULL);
-#endif
 }
 
-GGRAPH_DECLARE int
-gGraphLandsatRGB (const void *red_ptr, const void *green_ptr,
-		  const void *blue_ptr, const void *rgb_ptr, int width,
-		  int num_rows, gGraphLandsatRecalibrationPtr params,
-		  int num_threads)
+static int
+landsat_rgb_strip (const void *red_ptr, const void *green_ptr,
+		   const void *blue_ptr, const void *rgb_ptr, int width,
+		   int num_rows, gGraphLandsatRecalibrationPtr params,
+		   gGraphThreadPoolPtr pool, int num_threads)
 {
 /* processing a whole RGB Landsat strip (may be, in a multithreaded way) */
 
@@ -2427,12 +2758,6 @@ gGraphLandsatRGB (const void *red_ptr, const void *green_ptr,
     gGraphStripImagePtr img_rgb = (gGraphStripImagePtr) rgb_ptr;
     int nt;
     struct thread_landsat_recalibrate threads[GG_MAX_THREADS];
-#ifdef _WIN32
-    HANDLE thread_handles[GG_MAX_THREADS];
-    DWORD dwThreadIdArray[GG_MAX_THREADS];
-#else
-    pthread_t thread_ids[GG_MAX_THREADS];
-#endif
 
     if (img_red == NULL || img_green == NULL || img_blue == NULL
 	|| img_rgb == NULL)
@@ -2465,8 +2790,12 @@ gGraphLandsatRGB (const void *red_ptr, const void *green_ptr,
     else
 	return GGRAPH_INVALID_IMAGE;
 
+    if (pool != NULL)
+	num_threads = gg_thread_pool_size (pool);
     if (num_threads > GG_MAX_THREADS)
 	num_threads = GG_MAX_THREADS;
+    if (num_threads > num_rows)
+	num_threads = num_rows;
     if (num_threads < 1)
 	num_threads = 1;
 
@@ -2536,27 +2865,41 @@ gGraphLandsatRGB (const void *red_ptr, const void *green_ptr,
 		threads[nt].min_row = base_row;
 		threads[nt].max_row = max_row;
 		base_row += rows_per_thread;
-#ifdef _WIN32
-		thread_handles[nt] =
-		    CreateThread (NULL, 0, landsat_rgb_recalibrate,
-				  &(threads[nt]), 0, &dwThreadIdArray[nt]);
-#else
-		pthread_create (&(thread_ids[nt]), NULL,
-				landsat_rgb_recalibrate, &(threads[nt]));
-#endif
 	    }
-	  /* waiting until any concurrent thread terminates */
-#ifdef _WIN32
-	  WaitForMultipleObjects (num_threads, thread_handles, TRUE, INFINITE);
-#else
-	  for (nt = 0; nt < num_threads; nt++)
-	      pthread_join (thread_ids[nt], NULL);
-#endif
+	  gg_thread_pool_run (pool, num_threads, landsat_rgb_recalibrate, threads,
+			      sizeof (struct thread_landsat_recalibrate),
+			      num_threads);
       }
 
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphLandsatRGB (const void *red_ptr, const void *green_ptr,
+		  const void *blue_ptr, const void *rgb_ptr, int width,
+		  int num_rows, gGraphLandsatRecalibrationPtr params,
+		  int num_threads)
+{
+/* processing a whole RGB Landsat strip (may be, in a multithreaded way) */
+    return landsat_rgb_strip (red_ptr, green_ptr, blue_ptr, rgb_ptr, width,
+			      num_rows, params, NULL, num_threads);
+}
+
+GGRAPH_DECLARE int
+gGraphLandsatRGBByThreadPool (const void *red_ptr, const void *green_ptr,
+			      const void *blue_ptr, const void *rgb_ptr,
+			      int width, int num_rows,
+			      gGraphLandsatRecalibrationPtr params,
+			      const void *thread_pool)
+{
+/* processing a whole RGB Landsat strip [using a Thread Pool] */
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return landsat_rgb_strip (red_ptr, green_ptr, blue_ptr, rgb_ptr, width,
+			      num_rows, params,
+			      (gGraphThreadPoolPtr) thread_pool, 1);
+}
+
 static void
 landsat_bw (struct thread_landsat_recalibrate *ptr)
 {
@@ -2603,40 +2946,25 @@ landsat_bw (struct thread_landsat_recalibrate *ptr)
       }
 }
 
-#ifdef _WIN32
-static DWORD WINAPI
-#else
-static void *
-#endif
+static void
 landsat_bw_recalibrate (void *arg)
 {
 /* threaded function: rendering a B&W Landsat sub-strip */
     struct thread_landsat_recalibrate *params =
 	(struct thread_landsat_recalibrate *) arg;
     landsat_bw (params);
-#ifdef _WIN32
-    return 0;
-#else
-    pthread_exit (NULL);
-#endif
 }
 
-GGRAPH_DECLARE int
-gGraphLandsatBW (const void *in_ptr, const void *out_ptr, int width,
-		 int num_rows, gGraphLandsatRecalibrationPtr params,
-		 int num_threads)
+static int
+landsat_bw_strip (const void *in_ptr, const void *out_ptr, int width,
+		  int num_rows, gGraphLandsatRecalibrationPtr params,
+		  gGraphThreadPoolPtr pool, int num_threads)
 {
 /* processing a whole B&W Landsat strip (may be, in a multithreaded way) */
     gGraphStripImagePtr img_in = (gGraphStripImagePtr) in_ptr;
     gGraphStripImagePtr img_out = (gGraphStripImagePtr) out_ptr;
     int nt;
     struct thread_landsat_recalibrate threads[GG_MAX_THREADS];
-#ifdef _WIN32
-    HANDLE thread_handles[GG_MAX_THREADS];
-    DWORD dwThreadIdArray[GG_MAX_THREADS];
-#else
-    pthread_t thread_ids[GG_MAX_THREADS];
-#endif
 
     if (img_in == NULL || img_out == NULL)
 	return GGRAPH_INVALID_IMAGE;
@@ -2659,8 +2987,12 @@ gGraphLandsatBW (const void *in_ptr, const void *out_ptr, int width,
     else
 	return GGRAPH_INVALID_IMAGE;
 
+    if (pool != NULL)
+	num_threads = gg_thread_pool_size (pool);
     if (num_threads > GG_MAX_THREADS)
 	num_threads = GG_MAX_THREADS;
+    if (num_threads > num_rows)
+	num_threads = num_rows;
     if (num_threads < 1)
 	num_threads = 1;
 
@@ -2710,27 +3042,38 @@ gGraphLandsatBW (const void *in_ptr, const void *out_ptr, int width,
 		threads[nt].min_row = base_row;
 		threads[nt].max_row = max_row;
 		base_row += rows_per_thread;
-#ifdef _WIN32
-		thread_handles[nt] =
-		    CreateThread (NULL, 0, landsat_bw_recalibrate,
-				  &(threads[nt]), 0, &dwThreadIdArray[nt]);
-#else
-		pthread_create (&(thread_ids[nt]), NULL,
-				landsat_bw_recalibrate, &(threads[nt]));
-#endif
 	    }
-	  /* waiting until any concurrent thread terminates */
-#ifdef _WIN32
-	  WaitForMultipleObjects (num_threads, thread_handles, TRUE, INFINITE);
-#else
-	  for (nt = 0; nt < num_threads; nt++)
-	      pthread_join (thread_ids[nt], NULL);
-#endif
+	  gg_thread_pool_run (pool, num_threads, landsat_bw_recalibrate, threads,
+			      sizeof (struct thread_landsat_recalibrate),
+			      num_threads);
       }
 
     return GGRAPH_OK;
 }
 
+GGRAPH_DECLARE int
+gGraphLandsatBW (const void *in_ptr, const void *out_ptr, int width,
+		 int num_rows, gGraphLandsatRecalibrationPtr params,
+		 int num_threads)
+{
+/* processing a whole B&W Landsat strip (may be, in a multithreaded way) */
+    return landsat_bw_strip (in_ptr, out_ptr, width, num_rows, params, NULL,
+			     num_threads);
+}
+
+GGRAPH_DECLARE int
+gGraphLandsatBWByThreadPool (const void *in_ptr, const void *out_ptr,
+			     int width, int num_rows,
+			     gGraphLandsatRecalibrationPtr params,
+			     const void *thread_pool)
+{
+/* processing a whole B&W Landsat strip [using a Thread Pool] */
+    if (thread_pool != NULL && !gg_is_valid_thread_pool (thread_pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    return landsat_bw_strip (in_ptr, out_ptr, width, num_rows, params,
+			     (gGraphThreadPoolPtr) thread_pool, 1);
+}
+
 GGRAPH_DECLARE int
 gGraphGetLandsatSceneExtent (const void *ptr, int base_row, double *top_x,
 			     double *top_y, double *bottom_x, double *bottom_y,
@@ -30,6 +30,14 @@
 #include <limits.h>
 #include <string.h>
 #include <stdlib.h>
+#include <locale.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
 
 #include "gaiagraphics.h"
 #include "gaiagraphics_internals.h"
@@ -41,6 +49,11 @@
 #define GRID_DEM_HDR	5
 #define GRID_ASCII	6
 
+#define ASC_BLOCK_SIZE	65536
+#define ASC_OUT_BUFFER_SIZE	65536
+#define ASC_MAX_CELL_TEXT	64
+#define ASC_IS_BLANK(c)	((c) == ' ' || (c) == '\t' || (c) == '\r')
+
 struct grid_codec_data
 {
 /* a struct used by GRID codec */
@@ -49,8 +62,45 @@ struct grid_codec_data
     int little_endian;
     void *grid_buffer;
     long *row_offsets;
+    unsigned char *map;
+    size_t map_length;
+    unsigned char *saved_pixels;
 };
 
+static void
+grid_map_file (struct grid_codec_data *codec, FILE * in, long file_length)
+{
+/*
+/ attempting to map the whole GRID file into memory [copy-on-write]
+/ on failure the GRID will simply be read by fread()
+*/
+    void *map;
+#ifdef _WIN32
+    HANDLE mapping;
+    HANDLE file = (HANDLE) _get_osfhandle (_fileno (in));
+    if (file == INVALID_HANDLE_VALUE)
+	return;
+    mapping = CreateFileMapping (file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping == NULL)
+	return;
+    map = MapViewOfFile (mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle (mapping);
+    if (map == NULL)
+	return;
+#else
+    if (file_length <= 0)
+	return;
+    map =
+	mmap (NULL, file_length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+	      fileno (in), 0);
+    if (map == MAP_FAILED)
+	return;
+    posix_madvise (map, file_length, POSIX_MADV_SEQUENTIAL);
+#endif
+    codec->map = map;
+    codec->map_length = file_length;
+}
+
 GGRAPH_PRIVATE int
 gg_image_strip_prepare_from_hgt (FILE * in, int lon, int lat,
 				 gGraphStripImagePtr * image_handle)
@@ -64,8 +114,6 @@ gg_image_strip_prepare_from_hgt (FILE * in, int lon, int lat,
     int height;
     double pixel_size;
     double half_pixel;
-    int buf_size;
-    void *grid_buffer = NULL;
     int ret = GGRAPH_HGT_CODEC_ERROR;
     *image_handle = NULL;
 
@@ -117,14 +165,13 @@ gg_image_strip_prepare_from_hgt (FILE * in, int lon, int lat,
     grid_codec->is_writer = 0;
     grid_codec->grid_buffer = NULL;
     grid_codec->row_offsets = NULL;
+    grid_codec->map = NULL;
+    grid_codec->map_length = 0;
+    grid_codec->saved_pixels = NULL;
     img->codec_data = grid_codec;
 
-/* allocating the GRID read buffer */
-    buf_size = sizeof (short) * width;
-    grid_buffer = malloc (buf_size);
-    if (!grid_buffer)
-	goto error;
-    grid_codec->grid_buffer = grid_buffer;
+/* attempting to map the whole GRID file into memory */
+    grid_map_file (grid_codec, in, file_length);
 
     *image_handle = img;
     return GGRAPH_OK;
@@ -146,48 +193,135 @@ gg_grid_codec_destroy (void *p)
 	free (codec->grid_buffer);
     if (codec->row_offsets)
 	free (codec->row_offsets);
+    if (codec->map)
+      {
+#ifdef _WIN32
+	  UnmapViewOfFile (codec->map);
+#else
+	  munmap (codec->map, codec->map_length);
+#endif
+      }
     free (codec);
 }
 
-static int
-read_from_hgt (FILE * in, gGraphStripImagePtr img, void *scanline)
+GGRAPH_PRIVATE void
+gg_grid_codec_restore_pixels (gGraphStripImagePtr img)
 {
-/* decoding an HGT-GRID [by strip] */
-    int width = img->width;
-    int height = img->height;
-    size_t scan_size = width * 2;
-    int row;
-    int incr = 0;
-    int x;
-    int endian_arch = gg_endian_arch ();
-    off_t pos = img->next_row * scan_size;
-    unsigned char *p_in;
-    short *p_out;
-    short cell_value;
+/*
+/ pixels could currently point straight into the file mapping:
+/ restoring the pixels buffer actually owned by the strip image
+*/
+    struct grid_codec_data *codec =
+	(struct grid_codec_data *) (img->codec_data);
+    if (!codec)
+	return;
+    if (codec->saved_pixels)
+      {
+	  img->pixels = codec->saved_pixels;
+	  codec->saved_pixels = NULL;
+      }
+}
 
-/* positioning on the start scanline */
-    if (fseek (in, pos, SEEK_SET) != 0)
-	return GGRAPH_HGT_CODEC_ERROR;
-    for (row = 0; row < img->rows_per_block; row++)
+static void
+grid_swap_cells (unsigned char *buf, size_t count, int cell_size)
+{
+/*
+/ reversing the byte order of a whole block of GRID cells [in place]
+/ plain shift-and-mask loops, so to be vectorized by the compiler
+*/
+    size_t i;
+    unsigned short *p16 = (unsigned short *) buf;
+    unsigned int *p32 = (unsigned int *) buf;
+    unsigned int v;
+    unsigned int w;
+    switch (cell_size)
       {
-	  /* reading the required number of scanlines */
-	  if ((row + img->next_row) >= height)
-	      break;
-	  if (fread (scanline, 1, scan_size, in) != scan_size)
-	      return GGRAPH_HGT_CODEC_ERROR;
-	  p_in = scanline;
-	  p_out = (short *) (img->pixels);
-	  p_out += (row * width);
-	  for (x = 0; x < width; x++)
+      case 2:
+	  for (i = 0; i < count; i++)
+	      p16[i] = (unsigned short) ((p16[i] >> 8) | (p16[i] << 8));
+	  break;
+      case 4:
+	  for (i = 0; i < count; i++)
 	    {
-		cell_value = gg_import_int16 (p_in, 0, endian_arch);
-		*p_out++ = cell_value;
-		p_in += sizeof (short);
+		v = p32[i];
+		p32[i] = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000)
+		    | (v << 24);
 	    }
-	  incr++;
+	  break;
+      case 8:
+	  for (i = 0; i < count * 2; i += 2)
+	    {
+		/* swapping both 32 bit halves */
+		v = p32[i];
+		w = p32[i + 1];
+		p32[i] = (w >> 24) | ((w >> 8) & 0xff00) | ((w << 8) & 0xff0000)
+		    | (w << 24);
+		p32[i + 1] =
+		    (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) |
+		    (v << 24);
+	    }
+	  break;
+      };
+}
+
+static int
+read_raw_grid (FILE * in, gGraphStripImagePtr img, int little_endian,
+	       int error_code)
+{
+/*
+/ decoding a raw binary GRID [by strip]
+/
+/ when the file is memory mapped and has the same endianness as the
+/ CPU the strip pixels will simply point into the file mapping [zero copy]
+/ otherwise a whole block of rows is copied, then byte-swapped in a single pass
+*/
+    struct grid_codec_data *grid_codec =
+	(struct grid_codec_data *) (img->codec_data);
+    int cell_size = img->bits_per_sample / 8;
+    size_t scan_size = (size_t) (img->width) * cell_size;
+    int rows = img->rows_per_block;
+    int swap = (little_endian != gg_endian_arch ());
+    off_t pos = (off_t) (img->next_row) * scan_size;
+    size_t block_size;
+
+    if (img->pixels == NULL)
+	return error_code;
+    if (img->next_row + rows > img->height)
+	rows = img->height - img->next_row;
+    block_size = scan_size * rows;
+    if (grid_codec->map != NULL
+	&& (size_t) pos + block_size <= grid_codec->map_length)
+      {
+	  unsigned char *block = grid_codec->map + pos;
+	  if (!swap)
+	    {
+		/* zero copy */
+		if (grid_codec->saved_pixels == NULL)
+		    grid_codec->saved_pixels = img->pixels;
+		img->pixels = block;
+	    }
+	  else
+	    {
+		gg_grid_codec_restore_pixels (img);
+		memcpy (img->pixels, block, block_size);
+		grid_swap_cells (img->pixels, block_size / cell_size,
+				 cell_size);
+	    }
+      }
+    else
+      {
+	  /* reading the whole block of rows at once */
+	  gg_grid_codec_restore_pixels (img);
+	  if (fseek (in, pos, SEEK_SET) != 0)
+	      return error_code;
+	  if (fread (img->pixels, 1, block_size, in) != block_size)
+	      return error_code;
+	  if (swap)
+	      grid_swap_cells (img->pixels, block_size / cell_size,
+			       cell_size);
       }
-    img->next_row += incr;
-    img->current_available_rows = incr;
+    img->next_row += rows;
+    img->current_available_rows = rows;
     return GGRAPH_OK;
 }
 
@@ -202,7 +336,8 @@ gg_image_strip_read_from_hgt (gGraphStripImagePtr img, int *progress)
     if (grid_codec->grid_type == GRID_HGT_1
 	|| grid_codec->grid_type == GRID_HGT_3)
       {
-	  int ret = read_from_hgt (in, img, grid_codec->grid_buffer);
+	  /* HGT cells are always big-endian */
+	  int ret = read_raw_grid (in, img, 0, GGRAPH_HGT_CODEC_ERROR);
 	  if (ret == GGRAPH_OK && progress != NULL)
 	      *progress =
 		  (int) (((double) (img->next_row + 1) * 100.0) /
@@ -1557,8 +1692,6 @@ gg_image_strip_prepare_from_bin_hdr (FILE * in, const char *hdr_path,
     double no_data;
     double min;
     double max;
-    int buf_size;
-    void *grid_buffer = NULL;
     int ret = GGRAPH_BIN_CODEC_ERROR;
     *image_handle = NULL;
 
@@ -1602,28 +1735,14 @@ gg_image_strip_prepare_from_bin_hdr (FILE * in, const char *hdr_path,
     grid_codec->is_writer = 0;
     grid_codec->grid_buffer = NULL;
     grid_codec->row_offsets = NULL;
+    grid_codec->map = NULL;
+    grid_codec->map_length = 0;
+    grid_codec->saved_pixels = NULL;
     grid_codec->little_endian = endian;
     img->codec_data = grid_codec;
 
-/* allocating the GRID read buffer */
-    if (sample == GGRAPH_SAMPLE_INT)
-      {
-	  if (bits_per_sample == 16)
-	      buf_size = sizeof (short) * width;
-	  if (bits_per_sample == 32)
-	      buf_size = sizeof (int) * width;
-      }
-    if (sample == GGRAPH_SAMPLE_FLOAT)
-      {
-	  if (bits_per_sample == 32)
-	      buf_size = sizeof (float) * width;
-	  if (bits_per_sample == 64)
-	      buf_size = sizeof (double) * width;
-      }
-    grid_buffer = malloc (buf_size);
-    if (!grid_buffer)
-	goto error;
-    grid_codec->grid_buffer = grid_buffer;
+/* attempting to map the whole GRID file into memory */
+    grid_map_file (grid_codec, in, file_length);
 
     *image_handle = img;
     return GGRAPH_OK;
@@ -1655,8 +1774,6 @@ gg_image_strip_prepare_from_flt_hdr (FILE * in, const char *hdr_path,
     double no_data;
     double min;
     double max;
-    int buf_size;
-    void *grid_buffer = NULL;
     int ret = GGRAPH_FLT_CODEC_ERROR;
     *image_handle = NULL;
 
@@ -1700,28 +1817,14 @@ gg_image_strip_prepare_from_flt_hdr (FILE * in, const char *hdr_path,
     grid_codec->is_writer = 0;
     grid_codec->grid_buffer = NULL;
     grid_codec->row_offsets = NULL;
+    grid_codec->map = NULL;
+    grid_codec->map_length = 0;
+    grid_codec->saved_pixels = NULL;
     grid_codec->little_endian = endian;
     img->codec_data = grid_codec;
 
-/* allocating the GRID read buffer */
-    if (sample == GGRAPH_SAMPLE_INT)
-      {
-	  if (bits_per_sample == 16)
-	      buf_size = sizeof (short) * width;
-	  if (bits_per_sample == 32)
-	      buf_size = sizeof (int) * width;
-      }
-    if (sample == GGRAPH_SAMPLE_FLOAT)
-      {
-	  if (bits_per_sample == 32)
-	      buf_size = sizeof (float) * width;
-	  if (bits_per_sample == 64)
-	      buf_size = sizeof (double) * width;
-      }
-    grid_buffer = malloc (buf_size);
-    if (!grid_buffer)
-	goto error;
-    grid_codec->grid_buffer = grid_buffer;
+/* attempting to map the whole GRID file into memory */
+    grid_map_file (grid_codec, in, file_length);
 
     *image_handle = img;
     return GGRAPH_OK;
@@ -1751,8 +1854,6 @@ gg_image_strip_prepare_from_dem_hdr (FILE * in, const char *hdr_path,
     int bits_per_sample;
     int endian;
     double no_data;
-    int buf_size;
-    void *grid_buffer = NULL;
     int ret = GGRAPH_DEM_CODEC_ERROR;
     *image_handle = NULL;
 
@@ -1793,18 +1894,14 @@ gg_image_strip_prepare_from_dem_hdr (FILE * in, const char *hdr_path,
     grid_codec->is_writer = 0;
     grid_codec->grid_buffer = NULL;
     grid_codec->row_offsets = NULL;
+    grid_codec->map = NULL;
+    grid_codec->map_length = 0;
+    grid_codec->saved_pixels = NULL;
     grid_codec->little_endian = endian;
     img->codec_data = grid_codec;
 
-/* allocating the GRID read buffer */
-    if (bits_per_sample == 16)
-	buf_size = sizeof (short) * width;
-    if (bits_per_sample == 32)
-	buf_size = sizeof (int) * width;
-    grid_buffer = malloc (buf_size);
-    if (!grid_buffer)
-	goto error;
-    grid_codec->grid_buffer = grid_buffer;
+/* attempting to map the whole GRID file into memory */
+    grid_map_file (grid_codec, in, file_length);
 
     *image_handle = img;
     return GGRAPH_OK;
@@ -1816,31 +1913,72 @@ gg_image_strip_prepare_from_dem_hdr (FILE * in, const char *hdr_path,
 }
 
 static int
-parse_asc_offsets (FILE * in, int height, long **row_offsets)
+parse_asc_offsets (FILE * in, struct grid_codec_data *codec, int height,
+		   long *offsets)
 {
-/* retrieving row-offsets from an ASC file [ASCII GRID format] */
-    int c;
+/*
+/ retrieving row-offsets from an ASC file [ASCII GRID format]
+/
+/ newlines are located by memchr(), scanning the file mapping
+/ or else reading the file a whole block at a time
+/ offsets[height] marks the end of the last scanline
+*/
     int row = 0;
     int ind = 0;
-    long *offsets = *row_offsets;
-    long current = 0;
-
-    rewind (in);
-    while ((c = getc (in)) != EOF)
+    long base = 0;
+    size_t len;
+    unsigned char *buf = NULL;
+    unsigned char *block;
+    unsigned char *p;
+    unsigned char *end;
+
+    if (codec->map == NULL)
       {
-	  /* parsing the Header file */
-	  if (c == '\n')
+	  buf = malloc (ASC_BLOCK_SIZE);
+	  if (!buf)
+	      return 0;
+	  rewind (in);
+      }
+    while (1)
+      {
+	  if (buf == NULL)
+	    {
+		/* scanning the whole file mapping at once */
+		if (base != 0)
+		    break;
+		block = codec->map;
+		len = codec->map_length;
+	    }
+	  else
+	    {
+		block = buf;
+		len = fread (buf, 1, ASC_BLOCK_SIZE, in);
+	    }
+	  if (len == 0)
+	      break;
+	  p = block;
+	  end = block + len;
+	  while ((p = memchr (p, '\n', end - p)) != NULL)
 	    {
 		row++;
 		if (row >= 6)
 		  {
-		      if (ind < height)
-			  *(offsets + ind) = current;
-		      ind++;
+		      if (ind > height)
+			{
+			    /* too many scanlines */
+			    ind++;
+			    goto stop;
+			}
+		      offsets[ind++] = base + (long) (p - block);
 		  }
+		p++;
 	    }
-	  current++;
+	  base += (long) len;
       }
+
+  stop:
+    if (buf)
+	free (buf);
     if (ind != height + 1)
 	return 0;
     return 1;
@@ -1860,7 +1998,7 @@ gg_image_strip_prepare_from_ascii_grid (FILE * in,
     double pixel_x_size;
     double pixel_y_size;
     double no_data;
-    long *row_offsets = NULL;
+    long file_length;
     int ret = GGRAPH_ASCII_CODEC_ERROR;
     *image_handle = NULL;
 
@@ -1868,16 +2006,31 @@ gg_image_strip_prepare_from_ascii_grid (FILE * in,
 	(NULL, in, &width, &height, &ulx, &uly, &pixel_x_size, &pixel_y_size,
 	 &no_data))
 	return GGRAPH_ASCII_CODEC_ERROR;
+    if (fseek (in, 0, SEEK_END) != 0)
+	return GGRAPH_ASCII_CODEC_ERROR;
+    file_length = ftell (in);
+
+/* setting up the GRID codec struct */
+    grid_codec = malloc (sizeof (struct grid_codec_data));
+    if (!grid_codec)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    grid_codec->grid_type = GRID_ASCII;
+    grid_codec->is_writer = 0;
+    grid_codec->grid_buffer = NULL;
+    grid_codec->row_offsets = NULL;
+    grid_codec->map = NULL;
+    grid_codec->map_length = 0;
+    grid_codec->saved_pixels = NULL;
+
+/* attempting to map the whole GRID file into memory */
+    grid_map_file (grid_codec, in, file_length);
 
 /* preparing the row-offset array */
-    row_offsets = malloc (sizeof (long) * height);
-    if (!row_offsets)
-	return GGRAPH_ASCII_CODEC_ERROR;
-    if (!parse_asc_offsets (in, height, &row_offsets))
-      {
-	  free (row_offsets);
-	  return GGRAPH_ASCII_CODEC_ERROR;
-      }
+    grid_codec->row_offsets = malloc (sizeof (long) * (height + 1));
+    if (!grid_codec->row_offsets)
+	goto error;
+    if (!parse_asc_offsets (in, grid_codec, height, grid_codec->row_offsets))
+	goto error;
 
     img =
 	gg_strip_image_create (in, GGRAPH_IMAGE_ASCII_GRID, GG_PIXEL_GRID,
@@ -1896,146 +2049,18 @@ gg_image_strip_prepare_from_ascii_grid (FILE * in,
     img->pixel_x_size = pixel_x_size;
     img->pixel_y_size = pixel_y_size;
     img->no_data_value = no_data;
-
-/* setting up the GRID codec struct */
-    grid_codec = malloc (sizeof (struct grid_codec_data));
-    if (!grid_codec)
-	goto error;
-    grid_codec->grid_type = GRID_ASCII;
-    grid_codec->is_writer = 0;
-    grid_codec->grid_buffer = NULL;
-    grid_codec->row_offsets = row_offsets;
     img->codec_data = grid_codec;
 
     *image_handle = img;
     return GGRAPH_OK;
 
   error:
+    gg_grid_codec_destroy (grid_codec);
     if (img)
 	gGraphDestroyImage (img);
     return ret;
 }
 
-static int
-read_from_bin_grid (FILE * in, gGraphStripImagePtr img, int sample,
-		    int bits_per_pixel, int type, void *scanline, int endian)
-{
-/* decoding a BIN-GRID or a FLT-GRID [by strip] */
-    int width = img->width;
-    int height = img->height;
-    size_t scan_size;
-    int row;
-    int incr = 0;
-    int x;
-    int endian_arch = gg_endian_arch ();
-    off_t pos;
-    unsigned char *p_in;
-    short *p_out_short;
-    short cell_value_short;
-    int *p_out_int;
-    int cell_value_int;
-    float *p_out_float;
-    float cell_value_float;
-    double *p_out_double;
-    double cell_value_double;
-
-    if (bits_per_pixel == 16)
-	scan_size = width * 2;
-    if (bits_per_pixel == 32)
-	scan_size = width * 4;
-    if (bits_per_pixel == 64)
-	scan_size = width * 8;
-    pos = img->next_row * scan_size;
-/* positioning on the start scanline */
-    if (fseek (in, pos, SEEK_SET) != 0)
-      {
-	  if (type == GRID_BIN_HDR)
-	      return GGRAPH_BIN_CODEC_ERROR;
-	  if (type == GRID_FLT_HDR)
-	      return GGRAPH_FLT_CODEC_ERROR;
-	  if (type == GRID_DEM_HDR)
-	      return GGRAPH_DEM_CODEC_ERROR;
-      }
-    for (row = 0; row < img->rows_per_block; row++)
-      {
-	  /* reading the required number of scanlines */
-	  if ((row + img->next_row) >= height)
-	      break;
-	  if (fread (scanline, 1, scan_size, in) != scan_size)
-	      return GGRAPH_HGT_CODEC_ERROR;
-	  p_in = scanline;
-	  if (sample == GGRAPH_SAMPLE_INT)
-	    {
-		if (bits_per_pixel == 16)
-		  {
-		      p_out_short = (short *) (img->pixels);
-		      p_out_short += (row * width);
-		  }
-
-		if (bits_per_pixel == 32)
-		  {
-		      p_out_int = (int *) (img->pixels);
-		      p_out_int += (row * width);
-		  }
-	    }
-	  if (sample == GGRAPH_SAMPLE_FLOAT)
-	    {
-		if (bits_per_pixel == 32)
-		  {
-		      p_out_float = (float *) (img->pixels);
-		      p_out_float += (row * width);
-		  }
-
-		if (bits_per_pixel == 64)
-		  {
-		      p_out_double = (double *) (img->pixels);
-		      p_out_double += (row * width);
-		  }
-	    }
-	  for (x = 0; x < width; x++)
-	    {
-		if (sample == GGRAPH_SAMPLE_INT)
-		  {
-		      if (bits_per_pixel == 16)
-			{
-			    cell_value_short =
-				gg_import_int16 (p_in, endian, endian_arch);
-			    *p_out_short++ = cell_value_short;
-			    p_in += sizeof (short);
-			}
-		      if (bits_per_pixel == 32)
-			{
-			    cell_value_int =
-				gg_import_int32 (p_in, endian, endian_arch);
-			    *p_out_int++ = cell_value_int;
-			    p_in += sizeof (int);
-			}
-		  }
-		if (sample == GGRAPH_SAMPLE_FLOAT)
-		  {
-		      if (bits_per_pixel == 32)
-			{
-			    cell_value_float =
-				gg_import_float (p_in, endian, endian_arch);
-			    *p_out_float++ = cell_value_float;
-			    p_in += sizeof (float);
-			}
-		      if (bits_per_pixel == 64)
-			{
-			    cell_value_double =
-				gg_import_double (p_in, endian, endian_arch);
-			    *p_out_double++ = cell_value_double;
-			    p_in += sizeof (double);
-			}
-		  }
-	    }
-	  incr++;
-      }
-    img->next_row += incr;
-    img->current_available_rows = incr;
-    return GGRAPH_OK;
-}
-
 GGRAPH_PRIVATE int
 gg_image_strip_read_from_bin_grid (gGraphStripImagePtr img, int *progress)
 {
@@ -2047,11 +2072,10 @@ gg_image_strip_read_from_bin_grid (gGraphStripImagePtr img, int *progress)
     if (grid_codec->grid_type == GRID_BIN_HDR
 	|| grid_codec->grid_type == GRID_FLT_HDR)
       {
-	  int ret = read_from_bin_grid (in, img, img->sample_format,
-					img->bits_per_sample,
-					grid_codec->grid_type,
-					grid_codec->grid_buffer,
-					grid_codec->little_endian);
+	  int ret = read_raw_grid (in, img, grid_codec->little_endian,
+				   (grid_codec->grid_type == GRID_BIN_HDR) ?
+				   GGRAPH_BIN_CODEC_ERROR :
+				   GGRAPH_FLT_CODEC_ERROR);
 	  if (ret == GGRAPH_OK && progress != NULL)
 	      *progress =
 		  (int) (((double) (img->next_row + 1) * 100.0) /
@@ -2071,11 +2095,8 @@ gg_image_strip_read_from_dem_grid (gGraphStripImagePtr img, int *progress)
 
     if (grid_codec->grid_type == GRID_DEM_HDR)
       {
-	  int ret = read_from_bin_grid (in, img, img->sample_format,
-					img->bits_per_sample,
-					grid_codec->grid_type,
-					grid_codec->grid_buffer,
-					grid_codec->little_endian);
+	  int ret = read_raw_grid (in, img, grid_codec->little_endian,
+				   GGRAPH_DEM_CODEC_ERROR);
 	  if (ret == GGRAPH_OK && progress != NULL)
 	      *progress =
 		  (int) (((double) (img->next_row + 1) * 100.0) /
@@ -2085,65 +2106,205 @@ gg_image_strip_read_from_dem_grid (gGraphStripImagePtr img, int *progress)
     return GGRAPH_ERROR;
 }
 
+static void
+asc_locale_point (char *buf, size_t size)
+{
+/*
+/ replacing the '.' decimal point of some ASCII GRID value by the
+/ locale dependent one expected by atof() [the buffer must be big
+/ enough to hold the expanded string]
+*/
+    const char *point = localeconv ()->decimal_point;
+    size_t len = strlen (point);
+    char *found;
+    if (len > 0 && !(len == 1 && *point == '.'))
+      {
+	  found = strchr (buf, '.');
+	  if (found && strlen (buf) + len < size)
+	    {
+		memmove (found + len, found + 1, strlen (found + 1) + 1);
+		memcpy (found, point, len);
+	    }
+      }
+}
+
+static const char *
+parse_asc_cell (const char *p, const char *end, float *value)
+{
+/*
+/ parsing a single ASCII GRID cell value [locale independent]
+/
+/ plain decimal values are exactly converted by scaling an integer
+/ mantissa by a power of ten; anything else (too many digits, huge
+/ exponents, NaN ...) will be converted by atof(), after replacing
+/ the '.' decimal point by the current locale one
+*/
+    static const double powers[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *start = p;
+    double mantissa = 0.0;
+    int digits = 0;
+    int any_digit = 0;
+    int exponent = 0;
+    int exp_value = 0;
+    int exp_negative = 0;
+    int negative = 0;
+    int fast = 1;
+    char buf[256];
+    size_t len;
+
+    if (*p == '-' || *p == '+')
+      {
+	  negative = (*p == '-');
+	  p++;
+      }
+    while (p < end && *p >= '0' && *p <= '9')
+      {
+	  /* integer part */
+	  if (mantissa != 0.0 || *p != '0')
+	      digits++;
+	  mantissa = (mantissa * 10.0) + (*p - '0');
+	  any_digit = 1;
+	  p++;
+      }
+    if (p < end && *p == '.')
+      {
+	  /* fractional part */
+	  p++;
+	  while (p < end && *p >= '0' && *p <= '9')
+	    {
+		if (mantissa != 0.0 || *p != '0')
+		    digits++;
+		mantissa = (mantissa * 10.0) + (*p - '0');
+		exponent--;
+		any_digit = 1;
+		p++;
+	    }
+      }
+    if (p < end && (*p == 'e' || *p == 'E'))
+      {
+	  /* exponent */
+	  p++;
+	  if (p < end && (*p == '-' || *p == '+'))
+	    {
+		exp_negative = (*p == '-');
+		p++;
+	    }
+	  if (p >= end || *p < '0' || *p > '9')
+	      fast = 0;
+	  while (p < end && *p >= '0' && *p <= '9')
+	    {
+		if (exp_value < 10000)
+		    exp_value = (exp_value * 10) + (*p - '0');
+		p++;
+	    }
+	  exponent += exp_negative ? -exp_value : exp_value;
+      }
+    if (p < end && *p != '\n' && !ASC_IS_BLANK (*p))
+	fast = 0;
+    if (fast && any_digit && digits <= 15 && exponent >= -22 && exponent <= 22)
+      {
+	  /* both mantissa and power of ten are exact doubles */
+	  if (exponent < 0)
+	      mantissa /= powers[-exponent];
+	  else
+	      mantissa *= powers[exponent];
+	  *value = (float) (negative ? -mantissa : mantissa);
+	  return p;
+      }
+
+/* slow path */
+    p = start;
+    while (p < end && *p != '\n' && !ASC_IS_BLANK (*p))
+	p++;
+    len = p - start;
+    if (len >= sizeof (buf) - 8)
+	return NULL;
+    memcpy (buf, start, len);
+    buf[len] = '\0';
+    asc_locale_point (buf, sizeof (buf));
+    *value = atof (buf);
+    return p;
+}
+
 static int
-read_from_ascii_grid (FILE * in, gGraphStripImagePtr img, long *row_offsets)
+read_from_ascii_grid (FILE * in, gGraphStripImagePtr img,
+		      struct grid_codec_data *grid_codec)
 {
-/* decoding an ASCII-GRID [by strip] */
+/*
+/ decoding an ASCII-GRID [by strip]
+/
+/ the whole block of scanlines is parsed straight from the file mapping
+/ or else is loaded by a single fread()
+*/
     int width = img->width;
-    int height = img->height;
+    int rows = img->rows_per_block;
+    long *row_offsets = grid_codec->row_offsets;
+    long start;
+    size_t length;
+    const char *p;
+    const char *end;
     int row;
-    int incr = 0;
     int col;
-    int c;
     float *p_out;
-    float cell_value;
-    char buf[256];
-    char *p;
 
-/* positioning on the start scanline */
-    if (fseek (in, row_offsets[img->next_row], SEEK_SET) != 0)
+    if (img->pixels == NULL)
 	return GGRAPH_ASCII_CODEC_ERROR;
-    if (getc (in) != '\n')
+    if (img->next_row + rows > img->height)
+	rows = img->height - img->next_row;
+    start = row_offsets[img->next_row];
+    length = (size_t) (row_offsets[img->next_row + rows] - start) + 1;
+    if (grid_codec->map != NULL
+	&& (size_t) start + length <= grid_codec->map_length)
+	p = (const char *) (grid_codec->map + start);
+    else
+      {
+	  /* reading the whole block of scanlines at once */
+	  void *buf = realloc (grid_codec->grid_buffer, length);
+	  if (!buf)
+	      return GGRAPH_INSUFFICIENT_MEMORY;
+	  grid_codec->grid_buffer = buf;
+	  if (fseek (in, start, SEEK_SET) != 0)
+	      return GGRAPH_ASCII_CODEC_ERROR;
+	  if (fread (buf, 1, length, in) != length)
+	      return GGRAPH_ASCII_CODEC_ERROR;
+	  p = buf;
+      }
+    end = p + length;
+
+/* positioning on the start scanline */
+    if (*p++ != '\n')
 	return GGRAPH_ASCII_CODEC_ERROR;
 
-    for (row = 0; row < img->rows_per_block; row++)
+    for (row = 0; row < rows; row++)
       {
-	  /* reading the required number of scanlines */
-	  if ((row + img->next_row) >= height)
-	      break;
+	  /* parsing the required number of scanlines */
 	  p_out = (float *) (img->pixels);
 	  p_out += row * width;
-	  p = buf;
 	  col = 0;
-	  while ((c = getc (in)) != EOF)
+	  while (1)
 	    {
 		/* parsing cell values */
-		if (c == '\r')
-		    continue;
-		if (c == '\n')
+		while (p < end && ASC_IS_BLANK (*p))
+		    p++;
+		if (p >= end || *p == '\n')
 		    break;
-		if (c == ' ')
-		  {
-		      /* cell end */
-		      *p = '\0';
-		      cell_value = atof (buf);
-		      if (col >= width)
-			  return GGRAPH_ASCII_CODEC_ERROR;
-		      *p_out++ = cell_value;
-		      col++;
-		      p = buf;
-		      continue;
-		  }
-		if ((p - buf) >= 256)
+		if (col >= width)
+		    return GGRAPH_ASCII_CODEC_ERROR;
+		p = parse_asc_cell (p, end, p_out++);
+		if (p == NULL)
 		    return GGRAPH_ASCII_CODEC_ERROR;
-		*p++ = c;
+		col++;
 	    }
 	  if (col != width)
 	      return GGRAPH_ASCII_CODEC_ERROR;
-	  incr++;
+	  /* skipping the scanline terminator */
+	  p++;
       }
-    img->next_row += incr;
-    img->current_available_rows = incr;
+    img->next_row += rows;
+    img->current_available_rows = rows;
     return GGRAPH_OK;
 }
 
@@ -2157,7 +2318,7 @@ gg_image_strip_read_from_ascii_grid (gGraphStripImagePtr img, int *progress)
 
     if (grid_codec->grid_type == GRID_ASCII)
       {
-	  int ret = read_from_ascii_grid (in, img, grid_codec->row_offsets);
+	  int ret = read_from_ascii_grid (in, img, grid_codec);
 	  if (ret == GGRAPH_OK && progress != NULL)
 	      *progress =
 		  (int) (((double) (img->next_row + 1) * 100.0) /
@@ -2189,11 +2350,168 @@ gg_image_prepare_to_ascii_grid_by_strip (const gGraphStripImagePtr img,
     return GGRAPH_OK;
 }
 
+static char *
+format_asc_uint (unsigned int value, char *p)
+{
+/* formatting an unsigned integer cell value */
+    char digits[16];
+    int n = 0;
+    do
+      {
+	  digits[n++] = '0' + (value % 10);
+	  value /= 10;
+      }
+    while (value);
+    while (n > 0)
+	*p++ = digits[--n];
+    return p;
+}
+
+static char *
+format_asc_int (int value, char *p)
+{
+/* formatting a signed integer cell value */
+    if (value < 0)
+      {
+	  *p++ = '-';
+	  return format_asc_uint (0u - (unsigned int) value, p);
+      }
+    return format_asc_uint ((unsigned int) value, p);
+}
+
+static char *
+asc_decimal_point (char *p)
+{
+/*
+/ replacing the locale dependent decimal point of some sprintf()
+/ output by '.' [returns a pointer to the string terminator]
+*/
+    const char *point = localeconv ()->decimal_point;
+    int len = strlen (point);
+    char *found;
+    if (len > 0 && !(len == 1 && *point == '.'))
+      {
+	  found = strstr (p, point);
+	  if (found)
+	    {
+		*found = '.';
+		memmove (found + 1, found + len, strlen (found + len) + 1);
+	    }
+      }
+    return p + strlen (p);
+}
+
+static char *
+format_asc_float (double value, int single_precision, char *p)
+{
+/*
+/ formatting a floating point cell value
+/
+/ the fewest decimal digits still converting back to the same
+/ float [or double] are used; the decimal mantissa is kept below 10^15,
+/ so that it's exactly converted back by scaling it by a power of ten
+/ anything else (huge or tiny values, NaN ...) is formatted by sprintf()
+/ using the shortest precision still converting back to the same value;
+/ the decimal point always is '.' whatever the current locale is
+*/
+    static const double powers[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    double abs_value = fabs (value);
+    double scaled;
+    double mantissa;
+    double back;
+    unsigned int hi;
+    unsigned int lo;
+    int decimals;
+    int precision = single_precision ? 6 : 15;
+    int n;
+    char digits[32];
+
+    if (value == value && abs_value < 1e15)
+      {
+	  for (decimals = 0; decimals <= 22; decimals++)
+	    {
+		scaled = abs_value * powers[decimals];
+		if (scaled >= 1e15)
+		  {
+		      /* at least 16 digits are needed: simply using 17 */
+		      precision = single_precision ? 9 : 17;
+		      break;
+		  }
+		mantissa = floor (scaled + 0.5);
+		back = mantissa / powers[decimals];
+		if (single_precision)
+		  {
+		      if ((float) back == (float) abs_value)
+			  goto found;
+		  }
+		else if (back == abs_value)
+		    goto found;
+	    }
+      }
+    for (; precision < (single_precision ? 9 : 17); precision++)
+      {
+	  sprintf (p, "%1.*g", precision, value);
+	  back = atof (p);
+	  if (single_precision)
+	    {
+		if ((float) back == (float) value)
+		    return asc_decimal_point (p);
+	    }
+	  else if (back == value)
+	      return asc_decimal_point (p);
+      }
+    sprintf (p, "%1.*g", precision, value);
+    return asc_decimal_point (p);
+
+  found:
+/* splitting the mantissa into two exact 32 bit halves */
+    hi = (unsigned int) (mantissa / 1e8);
+    lo = (unsigned int) (mantissa - ((double) hi * 1e8));
+    n = 0;
+    do
+      {
+	  digits[n++] = '0' + (lo % 10);
+	  lo /= 10;
+      }
+    while (lo);
+    if (hi)
+      {
+	  while (n < 8)
+	      digits[n++] = '0';
+	  do
+	    {
+		digits[n++] = '0' + (hi % 10);
+		hi /= 10;
+	    }
+	  while (hi);
+      }
+/* always having at least one integer digit */
+    while (n <= decimals)
+	digits[n++] = '0';
+    if (value < 0.0 || (value == 0.0 && 1.0 / value < 0.0))
+	*p++ = '-';
+    while (n > 0)
+      {
+	  *p++ = digits[--n];
+	  if (n == decimals && n > 0)
+	      *p++ = '.';
+      }
+    return p;
+}
+
 GGRAPH_PRIVATE int
 gg_image_write_to_ascii_grid_by_strip (const gGraphStripImagePtr img,
 				       int *progress)
 {
-/* scanline(s) ASCII GRID export [by strip] */
+/*
+/ scanline(s) ASCII GRID export [by strip]
+/
+/ cell values are formatted into a large memory buffer,
+/ then written by a single fwrite() every time the buffer gets full
+*/
     FILE *out = img->file_handle;
     int row;
     int col;
@@ -2205,8 +2523,14 @@ gg_image_write_to_ascii_grid_by_strip (const gGraphStripImagePtr img,
     unsigned int *p_in_uint32;
     float *p_in_flt;
     double *p_in_dbl;
-    char dummy[256];
+    char *buf;
+    char *p_buf;
+    size_t sz;
 
+    buf = malloc (ASC_OUT_BUFFER_SIZE);
+    if (!buf)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    p_buf = buf;
     for (row = 0; row < img->current_available_rows; row++)
       {
 	  switch (img->sample_format)
@@ -2261,19 +2585,27 @@ gg_image_write_to_ascii_grid_by_strip (const gGraphStripImagePtr img,
 	    };
 	  for (col = 0; col < img->width; col++)
 	    {
+		if (p_buf - buf > ASC_OUT_BUFFER_SIZE - ASC_MAX_CELL_TEXT)
+		  {
+		      /* flushing the output buffer */
+		      sz = p_buf - buf;
+		      if (fwrite (buf, 1, sz, out) != sz)
+			  goto error;
+		      p_buf = buf;
+		  }
 		switch (img->sample_format)
 		  {
 		  case GGRAPH_SAMPLE_UINT:
 		      switch (img->bits_per_sample)
 			{
 			case 8:
-			    sprintf (dummy, "%u", *p_in_uint8++);
+			    p_buf = format_asc_uint (*p_in_uint8++, p_buf);
 			    break;
 			case 16:
-			    sprintf (dummy, "%u", *p_in_uint16++);
+			    p_buf = format_asc_uint (*p_in_uint16++, p_buf);
 			    break;
 			case 32:
-			    sprintf (dummy, "%u", *p_in_uint32++);
+			    p_buf = format_asc_uint (*p_in_uint32++, p_buf);
 			    break;
 			};
 		      break;
@@ -2281,13 +2613,13 @@ gg_image_write_to_ascii_grid_by_strip (const gGraphStripImagePtr img,
 		      switch (img->bits_per_sample)
 			{
 			case 8:
-			    sprintf (dummy, "%d", *p_in_int8++);
+			    p_buf = format_asc_int (*p_in_int8++, p_buf);
 			    break;
 			case 16:
-			    sprintf (dummy, "%d", *p_in_int16++);
+			    p_buf = format_asc_int (*p_in_int16++, p_buf);
 			    break;
 			case 32:
-			    sprintf (dummy, "%d", *p_in_int32++);
+			    p_buf = format_asc_int (*p_in_int32++, p_buf);
 			    break;
 			};
 		      break;
@@ -2295,19 +2627,24 @@ gg_image_write_to_ascii_grid_by_strip (const gGraphStripImagePtr img,
 		      switch (img->bits_per_sample)
 			{
 			case 32:
-			    gGraphSmartPrintf (*p_in_flt++, dummy);
+			    p_buf = format_asc_float (*p_in_flt++, 1, p_buf);
 			    break;
 			case 64:
-			    gGraphSmartPrintf (*p_in_dbl++, dummy);
+			    p_buf = format_asc_float (*p_in_dbl++, 0, p_buf);
 			    break;
 			};
 		      break;
 		  };
-		fprintf (out, "%s ", dummy);
+		*p_buf++ = ' ';
 	    }
 	  /* terminating a full scanline */
-	  fprintf (out, "\r\n");
+	  *p_buf++ = '\r';
+	  *p_buf++ = '\n';
       }
+    sz = p_buf - buf;
+    if (fwrite (buf, 1, sz, out) != sz)
+	goto error;
+    free (buf);
     img->next_row += img->current_available_rows;
 
     if (progress != NULL)
@@ -2315,6 +2652,10 @@ gg_image_write_to_ascii_grid_by_strip (const gGraphStripImagePtr img,
 	    (int) (((double) (img->next_row + 1) * 100.0) /
 		   (double) (img->height));
     return GGRAPH_OK;
+
+  error:
+    free (buf);
+    return GGRAPH_ASCII_CODEC_ERROR;
 }
 
 GGRAPH_PRIVATE int
@@ -2340,6 +2681,9 @@ gg_image_prepare_to_bin_hdr_by_strip (const gGraphStripImagePtr img)
     grid_codec->is_writer = 1;
     grid_codec->grid_buffer = NULL;
     grid_codec->row_offsets = NULL;
+    grid_codec->map = NULL;
+    grid_codec->map_length = 0;
+    grid_codec->saved_pixels = NULL;
 
 /* allocating the GRID read buffer */
     if (img->bits_per_sample == 16)
@@ -2381,6 +2725,9 @@ gg_image_prepare_to_flt_hdr_by_strip (const gGraphStripImagePtr img)
     grid_codec->is_writer = 1;
     grid_codec->grid_buffer = NULL;
     grid_codec->row_offsets = NULL;
+    grid_codec->map = NULL;
+    grid_codec->map_length = 0;
+    grid_codec->saved_pixels = NULL;
 
 /* allocating the GRID read buffer */
     if (img->bits_per_sample == 32)
@@ -193,6 +193,8 @@ gg_image_create (int pixel_format, int width, int height, int bits_per_sample,
     img->sample_format = sample_format;
     img->pixel_format = pixel_format;
     img->max_palette = 0;
+    img->palette_cache = NULL;
+    img->palette_version = 0;
     img->is_transparent = 0;
     img->tile_width = -1;
     img->tile_height = -1;
@@ -346,6 +348,8 @@ gg_image_create_from_bitmap (unsigned char *bitmap, int pixel_format, int width,
     img->sample_format = sample_format;
     img->pixel_format = pixel_format;
     img->max_palette = 0;
+    img->palette_cache = NULL;
+    img->palette_version = 0;
     img->is_transparent = 0;
     img->tile_width = -1;
     img->tile_height = -1;
@@ -438,6 +442,8 @@ gg_image_destroy (gGraphImagePtr img)
 	free (img->srs_name);
     if (img->proj4text)
 	free (img->proj4text);
+    if (img->palette_cache)
+	gg_palette_cache_destroy (img->palette_cache);
     free (img);
 }
 
@@ -516,6 +522,9 @@ gg_strip_image_create (FILE * file_handle, int codec_id, int pixel_format,
     img->sample_format = sample_format;
     img->pixel_format = pixel_format;
     img->max_palette = 0;
+    img->palette_cache = NULL;
+    img->palette_version = 0;
+    img->dither = NULL;
     img->is_transparent = 0;
     img->tile_width = -1;
     img->tile_height = -1;
@@ -607,8 +616,17 @@ gg_strip_image_destroy (gGraphStripImagePtr img)
     if (img->codec_id == GGRAPH_IMAGE_TIFF
 	|| img->codec_id == GGRAPH_IMAGE_GEOTIFF)
 	gg_tiff_codec_destroy (img->codec_data);
-    if (img->codec_id == GGRAPH_IMAGE_HGT)
-	gg_grid_codec_destroy (img->codec_data);
+    if (img->codec_id == GGRAPH_IMAGE_HGT
+	|| img->codec_id == GGRAPH_IMAGE_BIN_HDR
+	|| img->codec_id == GGRAPH_IMAGE_FLT_HDR
+	|| img->codec_id == GGRAPH_IMAGE_DEM_HDR
+	|| img->codec_id == GGRAPH_IMAGE_ASCII_GRID)
+      {
+	  gg_grid_codec_restore_pixels (img);
+	  gg_grid_codec_destroy (img->codec_data);
+      }
+    if (img->codec_id == GG_STRIP_RESIZER)
+	gg_strip_resizer_destroy (img->codec_data);
     if (img->file_handle)
 	fclose (img->file_handle);
     if (img->pixels)
@@ -617,6 +635,10 @@ gg_strip_image_destroy (gGraphStripImagePtr img)
 	free (img->srs_name);
     if (img->proj4text)
 	free (img->proj4text);
+    if (img->palette_cache)
+	gg_palette_cache_destroy (img->palette_cache);
+    if (img->dither)
+	gg_dither_destroy (img->dither);
     free (img);
 }
 
@@ -792,6 +814,7 @@ gg_image_sub_set (const gGraphImagePtr dst, const gGraphImagePtr src,
 		dst->palette_blue[x] = src->palette_blue[x];
 	    }
 	  dst->max_palette = src->max_palette;
+	  dst->palette_version++;
       }
 
 /* computing georeferencing */
@@ -824,6 +847,7 @@ gg_image_fill (const gGraphImagePtr img, unsigned char r, unsigned char g,
 
 /* resetting the palette anyway */
     img->max_palette = 1;
+    img->palette_version++;
     img->palette_red[0] = r;
     img->palette_green[0] = g;
     img->palette_blue[0] = b;
@@ -882,43 +906,40 @@ gg_image_fill (const gGraphImagePtr img, unsigned char r, unsigned char g,
       }
 }
 
-GGRAPH_PRIVATE unsigned char
-gg_match_palette (const gGraphImagePtr img, unsigned char r, unsigned char g,
-		  unsigned char b)
+static unsigned char
+palette_match_linear (int *max_palette, unsigned char *red,
+		      unsigned char *green, unsigned char *blue,
+		      unsigned char r, unsigned char g, unsigned char b)
 {
-/* handling palette colors */
+/* handling palette colors [plain linear search] */
     int index;
     double min_dist = DBL_MAX;
     double dist;
-    int min_index;
-    for (index = 0; index < img->max_palette; index++)
+    int min_index = 0;
+    for (index = 0; index < *max_palette; index++)
       {
 	  /* searching if already defined */
-	  if (img->palette_red[index] == r && img->palette_green[index] == g
-	      && img->palette_blue[index] == b)
+	  if (red[index] == r && green[index] == g && blue[index] == b)
 	      return (unsigned char) index;
       }
-    if (img->max_palette < 255)
+    if (*max_palette < 255)
       {
 	  /* inserting a new palette entry */
-	  unsigned char i = img->max_palette;
-	  img->max_palette += 1;
-	  img->palette_red[i] = r;
-	  img->palette_green[i] = g;
-	  img->palette_blue[i] = b;
+	  unsigned char i = *max_palette;
+	  *max_palette += 1;
+	  red[i] = r;
+	  green[i] = g;
+	  blue[i] = b;
 	  return i;
       }
 /* all right, the palette is already fully populated */
-    for (index = 0; index < img->max_palette; index++)
+    for (index = 0; index < *max_palette; index++)
       {
 	  /* computing the minimal euclidean distance */
 	  dist =
-	      sqrt (((img->palette_red[index] - r) * (img->palette_red[index] -
-						      r)) +
-		    ((img->palette_green[index] -
-		      g) * (img->palette_green[index] - g)) +
-		    ((img->palette_blue[index] -
-		      b) * (img->palette_blue[index] - b)));
+	      sqrt (((red[index] - r) * (red[index] - r)) +
+		    ((green[index] - g) * (green[index] - g)) +
+		    ((blue[index] - b) * (blue[index] - b)));
 	  if (dist < min_dist)
 	    {
 		min_dist = dist;
@@ -928,8 +949,549 @@ gg_match_palette (const gGraphImagePtr img, unsigned char r, unsigned char g,
     return (unsigned char) min_index;
 }
 
+static int
+palette_cache_hash (unsigned char r, unsigned char g, unsigned char b)
+{
+/* computing the hash bucket of some color */
+    unsigned int key = (r << 16) | (g << 8) | b;
+    return ((key * 2654435761U) >> 22) & (GG_PALETTE_HASH_SIZE - 1);
+}
+
+static int
+palette_cache_lookup (gGraphPaletteCachePtr cache, unsigned char r,
+		      unsigned char g, unsigned char b)
+{
+/* searching an exact match [returns -1 if not found] */
+    int index;
+    int bucket = palette_cache_hash (r, g, b);
+    while (cache->hash[bucket] != 0)
+      {
+	  index = cache->hash[bucket] - 1;
+	  if (cache->red[index] == r && cache->green[index] == g
+	      && cache->blue[index] == b)
+	      return index;
+	  bucket = (bucket + 1) & (GG_PALETTE_HASH_SIZE - 1);
+      }
+    return -1;
+}
+
+static void
+palette_cache_insert (gGraphPaletteCachePtr cache, int index)
+{
+/*
+/ inserting a palette entry into the exact match table
+/ duplicate colors always resolve to their first entry
+*/
+    unsigned char r = cache->red[index];
+    unsigned char g = cache->green[index];
+    unsigned char b = cache->blue[index];
+    int bucket = palette_cache_hash (r, g, b);
+    while (cache->hash[bucket] != 0)
+      {
+	  int i = cache->hash[bucket] - 1;
+	  if (cache->red[i] == r && cache->green[i] == g && cache->blue[i] == b)
+	      return;
+	  bucket = (bucket + 1) & (GG_PALETTE_HASH_SIZE - 1);
+      }
+    cache->hash[bucket] = index + 1;
+}
+
+static void
+palette_cache_sync (gGraphPaletteCachePtr cache, int max_palette,
+		    const unsigned char *red, const unsigned char *green,
+		    const unsigned char *blue)
+{
+/* rebuilding the inverse colormap so to reflect the current palette */
+    int i;
+    memset (cache->hash, 0, sizeof (short) * GG_PALETTE_HASH_SIZE);
+    if (cache->cells)
+	memset (cache->cells, 0, sizeof (int) * GG_PALETTE_CUBE_CELLS);
+    cache->candidates_used = 0;
+    cache->max_palette = max_palette;
+    memcpy (cache->red, red, max_palette);
+    memcpy (cache->green, green, max_palette);
+    memcpy (cache->blue, blue, max_palette);
+    for (i = 0; i < max_palette; i++)
+	palette_cache_insert (cache, i);
+}
+
+static int
+palette_cache_fill_cell (gGraphPaletteCachePtr cache, int cell)
+{
+/*
+/ locating the palette entries being candidates for the nearest color
+/ of any color falling within a cube cell [Heckbert's locally sorted
+/ search: only entries not farther than the smallest max-distance]
+/ returns the offset of the candidates list, or -1 on failure
+*/
+    int i;
+    int axis;
+    int lo[3];
+    int hi[3];
+    int c[3];
+    int d;
+    int min_dist;
+    int max_dist;
+    int minmaxdist = INT_MAX;
+    int mindist[256];
+    int count = 0;
+    int offset;
+    unsigned char *p;
+    int size = 1 << GG_PALETTE_CUBE_SHIFT;
+    lo[0] = ((cell >> 10) & 0x1f) << GG_PALETTE_CUBE_SHIFT;
+    lo[1] = ((cell >> 5) & 0x1f) << GG_PALETTE_CUBE_SHIFT;
+    lo[2] = (cell & 0x1f) << GG_PALETTE_CUBE_SHIFT;
+    for (axis = 0; axis < 3; axis++)
+	hi[axis] = lo[axis] + size - 1;
+
+    for (i = 0; i < cache->max_palette; i++)
+      {
+	  /* min and max squared distances from the cell box */
+	  c[0] = cache->red[i];
+	  c[1] = cache->green[i];
+	  c[2] = cache->blue[i];
+	  min_dist = 0;
+	  max_dist = 0;
+	  for (axis = 0; axis < 3; axis++)
+	    {
+		if (c[axis] < lo[axis])
+		  {
+		      d = lo[axis] - c[axis];
+		      min_dist += d * d;
+		  }
+		else if (c[axis] > hi[axis])
+		  {
+		      d = c[axis] - hi[axis];
+		      min_dist += d * d;
+		  }
+		d = c[axis] - lo[axis];
+		if (hi[axis] - c[axis] > d)
+		    d = hi[axis] - c[axis];
+		max_dist += d * d;
+	    }
+	  mindist[i] = min_dist;
+	  if (max_dist < minmaxdist)
+	      minmaxdist = max_dist;
+	  if (min_dist <= minmaxdist)
+	      count++;
+      }
+
+/* storing the candidates list [count - 1, then the indices] */
+    if (cache->candidates_used + count + 1 > cache->candidates_size)
+      {
+	  int new_size = cache->candidates_size * 2;
+	  if (new_size < cache->candidates_used + count + 1)
+	      new_size = cache->candidates_used + count + 1;
+	  if (new_size < 4096)
+	      new_size = 4096;
+	  p = realloc (cache->candidates, new_size);
+	  if (!p)
+	      return -1;
+	  cache->candidates = p;
+	  cache->candidates_size = new_size;
+      }
+    offset = cache->candidates_used;
+    p = cache->candidates + offset + 1;
+    count = 0;
+    for (i = 0; i < cache->max_palette; i++)
+      {
+	  if (mindist[i] <= minmaxdist)
+	    {
+		*p++ = i;
+		count++;
+	    }
+      }
+    cache->candidates[offset] = count - 1;
+    cache->candidates_used += count + 1;
+    cache->cells[cell] = offset + 1;
+    return offset;
+}
+
+static int
+palette_cache_nearest (gGraphPaletteCachePtr cache, unsigned char r,
+		       unsigned char g, unsigned char b)
+{
+/* searching the nearest color [returns -1 on failure] */
+    int cell;
+    int offset;
+    int count;
+    int i;
+    int index;
+    int dist;
+    int min_dist = INT_MAX;
+    int min_index = -1;
+    const unsigned char *p;
+
+    if (cache->cells == NULL)
+      {
+	  cache->cells = calloc (GG_PALETTE_CUBE_CELLS, sizeof (int));
+	  if (!cache->cells)
+	      return -1;
+      }
+    cell =
+	((r >> GG_PALETTE_CUBE_SHIFT) << 10) | ((g >> GG_PALETTE_CUBE_SHIFT) <<
+						5) | (b >>
+						      GG_PALETTE_CUBE_SHIFT);
+    offset = cache->cells[cell] - 1;
+    if (offset < 0)
+      {
+	  offset = palette_cache_fill_cell (cache, cell);
+	  if (offset < 0)
+	      return -1;
+      }
+    p = cache->candidates + offset;
+    count = *p++ + 1;
+    for (i = 0; i < count; i++)
+      {
+	  /* candidates are sorted by index, so ties resolve to the first one */
+	  index = *p++;
+	  dist =
+	      ((cache->red[index] - r) * (cache->red[index] - r)) +
+	      ((cache->green[index] - g) * (cache->green[index] - g)) +
+	      ((cache->blue[index] - b) * (cache->blue[index] - b));
+	  if (dist < min_dist)
+	    {
+		min_dist = dist;
+		min_index = index;
+	    }
+      }
+    return min_index;
+}
+
+static gGraphPaletteCachePtr
+palette_cache_create (int max_palette, int palette_version,
+		      const unsigned char *red, const unsigned char *green,
+		      const unsigned char *blue)
+{
+/* creating an inverse colormap mirroring some palette */
+    gGraphPaletteCachePtr p = malloc (sizeof (gGraphPaletteCache));
+    if (!p)
+	return NULL;
+    p->cells = NULL;
+    p->candidates = NULL;
+    p->candidates_size = 0;
+    palette_cache_sync (p, max_palette, red, green, blue);
+    p->palette_version = palette_version;
+    return p;
+}
+
+GGRAPH_PRIVATE void
+gg_palette_cache_destroy (gGraphPaletteCachePtr cache)
+{
+/* destroying an inverse colormap */
+    if (!cache)
+	return;
+    if (cache->cells)
+	free (cache->cells);
+    if (cache->candidates)
+	free (cache->candidates);
+    free (cache);
+}
+
+GGRAPH_PRIVATE unsigned char
+gg_palette_cache_match (gGraphPaletteCachePtr * cache, int *max_palette,
+			int palette_version, unsigned char *red,
+			unsigned char *green, unsigned char *blue,
+			unsigned char r, unsigned char g, unsigned char b)
+{
+/*
+/ handling palette colors by means of a cached inverse colormap
+/ - exact matches are resolved by a hash table
+/ - new entries are inserted until the palette holds 255 colors
+/ - then the nearest color is searched within a 32x32x32 cube whose
+/   cells are lazily filled with their candidate entries
+/ the cache is rebuilt whenever the palette version changes, i.e.
+/ after the palette has been edited behind its back
+*/
+    int index;
+    gGraphPaletteCachePtr p = *cache;
+
+    if (p == NULL)
+      {
+	  p = palette_cache_create (*max_palette, palette_version, red, green,
+				    blue);
+	  if (!p)
+	      return palette_match_linear (max_palette, red, green, blue, r, g,
+					   b);
+	  *cache = p;
+      }
+    else if (p->palette_version != palette_version
+	     || p->max_palette != *max_palette)
+      {
+	  /* the palette has been changed: stale cache */
+	  palette_cache_sync (p, *max_palette, red, green, blue);
+	  p->palette_version = palette_version;
+      }
+
+    index = palette_cache_lookup (p, r, g, b);
+    if (index >= 0)
+	return (unsigned char) index;
+    if (*max_palette < 255)
+      {
+	  /* inserting a new palette entry */
+	  index = *max_palette;
+	  *max_palette += 1;
+	  red[index] = r;
+	  green[index] = g;
+	  blue[index] = b;
+	  p->red[index] = r;
+	  p->green[index] = g;
+	  p->blue[index] = b;
+	  p->max_palette = *max_palette;
+	  palette_cache_insert (p, index);
+	  return (unsigned char) index;
+      }
+/* all right, the palette is already fully populated */
+    index = palette_cache_nearest (p, r, g, b);
+    if (index < 0)
+	return palette_match_linear (max_palette, red, green, blue, r, g, b);
+    return (unsigned char) index;
+}
+
+GGRAPH_PRIVATE unsigned char
+gg_match_palette (const gGraphImagePtr img, unsigned char r, unsigned char g,
+		  unsigned char b)
+{
+/* handling palette colors */
+    return gg_palette_cache_match (&(img->palette_cache), &(img->max_palette),
+				   img->palette_version, img->palette_red,
+				   img->palette_green, img->palette_blue, r,
+				   g, b);
+}
+
+GGRAPH_PRIVATE gGraphPaletteCachePtr
+gg_palette_cache_prepare (gGraphPaletteCachePtr * cache, int max_palette,
+			  int palette_version, const unsigned char *red,
+			  const unsigned char *green,
+			  const unsigned char *blue)
+{
+/*
+/ preparing an inverse colormap for some fixed palette
+/ [no new entry will ever be inserted]
+*/
+    gGraphPaletteCachePtr p = *cache;
+
+    if (p == NULL)
+      {
+	  p = palette_cache_create (max_palette, palette_version, red, green,
+				    blue);
+	  if (!p)
+	      return NULL;
+	  *cache = p;
+      }
+    else if (p->palette_version != palette_version
+	     || p->max_palette != max_palette
+	     || memcmp (p->red, red, max_palette) != 0
+	     || memcmp (p->green, green, max_palette) != 0
+	     || memcmp (p->blue, blue, max_palette) != 0)
+      {
+	  palette_cache_sync (p, max_palette, red, green, blue);
+	  p->palette_version = palette_version;
+      }
+    return p;
+}
+
+GGRAPH_PRIVATE unsigned char
+gg_palette_cache_nearest (gGraphPaletteCachePtr cache, unsigned char r,
+			  unsigned char g, unsigned char b)
+{
+/* searching the nearest color within a prepared inverse colormap */
+    int index = palette_cache_lookup (cache, r, g, b);
+    if (index >= 0)
+	return (unsigned char) index;
+    index = palette_cache_nearest (cache, r, g, b);
+    if (index < 0)
+      {
+	  /* insufficient memory: defaulting to a plain linear search */
+	  int i;
+	  int dist;
+	  int min_dist = INT_MAX;
+	  index = 0;
+	  for (i = 0; i < cache->max_palette; i++)
+	    {
+		dist =
+		    ((cache->red[i] - r) * (cache->red[i] - r)) +
+		    ((cache->green[i] - g) * (cache->green[i] - g)) +
+		    ((cache->blue[i] - b) * (cache->blue[i] - b));
+		if (dist < min_dist)
+		  {
+		      min_dist = dist;
+		      index = i;
+		  }
+	    }
+      }
+    return (unsigned char) index;
+}
+
+GGRAPH_PRIVATE gGraphDitherPtr
+gg_dither_create (int width, int channels)
+{
+/* creating a Floyd-Steinberg error diffusion state */
+    int n = (width + 2) * channels;
+    gGraphDitherPtr dither = malloc (sizeof (gGraphDither));
+    if (!dither)
+	return NULL;
+    dither->width = width;
+    dither->channels = channels;
+    dither->row = 0;
+    dither->pixels = malloc (width * channels);
+    dither->this_errors = calloc (n, sizeof (int));
+    dither->next_errors = calloc (n, sizeof (int));
+    if (!dither->pixels || !dither->this_errors || !dither->next_errors)
+      {
+	  gg_dither_destroy (dither);
+	  return NULL;
+      }
+    return dither;
+}
+
+GGRAPH_PRIVATE void
+gg_dither_destroy (gGraphDitherPtr dither)
+{
+/* destroying a Floyd-Steinberg error diffusion state */
+    if (!dither)
+	return;
+    if (dither->pixels)
+	free (dither->pixels);
+    if (dither->this_errors)
+	free (dither->this_errors);
+    if (dither->next_errors)
+	free (dither->next_errors);
+    free (dither);
+}
+
+GGRAPH_PRIVATE void
+gg_dither_reset (gGraphDitherPtr dither, int row)
+{
+/* discarding any pending error, so to restart from some row */
+    int n = (dither->width + 2) * dither->channels;
+    memset (dither->this_errors, 0, sizeof (int) * n);
+    memset (dither->next_errors, 0, sizeof (int) * n);
+    dither->row = row;
+}
+
+static int
+dither_value (unsigned char value, int error)
+{
+/* applying the accumulated error [x 16] to some sample */
+    int v;
+    if (error >= 0)
+	v = value + ((error + 8) >> 4);
+    else
+	v = value - ((8 - error) >> 4);
+    if (v < 0)
+	return 0;
+    if (v > 255)
+	return 255;
+    return v;
+}
+
+static void
+dither_diffuse (int *this_err, int *next_err, int dir, int channels, int c,
+		int error)
+{
+/*
+/ spreading the quantization error of some sample:
+/ 7/16 to the next pixel, 3/16, 5/16 and 1/16 to the row below
+/ [errors are kept at 16x scale so to avoid rounding losses]
+*/
+    int step = dir * channels;
+    this_err[step + c] += error * 7;
+    next_err[c - step] += error * 3;
+    next_err[c] += error * 5;
+    next_err[step + c] += error;
+}
+
+static void
+dither_next_row (gGraphDitherPtr dither)
+{
+/* the next row errors become the current ones */
+    int *swap = dither->this_errors;
+    dither->this_errors = dither->next_errors;
+    dither->next_errors = swap;
+    memset (dither->next_errors, 0,
+	    sizeof (int) * (dither->width + 2) * dither->channels);
+    dither->row += 1;
+}
+
+GGRAPH_PRIVATE void
+gg_dither_rgb_row (gGraphDitherPtr dither, unsigned char *p_out,
+		   gGraphPaletteCachePtr cache)
+{
+/*
+/ mapping an RGB row [dither->pixels] into palette indices
+/ applying Floyd-Steinberg error diffusion (serpentine scanning)
+*/
+    int x;
+    int dir;
+    int col;
+    int c;
+    int rgb[3];
+    unsigned char index;
+    int *this_err;
+    int *next_err;
+    const unsigned char *p_in;
+
+    dir = (dither->row % 2) ? -1 : 1;
+    for (col = 0; col < dither->width; col++)
+      {
+	  x = (dir > 0) ? col : dither->width - 1 - col;
+	  p_in = dither->pixels + (x * 3);
+	  this_err = dither->this_errors + ((x + 1) * 3);
+	  next_err = dither->next_errors + ((x + 1) * 3);
+	  for (c = 0; c < 3; c++)
+	      rgb[c] = dither_value (p_in[c], this_err[c]);
+	  index = gg_palette_cache_nearest (cache, rgb[0], rgb[1], rgb[2]);
+	  p_out[x] = index;
+	  dither_diffuse (this_err, next_err, dir, 3, 0,
+			  rgb[0] - cache->red[index]);
+	  dither_diffuse (this_err, next_err, dir, 3, 1,
+			  rgb[1] - cache->green[index]);
+	  dither_diffuse (this_err, next_err, dir, 3, 2,
+			  rgb[2] - cache->blue[index]);
+      }
+    dither_next_row (dither);
+}
+
+GGRAPH_PRIVATE void
+gg_dither_gray_row (gGraphDitherPtr dither, unsigned char *p_out,
+		    unsigned char black, unsigned char white)
+{
+/*
+/ mapping a GRAYSCALE row [dither->pixels] into BLACK or WHITE
+/ applying Floyd-Steinberg error diffusion (serpentine scanning)
+*/
+    int x;
+    int dir;
+    int col;
+    int gray;
+    int *this_err;
+    int *next_err;
+
+    dir = (dither->row % 2) ? -1 : 1;
+    for (col = 0; col < dither->width; col++)
+      {
+	  x = (dir > 0) ? col : dither->width - 1 - col;
+	  this_err = dither->this_errors + (x + 1);
+	  next_err = dither->next_errors + (x + 1);
+	  gray = dither_value (dither->pixels[x], *this_err);
+	  if (gray < 128)
+	    {
+		p_out[x] = black;
+		dither_diffuse (this_err, next_err, dir, 1, 0, gray);
+	    }
+	  else
+	    {
+		p_out[x] = white;
+		dither_diffuse (this_err, next_err, dir, 1, 0, gray - 255);
+	    }
+      }
+    dither_next_row (dither);
+}
+
 static void
-shrink_by (const gGraphImagePtr dst, const gGraphImagePtr src)
+shrink_by (const gGraphImagePtr dst, const gGraphImagePtr src, int start_row,
+	   int end_row)
 {
 /*
 / this code is widely base upon the original wxWidgets gwxImage wxImage::ShrinkBy(() function
@@ -947,7 +1509,7 @@ shrink_by (const gGraphImagePtr dst, const gGraphImagePtr src)
     unsigned char blue;
     unsigned char gray;
     unsigned char *p;
-    for (y = 0; y < dst->height; y++)
+    for (y = start_row; y < end_row; y++)
       {
 	  for (x = 0; x < dst->width; x++)
 	    {
@@ -1082,11 +1644,13 @@ shrink_by (const gGraphImagePtr dst, const gGraphImagePtr src)
       }
 }
 
-GGRAPH_PRIVATE void
-gg_image_resize (const gGraphImagePtr dst, const gGraphImagePtr src)
+static void
+image_resize_rows (const gGraphImagePtr dst, const gGraphImagePtr src,
+		   int start_row, int end_row)
 {
 /*
 / this function builds an ordinary quality resized image, applying pixel replication
+/ [only destination rows in the start_row/end_row range will be processed]
 /
 / this code is widely base upon the original wxWidgets gwxImage wxImage::Scale(() function
 / wxIMAGE_QUALITY_NORMAL
@@ -1107,15 +1671,15 @@ gg_image_resize (const gGraphImagePtr dst, const gGraphImagePtr src)
     if ((src->width % dst->width) == 0 && src->width >= dst->width
 	&& (src->height % dst->height) == 0 && src->height >= dst->height)
       {
-	  shrink_by (dst, src);
+	  shrink_by (dst, src, start_row, end_row);
 	  return;
       }
     x = src->width;
     y = src->height;
     x_delta = (x << 16) / dst->width;
     y_delta = (y << 16) / dst->height;
-    y = 0;
-    for (j = 0; j < dst->height; j++)
+    y = start_row * y_delta;
+    for (j = start_row; j < end_row; j++)
       {
 	  x = 0;
 	  for (i = 0; i < dst->width; i++)
@@ -1241,7 +1805,8 @@ gg_image_resize (const gGraphImagePtr dst, const gGraphImagePtr src)
 }
 
 static void
-shrink_grid_by (const gGraphImagePtr dst, const gGraphImagePtr src)
+shrink_grid_by (const gGraphImagePtr dst, const gGraphImagePtr src,
+		int start_row, int end_row)
 {
 /*
 / this code is widely base upon the original wxWidgets gwxImage wxImage::ShrinkBy(() function
@@ -1266,13 +1831,13 @@ shrink_grid_by (const gGraphImagePtr dst, const gGraphImagePtr src)
     unsigned int *p_uint;
     float *p_float;
     double *p_double;
-    for (y = 0; y < dst->height; y++)
+    for (y = start_row; y < end_row; y++)
       {
 	  for (x = 0; x < dst->width; x++)
 	    {
 		/* determine average */
 		int is_nodata = 0;
-		double avg;
+		double avg = 0.0;
 		unsigned int counter = 0;
 		unsigned char *p;
 		for (y1 = 0; y1 < yFactor; ++y1)
@@ -1428,11 +1993,13 @@ shrink_grid_by (const gGraphImagePtr dst, const gGraphImagePtr src)
       }
 }
 
-GGRAPH_PRIVATE void
-gg_grid_resize (const gGraphImagePtr dst, const gGraphImagePtr src)
+static void
+grid_resize_rows (const gGraphImagePtr dst, const gGraphImagePtr src,
+		  int start_row, int end_row)
 {
 /*
 / this function builds an ordinary quality resized GRID, applying pixel replication
+/ [only destination rows in the start_row/end_row range will be processed]
 /
 / this code is widely base upon the original wxWidgets gwxImage wxImage::Scale(() function
 / wxIMAGE_QUALITY_NORMAL
@@ -1459,15 +2026,15 @@ gg_grid_resize (const gGraphImagePtr dst, const gGraphImagePtr src)
     if ((src->width % dst->width) == 0 && src->width >= dst->width
 	&& (src->height % dst->height) == 0 && src->height >= dst->height)
       {
-	  shrink_grid_by (dst, src);
+	  shrink_grid_by (dst, src, start_row, end_row);
 	  return;
       }
     x = src->width;
     y = src->height;
     x_delta = (x << 16) / dst->width;
     y_delta = (y << 16) / dst->height;
-    y = 0;
-    for (j = 0; j < dst->height; j++)
+    y = start_row * y_delta;
+    for (j = start_row; j < end_row; j++)
       {
 	  x = 0;
 	  for (i = 0; i < dst->width; i++)
@@ -2067,48 +2634,1141 @@ gg_make_grid_thumbnail (const gGraphImagePtr thumbnail,
       }
 }
 
-GGRAPH_PRIVATE int
-gg_convert_image_to_grid_int16 (const gGraphImagePtr img)
+#define GG_RESAMPLE_LANCZOS_A	3
+
+struct resample_weights
 {
-/* converting this grid-image to Int16 */
-    int x;
-    int y;
-    void *pixels;
-    short value;
-    unsigned char *p_in;
-    short *p_out;
+/* precomputed contributions along a single axis */
+    int size;
+    int max_taps;
+    int *first;
+    int *count;
+    float *weights;
+    double *grid_weights;	/* the same weights, in double precision */
+};
+
+struct resample_context
+{
+/* a struct used by the separable resampler */
+    gGraphImagePtr dst;
+    gGraphImagePtr src;
+    struct resample_weights *wx;
+    struct resample_weights *wy;
+    int channels;
+};
+
+struct resample_scratch
+{
+/* working buffers: allocated once for each job or Strip Image */
+    const unsigned char **rows;
+    float *acc;
+    unsigned char *expanded;
+    unsigned char *rgb;
+    double *values;
+    double *grid_acc;
+    double *grid_out;
+    unsigned char *is_nodata;
+};
 
-    if (img->pixel_format != GG_PIXEL_GRID)
-	return GGRAPH_INVALID_IMAGE;
+static void
+resample_weights_free (struct resample_weights *w)
+{
+/* freeing a weights table */
+    if (w->first)
+	free (w->first);
+    if (w->count)
+	free (w->count);
+    if (w->weights)
+	free (w->weights);
+    if (w->grid_weights)
+	free (w->grid_weights);
+    w->first = NULL;
+    w->count = NULL;
+    w->weights = NULL;
+    w->grid_weights = NULL;
+}
 
-    if (img->sample_format == GGRAPH_SAMPLE_INT && img->bits_per_sample == 16)
-	return GGRAPH_OK;
+static double
+lanczos_kernel (double x)
+{
+/* the Lanczos windowed sinc */
+    double px;
+    if (x < 0.0)
+	x = -x;
+    if (x < 1e-8)
+	return 1.0;
+    if (x >= GG_RESAMPLE_LANCZOS_A)
+	return 0.0;
+    px = x * 3.14159265358979323846;
+    return (sin (px) / px) * (sin (px / GG_RESAMPLE_LANCZOS_A) /
+			      (px / GG_RESAMPLE_LANCZOS_A));
+}
 
-    pixels = malloc (img->width * img->height * sizeof (short));
-    if (!pixels)
-	return GGRAPH_INSUFFICIENT_MEMORY;
-    for (y = 0; y < img->height; y++)
+static int
+resample_weights_init (struct resample_weights *w, int src_size,
+		       int dst_size, int use_lanczos)
+{
+/*
+/ precomputing the weights table for a single axis
+/
+/ - box [area averaging]: each output pixel exactly covers the
+/   corresponding source interval, as in gg_make_thumbnail()
+/ - Lanczos: a 3-lobed windowed sinc, only used when enlarging
+/
+/ GRID data use the double precision weights, so that a uniform
+/ area is exactly preserved
+*/
+    double scale = (double) src_size / (double) dst_size;
+    int i;
+    int k;
+
+    w->size = dst_size;
+    w->first = NULL;
+    w->count = NULL;
+    w->weights = NULL;
+    w->grid_weights = NULL;
+    if (use_lanczos)
+	w->max_taps = GG_RESAMPLE_LANCZOS_A * 2;
+    else
+	w->max_taps = (int) ceil (scale) + 1;
+    w->first = malloc (sizeof (int) * dst_size);
+    w->count = malloc (sizeof (int) * dst_size);
+    w->weights = malloc (sizeof (float) * dst_size * w->max_taps);
+    w->grid_weights = malloc (sizeof (double) * dst_size * w->max_taps);
+    if (!(w->first) || !(w->count) || !(w->weights) || !(w->grid_weights))
       {
-	  /* processing any scanline */
-	  p_in = img->pixels + (y * img->scanline_width);
-	  p_out = pixels;
-	  p_out += (y * img->width);
-	  for (x = 0; x < img->width; x++)
+	  resample_weights_free (w);
+	  return 0;
+      }
+
+    for (i = 0; i < dst_size; i++)
+      {
+	  float *pw = w->weights + (i * w->max_taps);
+	  double *pd = w->grid_weights + (i * w->max_taps);
+	  double sum = 0.0;
+	  double dsum = 0.0;
+	  int first;
+	  int last;
+	  for (k = 0; k < w->max_taps; k++)
 	    {
-		/* retrieving the origin pixel */
-		if (img->sample_format == GGRAPH_SAMPLE_UINT
-		    && img->bits_per_sample == 16)
-		  {
-		      value = (short) *((unsigned short *) p_in);
-		      p_in += sizeof (unsigned short);
-		  }
-		if (img->sample_format == GGRAPH_SAMPLE_INT
-		    && img->bits_per_sample == 32)
-		  {
-		      value = (short) *((int *) p_in);
-		      p_in += sizeof (int);
+		pw[k] = 0.0;
+		pd[k] = 0.0;
+	    }
+	  if (use_lanczos)
+	    {
+		double center = ((double) i + 0.5) * scale - 0.5;
+		int j0 = (int) floor (center) - GG_RESAMPLE_LANCZOS_A + 1;
+		first = j0;
+		last = j0 + (GG_RESAMPLE_LANCZOS_A * 2) - 1;
+		if (first < 0)
+		    first = 0;
+		if (last > src_size - 1)
+		    last = src_size - 1;
+		for (k = 0; k < GG_RESAMPLE_LANCZOS_A * 2; k++)
+		  {
+		      /* out of range taps are clamped to the edges */
+		      int j = j0 + k;
+		      double v = lanczos_kernel ((double) (j0 + k) - center);
+		      if (j < first)
+			  j = first;
+		      if (j > last)
+			  j = last;
+		      pw[j - first] += v;
+		      pd[j - first] += v;
 		  }
-		if (img->sample_format == GGRAPH_SAMPLE_UINT
+	    }
+	  else
+	    {
+		double x1 = (double) i *scale;
+		double x2 = (double) (i + 1) * scale;
+		if (x2 > (double) src_size)
+		    x2 = (double) src_size;
+		first = (int) floor (x1);
+		last = (int) ceil (x2) - 1;
+		if (last < first)
+		    last = first;
+		if (last > src_size - 1)
+		    last = src_size - 1;
+		for (k = first; k <= last; k++)
+		  {
+		      /* the portion of this source pixel being covered */
+		      double a = (x1 > (double) k) ? x1 : (double) k;
+		      double b = (x2 < (double) (k + 1)) ? x2 : (double) (k + 1);
+		      if (b > a)
+			{
+			    pw[k - first] = (float) (b - a);
+			    pd[k - first] = b - a;
+			}
+		  }
+	    }
+	  w->first[i] = first;
+	  w->count[i] = last - first + 1;
+	  for (k = 0; k < w->count[i]; k++)
+	    {
+		sum += pw[k];
+		dsum += pd[k];
+	    }
+	  if (sum != 0.0)
+	    {
+		for (k = 0; k < w->count[i]; k++)
+		    pw[k] = (float) (pw[k] / sum);
+	    }
+	  if (dsum != 0.0)
+	    {
+		for (k = 0; k < w->count[i]; k++)
+		    pd[k] /= dsum;
+	    }
+      }
+    return 1;
+}
+
+static unsigned char
+resample_clamp (float value)
+{
+/* rounding a filtered value into the 0-255 range */
+    if (value <= 0.0)
+	return 0;
+    if (value >= 255.0)
+	return 255;
+    return (unsigned char) (value + 0.5);
+}
+
+static void
+resample_vertical (const unsigned char *const *rows, int num_rows,
+		   const float *weights, int row_len, float *acc)
+{
+/* vertical pass: accumulating all contributing source rows */
+    int i;
+    int k;
+    for (i = 0; i < row_len; i++)
+	acc[i] = 0.0;
+    for (k = 0; k < num_rows; k++)
+      {
+	  const unsigned char *p = rows[k];
+	  float w = weights[k];
+	  if (w == 0.0)
+	      continue;
+	  for (i = 0; i < row_len; i++)
+	      acc[i] += w * (float) (p[i]);
+      }
+}
+
+static void
+resample_horizontal_1 (const float *acc, const struct resample_weights *wx,
+		       unsigned char *out)
+{
+/* horizontal pass: single channel [GRAYSCALE] */
+    int x;
+    int k;
+    for (x = 0; x < wx->size; x++)
+      {
+	  const float *pw = wx->weights + (x * wx->max_taps);
+	  const float *pa = acc + wx->first[x];
+	  float v = 0.0;
+	  for (k = 0; k < wx->count[x]; k++)
+	      v += pw[k] * pa[k];
+	  *out++ = resample_clamp (v);
+      }
+}
+
+static void
+resample_horizontal_3 (const float *acc, const struct resample_weights *wx,
+		       unsigned char *out)
+{
+/* horizontal pass: three interleaved channels [RGB, BGR] */
+    int x;
+    int k;
+    for (x = 0; x < wx->size; x++)
+      {
+	  const float *pw = wx->weights + (x * wx->max_taps);
+	  const float *pa = acc + (wx->first[x] * 3);
+	  float v0 = 0.0;
+	  float v1 = 0.0;
+	  float v2 = 0.0;
+	  for (k = 0; k < wx->count[x]; k++)
+	    {
+		float w = pw[k];
+		v0 += w * pa[0];
+		v1 += w * pa[1];
+		v2 += w * pa[2];
+		pa += 3;
+	    }
+	  *out++ = resample_clamp (v0);
+	  *out++ = resample_clamp (v1);
+	  *out++ = resample_clamp (v2);
+      }
+}
+
+static void
+resample_horizontal_4 (const float *acc, const struct resample_weights *wx,
+		       unsigned char *out)
+{
+/* horizontal pass: four interleaved channels [RGBA, ARGB, BGRA] */
+    int x;
+    int k;
+    for (x = 0; x < wx->size; x++)
+      {
+	  const float *pw = wx->weights + (x * wx->max_taps);
+	  const float *pa = acc + (wx->first[x] * 4);
+	  float v0 = 0.0;
+	  float v1 = 0.0;
+	  float v2 = 0.0;
+	  float v3 = 0.0;
+	  for (k = 0; k < wx->count[x]; k++)
+	    {
+		float w = pw[k];
+		v0 += w * pa[0];
+		v1 += w * pa[1];
+		v2 += w * pa[2];
+		v3 += w * pa[3];
+		pa += 4;
+	    }
+	  *out++ = resample_clamp (v0);
+	  *out++ = resample_clamp (v1);
+	  *out++ = resample_clamp (v2);
+	  *out++ = resample_clamp (v3);
+      }
+}
+
+static unsigned char *
+resample_row_ptr (const gGraphImagePtr img, int row)
+{
+/*
+/ locating a row of pixels
+/ [a resampler working by strips only holds a few rows, used as a circular buffer]
+*/
+    return img->pixels + ((row % img->height) * img->scanline_width);
+}
+
+static void
+resample_scratch_free (struct resample_scratch *scratch)
+{
+/* freeing the working buffers */
+    if (scratch->rows)
+	free (scratch->rows);
+    if (scratch->acc)
+	free (scratch->acc);
+    if (scratch->expanded)
+	free (scratch->expanded);
+    if (scratch->rgb)
+	free (scratch->rgb);
+    if (scratch->values)
+	free (scratch->values);
+    if (scratch->grid_acc)
+	free (scratch->grid_acc);
+    if (scratch->grid_out)
+	free (scratch->grid_out);
+    if (scratch->is_nodata)
+	free (scratch->is_nodata);
+    memset (scratch, 0, sizeof (struct resample_scratch));
+}
+
+static int
+resample_scratch_alloc (const struct resample_context *ctx,
+			struct resample_scratch *scratch)
+{
+/* allocating the working buffers required by the resampler */
+    gGraphImagePtr src = ctx->src;
+    gGraphImagePtr dst = ctx->dst;
+    int row_len = src->width * ctx->channels;
+    int max_rows = ctx->wy->max_taps;
+
+    memset (scratch, 0, sizeof (struct resample_scratch));
+    if (dst->pixel_format == GG_PIXEL_GRID)
+      {
+	  scratch->values = malloc (sizeof (double) * src->width);
+	  scratch->grid_acc = malloc (sizeof (double) * src->width);
+	  scratch->grid_out = malloc (sizeof (double) * dst->width);
+	  scratch->is_nodata = malloc (src->width);
+	  if (!(scratch->values) || !(scratch->grid_acc)
+	      || !(scratch->grid_out) || !(scratch->is_nodata))
+	      goto error;
+	  return 1;
+      }
+    scratch->rows = malloc (sizeof (const unsigned char *) * max_rows);
+    scratch->acc = malloc (sizeof (float) * row_len);
+    if (!(scratch->rows) || !(scratch->acc))
+	goto error;
+    if (src->pixel_format == GG_PIXEL_PALETTE)
+      {
+	  /* palette indices are expanded into RGB before filtering */
+	  scratch->expanded = malloc (row_len * max_rows);
+	  if (!(scratch->expanded))
+	      goto error;
+      }
+    if (dst->pixel_format == GG_PIXEL_PALETTE)
+      {
+	  scratch->rgb = malloc (dst->width * 3);
+	  if (!(scratch->rgb))
+	      goto error;
+      }
+    return 1;
+
+  error:
+    resample_scratch_free (scratch);
+    return 0;
+}
+
+static void
+resample_image_rows (struct resample_context *ctx,
+		     struct resample_scratch *scratch, int start_row,
+		     int end_row)
+{
+/*
+/ resampling a range of output rows [RGB, RGBA, GRAYSCALE, PALETTE ...]
+/ a PALETTE source could be resampled into an RGB destination
+*/
+    gGraphImagePtr src = ctx->src;
+    gGraphImagePtr dst = ctx->dst;
+    int channels = ctx->channels;
+    int row_len = src->width * channels;
+    const unsigned char **rows = scratch->rows;
+    float *acc = scratch->acc;
+    unsigned char *expanded = scratch->expanded;
+    unsigned char *rgb = scratch->rgb;
+    int y;
+    int k;
+    int x;
+
+    for (y = start_row; y < end_row; y++)
+      {
+	  int first = ctx->wy->first[y];
+	  int count = ctx->wy->count[y];
+	  const float *weights = ctx->wy->weights + (y * ctx->wy->max_taps);
+	  unsigned char *out = resample_row_ptr (dst, y);
+	  for (k = 0; k < count; k++)
+	    {
+		const unsigned char *p = resample_row_ptr (src, first + k);
+		if (expanded)
+		  {
+		      unsigned char *pe = expanded + (k * row_len);
+		      rows[k] = pe;
+		      for (x = 0; x < src->width; x++)
+			{
+			    *pe++ = src->palette_red[p[x]];
+			    *pe++ = src->palette_green[p[x]];
+			    *pe++ = src->palette_blue[p[x]];
+			}
+		  }
+		else
+		    rows[k] = p;
+	    }
+	  resample_vertical (rows, count, weights, row_len, acc);
+	  if (channels == 1)
+	      resample_horizontal_1 (acc, ctx->wx, out);
+	  else if (channels == 3 && rgb)
+	    {
+		resample_horizontal_3 (acc, ctx->wx, rgb);
+		for (x = 0; x < dst->width; x++)
+		    out[x] =
+			gg_match_palette (dst, rgb[x * 3], rgb[x * 3 + 1],
+					  rgb[x * 3 + 2]);
+	    }
+	  else if (channels == 3)
+	      resample_horizontal_3 (acc, ctx->wx, out);
+	  else
+	      resample_horizontal_4 (acc, ctx->wx, out);
+      }
+}
+
+static void
+resample_grid_fetch (const gGraphImagePtr src, int row, double *values)
+{
+/* fetching a GRID row as doubles */
+    unsigned char *p = resample_row_ptr (src, row);
+    int x;
+    switch (src->sample_format)
+      {
+      case GGRAPH_SAMPLE_INT:
+	  if (src->bits_per_sample == 8)
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = ((signed char *) p)[x];
+	    }
+	  else if (src->bits_per_sample == 16)
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = ((short *) p)[x];
+	    }
+	  else
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = ((int *) p)[x];
+	    }
+	  break;
+      case GGRAPH_SAMPLE_UINT:
+	  if (src->bits_per_sample == 8)
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = p[x];
+	    }
+	  else if (src->bits_per_sample == 16)
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = ((unsigned short *) p)[x];
+	    }
+	  else
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = ((unsigned int *) p)[x];
+	    }
+	  break;
+      case GGRAPH_SAMPLE_FLOAT:
+	  if (src->bits_per_sample == 32)
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = ((float *) p)[x];
+	    }
+	  else
+	    {
+		for (x = 0; x < src->width; x++)
+		    values[x] = ((double *) p)[x];
+	    }
+	  break;
+      };
+}
+
+static double
+resample_grid_round (double value, double min, double max)
+{
+/* rounding a filtered value to the nearest integer within the given range */
+    value = floor (value + 0.5);
+    if (value < min)
+	return min;
+    if (value > max)
+	return max;
+    return value;
+}
+
+static void
+resample_grid_store (const gGraphImagePtr dst, int row, const double *values)
+{
+/* storing a GRID row from doubles */
+    unsigned char *p = resample_row_ptr (dst, row);
+    int x;
+    switch (dst->sample_format)
+      {
+      case GGRAPH_SAMPLE_INT:
+	  if (dst->bits_per_sample == 8)
+	    {
+		for (x = 0; x < dst->width; x++)
+		    ((signed char *) p)[x] =
+			(signed char) resample_grid_round (values[x],
+							   SCHAR_MIN,
+							   SCHAR_MAX);
+	    }
+	  else if (dst->bits_per_sample == 16)
+	    {
+		for (x = 0; x < dst->width; x++)
+		    ((short *) p)[x] =
+			(short) resample_grid_round (values[x], SHRT_MIN,
+						     SHRT_MAX);
+	    }
+	  else
+	    {
+		for (x = 0; x < dst->width; x++)
+		    ((int *) p)[x] =
+			(int) resample_grid_round (values[x], INT_MIN,
+						   INT_MAX);
+	    }
+	  break;
+      case GGRAPH_SAMPLE_UINT:
+	  if (dst->bits_per_sample == 8)
+	    {
+		for (x = 0; x < dst->width; x++)
+		    p[x] =
+			(unsigned char) resample_grid_round (values[x], 0,
+							     UCHAR_MAX);
+	    }
+	  else if (dst->bits_per_sample == 16)
+	    {
+		for (x = 0; x < dst->width; x++)
+		    ((unsigned short *) p)[x] =
+			(unsigned short) resample_grid_round (values[x], 0,
+							      USHRT_MAX);
+	    }
+	  else
+	    {
+		for (x = 0; x < dst->width; x++)
+		    ((unsigned int *) p)[x] =
+			(unsigned int) resample_grid_round (values[x], 0,
+							    UINT_MAX);
+	    }
+	  break;
+      case GGRAPH_SAMPLE_FLOAT:
+	  if (dst->bits_per_sample == 32)
+	    {
+		for (x = 0; x < dst->width; x++)
+		    ((float *) p)[x] = (float) values[x];
+	    }
+	  else
+	    {
+		for (x = 0; x < dst->width; x++)
+		    ((double *) p)[x] = values[x];
+	    }
+	  break;
+      };
+}
+
+static void
+resample_grid_rows (struct resample_context *ctx,
+		    struct resample_scratch *scratch, int start_row,
+		    int end_row)
+{
+/*
+/ resampling a range of output rows [GRID]
+/ any NoData cell contributing to some output cell makes it NoData
+*/
+    gGraphImagePtr src = ctx->src;
+    gGraphImagePtr dst = ctx->dst;
+    struct resample_weights *wx = ctx->wx;
+    double no_data = src->no_data_value;
+    double *values = scratch->values;
+    double *acc = scratch->grid_acc;
+    double *out = scratch->grid_out;
+    unsigned char *is_nodata = scratch->is_nodata;
+    int y;
+    int k;
+    int x;
+
+    for (y = start_row; y < end_row; y++)
+      {
+	  int first = ctx->wy->first[y];
+	  int count = ctx->wy->count[y];
+	  const double *weights =
+	      ctx->wy->grid_weights + (y * ctx->wy->max_taps);
+	  for (x = 0; x < src->width; x++)
+	    {
+		acc[x] = 0.0;
+		is_nodata[x] = 0;
+	    }
+	  for (k = 0; k < count; k++)
+	    {
+		/* vertical pass */
+		double w = weights[k];
+		if (w == 0.0)
+		    continue;
+		resample_grid_fetch (src, first + k, values);
+		for (x = 0; x < src->width; x++)
+		  {
+		      if (values[x] == no_data)
+			  is_nodata[x] = 1;
+		      acc[x] += w * values[x];
+		  }
+	    }
+	  for (x = 0; x < wx->size; x++)
+	    {
+		/* horizontal pass */
+		const double *pw = wx->grid_weights + (x * wx->max_taps);
+		int j = wx->first[x];
+		double v = 0.0;
+		int nodata = 0;
+		for (k = 0; k < wx->count[x]; k++)
+		  {
+		      if (pw[k] == 0.0)
+			  continue;
+		      if (is_nodata[j + k])
+			  nodata = 1;
+		      v += pw[k] * acc[j + k];
+		  }
+		out[x] = nodata ? no_data : v;
+	    }
+	  resample_grid_store (dst, y, out);
+      }
+}
+
+struct resize_job
+{
+/* a job resizing a range of destination rows */
+    gGraphImagePtr dst;
+    gGraphImagePtr src;
+    struct resample_context *ctx;
+    int start_row;
+    int end_row;
+    int ret;
+};
+
+static void
+resize_job (void *arg)
+{
+/* threaded function: resizing a range of destination rows */
+    struct resize_job *job = (struct resize_job *) arg;
+    struct resample_scratch scratch;
+    job->ret = 1;
+    if (job->ctx != NULL)
+      {
+	  /* high quality resampling */
+	  if (!resample_scratch_alloc (job->ctx, &scratch))
+	    {
+		job->ret = 0;
+		return;
+	    }
+	  if (job->dst->pixel_format == GG_PIXEL_GRID)
+	      resample_grid_rows (job->ctx, &scratch, job->start_row,
+				  job->end_row);
+	  else
+	      resample_image_rows (job->ctx, &scratch, job->start_row,
+				   job->end_row);
+	  resample_scratch_free (&scratch);
+      }
+    else if (job->dst->pixel_format == GG_PIXEL_GRID)
+	grid_resize_rows (job->dst, job->src, job->start_row, job->end_row);
+    else
+	image_resize_rows (job->dst, job->src, job->start_row, job->end_row);
+}
+
+static int
+resize_by_threads (const gGraphImagePtr dst, const gGraphImagePtr src,
+		   struct resample_context *ctx, gGraphThreadPoolPtr pool,
+		   int num_threads)
+{
+/*
+/ splitting the destination rows into contiguous ranges, each one
+/ of them being resized by a separate job
+/
+/ a PALETTE destination is always resized by a single job, because
+/ gg_match_palette() could insert further entries into the palette
+/
+/ returns 0 if any job failed
+*/
+    struct resize_job jobs[GG_MAX_THREADS];
+    int num_jobs;
+    int start_row = 0;
+    int i;
+
+    if (pool != NULL)
+	num_jobs = gg_thread_pool_size (pool);
+    else
+	num_jobs = num_threads;
+    if (num_jobs > GG_MAX_THREADS)
+	num_jobs = GG_MAX_THREADS;
+    if (num_jobs > dst->height)
+	num_jobs = dst->height;
+    if (num_jobs < 1 || dst->pixel_format == GG_PIXEL_PALETTE)
+	num_jobs = 1;
+    for (i = 0; i < num_jobs; i++)
+      {
+	  struct resize_job *job = jobs + i;
+	  int rows = dst->height / num_jobs;
+	  if (i < dst->height % num_jobs)
+	      rows++;
+	  job->dst = dst;
+	  job->src = src;
+	  job->ctx = ctx;
+	  job->start_row = start_row;
+	  job->end_row = start_row + rows;
+	  job->ret = 0;
+	  start_row += rows;
+      }
+    gg_thread_pool_run (pool, num_threads, resize_job, jobs,
+			sizeof (struct resize_job), num_jobs);
+    for (i = 0; i < num_jobs; i++)
+      {
+	  if (!jobs[i].ret)
+	      return 0;
+      }
+    return 1;
+}
+
+GGRAPH_PRIVATE void
+gg_image_resize (const gGraphImagePtr dst, const gGraphImagePtr src,
+		 gGraphThreadPoolPtr pool, int num_threads)
+{
+/*
+/ builds an ordinary quality resized image
+/ [destination rows may be split between many threads]
+*/
+    resize_by_threads (dst, src, NULL, pool, num_threads);
+}
+
+GGRAPH_PRIVATE void
+gg_grid_resize (const gGraphImagePtr dst, const gGraphImagePtr src,
+		gGraphThreadPoolPtr pool, int num_threads)
+{
+/*
+/ builds an ordinary quality resized GRID
+/ [destination rows may be split between many threads]
+*/
+    resize_by_threads (dst, src, NULL, pool, num_threads);
+}
+
+GGRAPH_PRIVATE int
+gg_image_resample (const gGraphImagePtr dst, const gGraphImagePtr src,
+		   gGraphThreadPoolPtr pool, int num_threads)
+{
+/*
+/ high quality resampling by a separable [two pass] filter
+/
+/ weights are precomputed once for each output column and row:
+/ box [area averaging] when shrinking, Lanczos when enlarging
+/ [GRID data are always area averaged, so to safely handle NoData]
+/
+/ destination rows may be split between many threads
+/
+/ returns GGRAPH_ERROR if both images don't share the same layout
+*/
+    struct resample_weights wx;
+    struct resample_weights wy;
+    struct resample_context ctx;
+    int is_grid = 0;
+    int ret;
+
+    if (dst->pixel_format != src->pixel_format)
+	return GGRAPH_ERROR;
+    switch (src->pixel_format)
+      {
+      case GG_PIXEL_GRAYSCALE:
+	  ctx.channels = 1;
+	  break;
+      case GG_PIXEL_RGB:
+      case GG_PIXEL_BGR:
+      case GG_PIXEL_PALETTE:
+	  ctx.channels = 3;
+	  break;
+      case GG_PIXEL_RGBA:
+      case GG_PIXEL_ARGB:
+      case GG_PIXEL_BGRA:
+	  ctx.channels = 4;
+	  break;
+      case GG_PIXEL_GRID:
+	  if (dst->sample_format != src->sample_format
+	      || dst->bits_per_sample != src->bits_per_sample)
+	      return GGRAPH_ERROR;
+	  ctx.channels = 1;
+	  is_grid = 1;
+	  break;
+      default:
+	  return GGRAPH_ERROR;
+      };
+
+    if (!resample_weights_init
+	(&wx, src->width, dst->width, !is_grid && dst->width > src->width))
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    if (!resample_weights_init
+	(&wy, src->height, dst->height, !is_grid
+	 && dst->height > src->height))
+      {
+	  resample_weights_free (&wx);
+	  return GGRAPH_INSUFFICIENT_MEMORY;
+      }
+    ctx.dst = dst;
+    ctx.src = src;
+    ctx.wx = &wx;
+    ctx.wy = &wy;
+
+    ret = resize_by_threads (dst, src, &ctx, pool, num_threads);
+    resample_weights_free (&wx);
+    resample_weights_free (&wy);
+    if (!ret)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    return GGRAPH_OK;
+}
+
+struct strip_resizer
+{
+/* a Strip Image resampled on the fly */
+    gGraphStripImagePtr input;
+    int input_row;
+    int loaded_rows;
+    gGraphImagePtr window;
+    gGraphImagePtr block;
+    struct resample_weights wx;
+    struct resample_weights wy;
+    struct resample_context ctx;
+    struct resample_scratch scratch;
+};
+
+GGRAPH_PRIVATE void
+gg_strip_resizer_destroy (void *p)
+{
+/* destroying a Strip Image resampler [the input Strip Image is left untouched] */
+    struct strip_resizer *resizer = (struct strip_resizer *) p;
+    if (!resizer)
+	return;
+    if (resizer->window)
+	gg_image_destroy (resizer->window);
+    if (resizer->block)
+	gg_image_destroy (resizer->block);
+    resample_weights_free (&(resizer->wx));
+    resample_weights_free (&(resizer->wy));
+    resample_scratch_free (&(resizer->scratch));
+    free (resizer);
+}
+
+GGRAPH_PRIVATE int
+gg_strip_image_resize (const gGraphStripImagePtr input, int width, int height,
+		       gGraphStripImagePtr * strip)
+{
+/*
+/ preparing a Strip Image returning the input Strip Image resampled
+/ at a different resolution [High Quality]
+/
+/ reading by strips from the resampled image will in turn read
+/ by strips from the input image; just a few input rows are held
+/ in memory at the same time
+/ a PALETTE input will be resampled as RGB
+*/
+    gGraphStripImagePtr img = NULL;
+    struct strip_resizer *resizer = NULL;
+    int pixel_format = input->pixel_format;
+    int samples_per_pixel = input->samples_per_pixel;
+    int bits_per_sample = input->bits_per_sample;
+    int channels;
+    int is_grid = 0;
+    double size_x;
+    double size_y;
+
+    *strip = NULL;
+    if (width <= 0 || height <= 0)
+	return GGRAPH_ERROR;
+    if (input->next_row != 0)
+	return GGRAPH_ERROR;
+    switch (input->pixel_format)
+      {
+      case GG_PIXEL_GRAYSCALE:
+	  channels = 1;
+	  break;
+      case GG_PIXEL_PALETTE:
+	  pixel_format = GG_PIXEL_RGB;
+	  samples_per_pixel = 3;
+	  bits_per_sample = 8;
+	  channels = 3;
+	  break;
+      case GG_PIXEL_RGB:
+      case GG_PIXEL_BGR:
+	  channels = 3;
+	  break;
+      case GG_PIXEL_RGBA:
+      case GG_PIXEL_ARGB:
+      case GG_PIXEL_BGRA:
+	  channels = 4;
+	  break;
+      case GG_PIXEL_GRID:
+	  channels = 1;
+	  is_grid = 1;
+	  break;
+      default:
+	  return GGRAPH_ERROR;
+      };
+
+    resizer = malloc (sizeof (struct strip_resizer));
+    if (!resizer)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    resizer->input = input;
+    resizer->input_row = input->current_available_rows;
+    resizer->loaded_rows = 0;
+    resizer->window = NULL;
+    resizer->block = NULL;
+    resizer->wx.first = NULL;
+    resizer->wx.count = NULL;
+    resizer->wx.weights = NULL;
+    resizer->wx.grid_weights = NULL;
+    resizer->wy.first = NULL;
+    resizer->wy.count = NULL;
+    resizer->wy.weights = NULL;
+    resizer->wy.grid_weights = NULL;
+    memset (&(resizer->scratch), 0, sizeof (struct resample_scratch));
+    if (!resample_weights_init
+	(&(resizer->wx), input->width, width, !is_grid
+	 && width > input->width))
+	goto error;
+    if (!resample_weights_init
+	(&(resizer->wy), input->height, height, !is_grid
+	 && height > input->height))
+	goto error;
+
+/* the circular buffer holding the input rows */
+    resizer->window =
+	gg_image_create (input->pixel_format, input->width,
+			 resizer->wy.max_taps, input->bits_per_sample,
+			 input->samples_per_pixel, input->sample_format, NULL,
+			 NULL);
+    if (!resizer->window)
+	goto error;
+    resizer->window->max_palette = input->max_palette;
+    memcpy (resizer->window->palette_red, input->palette_red, 256);
+    memcpy (resizer->window->palette_green, input->palette_green, 256);
+    memcpy (resizer->window->palette_blue, input->palette_blue, 256);
+    resizer->window->no_data_value = input->no_data_value;
+    resizer->ctx.src = resizer->window;
+    resizer->ctx.dst = NULL;
+    resizer->ctx.wx = &(resizer->wx);
+    resizer->ctx.wy = &(resizer->wy);
+    resizer->ctx.channels = channels;
+
+    img =
+	gg_strip_image_create (NULL, GG_STRIP_RESIZER, pixel_format, width,
+			       height, bits_per_sample, samples_per_pixel,
+			       input->sample_format, input->srs_name,
+			       input->proj4text);
+    if (!img)
+	goto error;
+    img->codec_data = resizer;
+    img->no_data_value = input->no_data_value;
+    img->min_value = input->min_value;
+    img->max_value = input->max_value;
+    if (input->is_georeferenced)
+      {
+	  /* the georeferencing is carried through */
+	  img->is_georeferenced = 1;
+	  img->srid = input->srid;
+	  img->upper_left_x = input->upper_left_x;
+	  img->upper_left_y = input->upper_left_y;
+	  size_x = (double) (input->width) * input->pixel_x_size;
+	  size_y = (double) (input->height) * input->pixel_y_size;
+	  img->pixel_x_size = size_x / (double) width;
+	  img->pixel_y_size = size_y / (double) height;
+      }
+    *strip = img;
+    return GGRAPH_OK;
+
+  error:
+    gg_strip_resizer_destroy (resizer);
+    return GGRAPH_INSUFFICIENT_MEMORY;
+}
+
+static int
+strip_resizer_load_row (struct strip_resizer *resizer)
+{
+/* copying the next input row into the circular buffer */
+    gGraphStripImagePtr input = resizer->input;
+    gGraphImagePtr window = resizer->window;
+    int len = input->scanline_width;
+    int ret;
+    if (resizer->input_row >= input->current_available_rows)
+      {
+	  /* reading the next input strip */
+	  if (input->next_row >= input->height)
+	      return GGRAPH_ERROR;
+	  ret = gGraphReadNextStrip (input, NULL);
+	  if (ret != GGRAPH_OK)
+	      return ret;
+	  resizer->input_row = 0;
+      }
+    if (len > window->scanline_width)
+	len = window->scanline_width;
+    memcpy (resample_row_ptr (window, resizer->loaded_rows),
+	    input->pixels + (resizer->input_row * input->scanline_width), len);
+    resizer->input_row += 1;
+    resizer->loaded_rows += 1;
+    return GGRAPH_OK;
+}
+
+GGRAPH_PRIVATE int
+gg_image_strip_read_from_resizer (gGraphStripImagePtr img, int *progress)
+{
+/* resampling the next strip */
+    struct strip_resizer *resizer = (struct strip_resizer *) (img->codec_data);
+    int rows = img->rows_per_block;
+    int len;
+    int ret;
+    int y;
+    int r;
+
+    if (img->pixels == NULL || resizer->input->pixels == NULL)
+	return GGRAPH_ERROR;
+    if (img->next_row + rows > img->height)
+	rows = img->height - img->next_row;
+    if (resizer->block != NULL
+	&& resizer->block->height != img->rows_per_block)
+      {
+	  gg_image_destroy (resizer->block);
+	  resizer->block = NULL;
+      }
+    if (resizer->block == NULL)
+      {
+	  /* allocating the output rows */
+	  resizer->block =
+	      gg_image_create (img->pixel_format, img->width,
+			       img->rows_per_block, img->bits_per_sample,
+			       img->samples_per_pixel, img->sample_format,
+			       NULL, NULL);
+	  if (!resizer->block)
+	      return GGRAPH_INSUFFICIENT_MEMORY;
+	  resizer->block->no_data_value = img->no_data_value;
+	  resizer->ctx.dst = resizer->block;
+      }
+    if (resizer->scratch.acc == NULL && resizer->scratch.grid_acc == NULL)
+      {
+	  /* allocating the working buffers, once for all */
+	  if (!resample_scratch_alloc (&(resizer->ctx), &(resizer->scratch)))
+	      return GGRAPH_INSUFFICIENT_MEMORY;
+      }
+
+    len = img->scanline_width;
+    if (len > resizer->block->scanline_width)
+	len = resizer->block->scanline_width;
+    for (r = 0; r < rows; r++)
+      {
+	  y = img->next_row + r;
+	  while (resizer->loaded_rows < resizer->wy.first[y] +
+		 resizer->wy.count[y])
+	    {
+		/* the output row requires further input rows */
+		ret = strip_resizer_load_row (resizer);
+		if (ret != GGRAPH_OK)
+		    return ret;
+	    }
+	  if (img->pixel_format == GG_PIXEL_GRID)
+	      resample_grid_rows (&(resizer->ctx), &(resizer->scratch), y,
+				  y + 1);
+	  else
+	      resample_image_rows (&(resizer->ctx), &(resizer->scratch), y,
+				   y + 1);
+	  memcpy (img->pixels + (r * img->scanline_width),
+		  resample_row_ptr (resizer->block, y), len);
+      }
+    img->current_available_rows = rows;
+    img->next_row += rows;
+    if (progress != NULL)
+	*progress =
+	    (int) (((double) (img->next_row + 1) * 100.0) /
+		   (double) (img->height));
+    return GGRAPH_OK;
+}
+
+GGRAPH_PRIVATE int
+gg_convert_image_to_grid_int16 (const gGraphImagePtr img)
+{
+/* converting this grid-image to Int16 */
+    int x;
+    int y;
+    void *pixels;
+    short value;
+    unsigned char *p_in;
+    short *p_out;
+
+    if (img->pixel_format != GG_PIXEL_GRID)
+	return GGRAPH_INVALID_IMAGE;
+
+    if (img->sample_format == GGRAPH_SAMPLE_INT && img->bits_per_sample == 16)
+	return GGRAPH_OK;
+
+    pixels = malloc (img->width * img->height * sizeof (short));
+    if (!pixels)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    for (y = 0; y < img->height; y++)
+      {
+	  /* processing any scanline */
+	  p_in = img->pixels + (y * img->scanline_width);
+	  p_out = pixels;
+	  p_out += (y * img->width);
+	  for (x = 0; x < img->width; x++)
+	    {
+		/* retrieving the origin pixel */
+		if (img->sample_format == GGRAPH_SAMPLE_UINT
+		    && img->bits_per_sample == 16)
+		  {
+		      value = (short) *((unsigned short *) p_in);
+		      p_in += sizeof (unsigned short);
+		  }
+		if (img->sample_format == GGRAPH_SAMPLE_INT
+		    && img->bits_per_sample == 32)
+		  {
+		      value = (short) *((int *) p_in);
+		      p_in += sizeof (int);
+		  }
+		if (img->sample_format == GGRAPH_SAMPLE_UINT
 		    && img->bits_per_sample == 32)
 		  {
 		      value = (short) *((unsigned int *) p_in);
@@ -3186,12 +4846,16 @@ gg_convert_image_to_palette (const gGraphImagePtr img)
 }
 
 GGRAPH_PRIVATE int
-gg_convert_image_to_monochrome (const gGraphImagePtr img)
+gg_convert_image_to_monochrome (const gGraphImagePtr img, int dither)
 {
-/* converting this image to MONOCHROME */
+/*
+/ converting this image to MONOCHROME
+/ applying Floyd-Steinberg error diffusion if required
+*/
     int x;
     int y;
     void *pixels;
+    gGraphDitherPtr fs = NULL;
     unsigned char red;
     unsigned char green;
     unsigned char blue;
@@ -3216,6 +4880,15 @@ gg_convert_image_to_monochrome (const gGraphImagePtr img)
     pixels = malloc (img->width * img->height);
     if (!pixels)
 	return GGRAPH_INSUFFICIENT_MEMORY;
+    if (dither)
+      {
+	  fs = gg_dither_create (img->width, 1);
+	  if (!fs)
+	    {
+		free (pixels);
+		return GGRAPH_INSUFFICIENT_MEMORY;
+	    }
+      }
     for (y = 0; y < img->height; y++)
       {
 	  /* processing any scanline */
@@ -3272,6 +4945,15 @@ gg_convert_image_to_monochrome (const gGraphImagePtr img)
 		      green = img->palette_green[index];
 		      blue = img->palette_blue[index];
 		  }
+		if (fs)
+		  {
+		      /* saving the gray level for error diffusion */
+		      if (red == green && green == blue)
+			  fs->pixels[x] = red;
+		      else
+			  fs->pixels[x] = to_grayscale (red, green, blue);
+		      continue;
+		  }
 		/* setting the destination pixel */
 		if (red == 0 && green == 0 && blue == 0)
 		    index = 0;
@@ -3294,7 +4976,11 @@ gg_convert_image_to_monochrome (const gGraphImagePtr img)
 		  }
 		*p_out++ = index;
 	    }
+	  if (fs)
+	      gg_dither_gray_row (fs, p_out, 0, 1);
       }
+    if (fs)
+	gg_dither_destroy (fs);
 
     free (img->pixels);
     img->pixels = pixels;
@@ -3302,6 +4988,7 @@ gg_convert_image_to_monochrome (const gGraphImagePtr img)
     img->scanline_width = img->width;
     img->pixel_size = 1;
     img->max_palette = 2;
+    img->palette_version++;
     img->palette_red[0] = 0;
     img->palette_green[0] = 0;
     img->palette_blue[0] = 0;
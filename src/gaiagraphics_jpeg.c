@@ -42,6 +42,7 @@ struct jpeg_codec_data
     int is_writer;
     struct jpeg_compress_struct cmp_cinfo;
     struct jpeg_decompress_struct dec_cinfo;
+    struct jpeg_error_mgr jerr;	/* must outlive the creating function */
     JSAMPROW row;
     xgdIOCtx *io_ctx;
 };
@@ -88,9 +89,27 @@ my_source_mgr;
 typedef my_source_mgr *my_src_ptr;
 
 #define INPUT_BUF_SIZE  4096
+#define JPEG_ROWS_PER_READ  16
 
 typedef my_destination_mgr *my_dest_ptr;
 
+struct jpeg_mem_output
+{
+/* a memory buffer receiving a compressed JPEG */
+    unsigned char *buffer;
+    size_t size;		/* the allocated size */
+    size_t used;		/* the actual JPEG size */
+};
+
+typedef struct
+{
+    struct jpeg_destination_mgr pub;
+    struct jpeg_mem_output *output;
+}
+my_mem_destination_mgr;
+
+typedef my_mem_destination_mgr *my_mem_dest_ptr;
+
 static void
 fatal_jpeg_error (j_common_ptr cinfo)
 {
@@ -264,10 +283,208 @@ jpeg_xgdIOCtx_dest (j_compress_ptr cinfo, xgdIOCtx * outfile)
     dest->outfile = outfile;
 }
 
+static void
+init_mem_source (j_decompress_ptr cinfo)
+{
+    if (cinfo)
+	return;			/* the whole JPEG is already available */
+}
+
+static safeboolean
+fill_mem_input_buffer (j_decompress_ptr cinfo)
+{
+/* the memory buffer is exhausted: inserting a fake EOI marker */
+    static const JOCTET fake_eoi[2] = { 0xFF, JPEG_EOI };
+    WARNMS (cinfo, JWRN_JPEG_EOF);
+    cinfo->src->next_input_byte = fake_eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+}
+
+static void
+skip_mem_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+    struct jpeg_source_mgr *src = cinfo->src;
+    if (num_bytes <= 0)
+	return;
+    if (num_bytes > (long) src->bytes_in_buffer)
+      {
+	  (void) fill_mem_input_buffer (cinfo);
+	  return;
+      }
+    src->next_input_byte += (size_t) num_bytes;
+    src->bytes_in_buffer -= (size_t) num_bytes;
+}
+
+static void
+jpeg_xgdMemory_src (j_decompress_ptr cinfo, const void *data, int size)
+{
+/* 
+/ reading a JPEG directly from a memory buffer
+/ [libjpeg simply walks through the caller's buffer: no copies at all]
+*/
+    struct jpeg_source_mgr *src;
+    if (cinfo->src == NULL)
+      {
+	  cinfo->src = (struct jpeg_source_mgr *)
+	      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+					  sizeof (struct jpeg_source_mgr));
+      }
+    src = cinfo->src;
+    src->init_source = init_mem_source;
+    src->fill_input_buffer = fill_mem_input_buffer;
+    src->skip_input_data = skip_mem_input_data;
+    src->resync_to_restart = jpeg_resync_to_restart;
+    src->term_source = term_source;
+    src->next_input_byte = (const JOCTET *) data;
+    src->bytes_in_buffer = (size < 0) ? 0 : (size_t) size;
+}
+
+static void
+init_mem_destination (j_compress_ptr cinfo)
+{
+    my_mem_dest_ptr dest = (my_mem_dest_ptr) cinfo->dest;
+    dest->pub.next_output_byte = (JOCTET *) (dest->output->buffer);
+    dest->pub.free_in_buffer = dest->output->size;
+}
+
+static safeboolean
+empty_mem_output_buffer (j_compress_ptr cinfo)
+{
+/* the size estimate was too small: doubling the output buffer */
+    my_mem_dest_ptr dest = (my_mem_dest_ptr) cinfo->dest;
+    struct jpeg_mem_output *output = dest->output;
+    size_t new_size = output->size * 2;
+    unsigned char *buffer = realloc (output->buffer, new_size);
+    if (buffer == NULL)
+	ERREXIT1 (cinfo, JERR_OUT_OF_MEMORY, 10);
+    dest->pub.next_output_byte = (JOCTET *) (buffer + output->size);
+    dest->pub.free_in_buffer = new_size - output->size;
+    output->buffer = buffer;
+    output->size = new_size;
+    return TRUE;
+}
+
+static void
+term_mem_destination (j_compress_ptr cinfo)
+{
+    my_mem_dest_ptr dest = (my_mem_dest_ptr) cinfo->dest;
+    dest->output->used = dest->output->size - dest->pub.free_in_buffer;
+}
+
+static void
+jpeg_xgdMemory_dest (j_compress_ptr cinfo, struct jpeg_mem_output *output)
+{
+/* 
+/ writing a JPEG directly into a pre-reserved memory buffer 
+/ [the buffer will be enlarged only if the size estimate fails]
+*/
+    my_mem_dest_ptr dest;
+    if (cinfo->dest == NULL)
+      {
+	  cinfo->dest = (struct jpeg_destination_mgr *)
+	      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+					  sizeof (my_mem_destination_mgr));
+      }
+    dest = (my_mem_dest_ptr) cinfo->dest;
+    dest->pub.init_destination = init_mem_destination;
+    dest->pub.empty_output_buffer = empty_mem_output_buffer;
+    dest->pub.term_destination = term_mem_destination;
+    dest->output = output;
+}
+
+GGRAPH_PRIVATE void
+gg_jpeg_default_options (gGraphJpegOptionsPtr options, int quality)
+{
+/* initializing the JPEG compression options: baseline, 4:2:0 */
+    options->quality = quality;
+    options->progressive = 0;
+    options->optimize_coding = 0;
+    options->subsampling = GGRAPH_JPEG_SUBSAMPLING_420;
+    options->restart_interval = 0;
+}
+
+GGRAPH_PRIVATE int
+gg_jpeg_check_options (const gGraphJpegOptionsPtr options)
+{
+/* checking the JPEG compression options for validity */
+    if (options->subsampling != GGRAPH_JPEG_SUBSAMPLING_420
+	&& options->subsampling != GGRAPH_JPEG_SUBSAMPLING_422
+	&& options->subsampling != GGRAPH_JPEG_SUBSAMPLING_444)
+	return 0;
+    if (options->restart_interval < 0 || options->restart_interval > 65535)
+	return 0;
+    return 1;
+}
+
+static void
+jpeg_apply_options (j_compress_ptr cinfo, const gGraphJpegOptionsPtr options)
+{
+/* 
+/ setting up the compressor accordingly to the given options
+/ must be called after jpeg_set_defaults()
+*/
+    int h_samp = 2;
+    int v_samp = 2;
+    if (options->quality >= 0)
+	jpeg_set_quality (cinfo, options->quality, TRUE);
+    if (cinfo->num_components == 3)
+      {
+	  /* chroma subsampling: Cb and Cr always are 1x1 */
+	  if (options->subsampling == GGRAPH_JPEG_SUBSAMPLING_422)
+	      v_samp = 1;
+	  else if (options->subsampling == GGRAPH_JPEG_SUBSAMPLING_444)
+	    {
+		h_samp = 1;
+		v_samp = 1;
+	    }
+	  cinfo->comp_info[0].h_samp_factor = h_samp;
+	  cinfo->comp_info[0].v_samp_factor = v_samp;
+	  cinfo->comp_info[1].h_samp_factor = 1;
+	  cinfo->comp_info[1].v_samp_factor = 1;
+	  cinfo->comp_info[2].h_samp_factor = 1;
+	  cinfo->comp_info[2].v_samp_factor = 1;
+      }
+    if (options->optimize_coding)
+	cinfo->optimize_coding = TRUE;
+    if (options->restart_interval > 0)
+	cinfo->restart_in_rows = options->restart_interval;
+    if (options->progressive)
+	jpeg_simple_progression (cinfo);
+}
+
+static size_t
+jpeg_estimate_size (const gGraphImagePtr img, int quality)
+{
+/* 
+/ estimating the size of the compressed JPEG, so to reserve
+/ the output buffer just once in the most common cases
+*/
+    size_t raw;
+    size_t est;
+    int channels = (img->pixel_format == GG_PIXEL_GRAYSCALE) ? 1 : 3;
+    raw = (size_t) (img->width) * (size_t) (img->height) * channels;
+    if (quality < 0)
+	quality = 75;
+    if (quality >= 95)
+	est = raw / 2;
+    else if (quality >= 85)
+	est = raw / 4;
+    else if (quality >= 60)
+	est = raw / 6;
+    else
+	est = raw / 10;
+/* the headers, quantization and Huffman tables and the comment */
+    return est + 2048;
+}
+
 static int
-xgdImageJpegCtx (gGraphImagePtr img, xgdIOCtx * outfile, int quality)
+xgdImageJpegCtx (gGraphImagePtr img, xgdIOCtx * outfile,
+		 struct jpeg_mem_output *mem_out,
+		 const gGraphJpegOptionsPtr options)
 {
 /* compressing a JPEG image */
+    int quality = options->quality;
     struct jpeg_compress_struct cinfo;
     struct jpeg_error_mgr jerr;
     int i, j, jidx;
@@ -303,9 +520,11 @@ xgdImageJpegCtx (gGraphImagePtr img, xgdIOCtx * outfile, int quality)
 	  cinfo.in_color_space = JCS_RGB;
       }
     jpeg_set_defaults (&cinfo);
-    if (quality >= 0)
-	jpeg_set_quality (&cinfo, quality, TRUE);
-    jpeg_xgdIOCtx_dest (&cinfo, outfile);
+    jpeg_apply_options (&cinfo, options);
+    if (mem_out != NULL)
+	jpeg_xgdMemory_dest (&cinfo, mem_out);
+    else
+	jpeg_xgdIOCtx_dest (&cinfo, outfile);
     row = (JSAMPROW) calloc (1, cinfo.image_width * cinfo.input_components
 			     * sizeof (JSAMPLE));
     if (row == 0)
@@ -439,74 +658,74 @@ gg_jpeg_codec_destroy (void *p)
 }
 
 static int
-xgdStripImageJpegCtx (gGraphStripImagePtr img, xgdIOCtx * outfile, int quality)
+xgdStripImageJpegCtx (gGraphStripImagePtr img, xgdIOCtx * outfile,
+		      const gGraphJpegOptionsPtr options)
 {
-/* preparing to compress a JPEG image (by strip) */
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
+/* 
+/ preparing to compress a JPEG image (by strip)
+/ the compressor lives within the codec struct since the very beginning:
+/ some libjpeg modules (e.g. the progressive encoder) keep pointers to it
+*/
+    int quality = options->quality;
+    j_compress_ptr cinfo;
     volatile JSAMPROW row = 0;
     jmpbuf_wrapper jmpbufw;
     char comment[255];
     struct jpeg_codec_data *jpeg_codec;
-    memset (&cinfo, 0, sizeof (cinfo));
-    memset (&jerr, 0, sizeof (jerr));
-    cinfo.err = jpeg_std_error (&jerr);
-    cinfo.client_data = &jmpbufw;
+
+/* setting up the JPEG codec struct */
+    jpeg_codec = malloc (sizeof (struct jpeg_codec_data));
+    if (!jpeg_codec)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    memset (jpeg_codec, 0, sizeof (struct jpeg_codec_data));
+    jpeg_codec->is_writer = 1;
+    cinfo = &(jpeg_codec->cmp_cinfo);
+    cinfo->err = jpeg_std_error (&(jpeg_codec->jerr));
+    cinfo->client_data = &jmpbufw;
     if (setjmp (jmpbufw.jmpbuf) != 0)
       {
 	  if (row)
 	      free (row);
+	  free (jpeg_codec);
 	  return GGRAPH_JPEG_CODEC_ERROR;
       }
-    cinfo.err->error_exit = fatal_jpeg_error;
-    jpeg_create_compress (&cinfo);
-    cinfo.image_width = img->width;
-    cinfo.image_height = img->height;
+    cinfo->err->error_exit = fatal_jpeg_error;
+    jpeg_create_compress (cinfo);
+    cinfo->image_width = img->width;
+    cinfo->image_height = img->height;
     if (img->pixel_format == GG_PIXEL_GRAYSCALE)
       {
 	  /* GRAYSCALE */
-	  cinfo.input_components = 1;
-	  cinfo.in_color_space = JCS_GRAYSCALE;
+	  cinfo->input_components = 1;
+	  cinfo->in_color_space = JCS_GRAYSCALE;
       }
     else
       {
 	  /* RGB */
-	  cinfo.input_components = 3;
-	  cinfo.in_color_space = JCS_RGB;
+	  cinfo->input_components = 3;
+	  cinfo->in_color_space = JCS_RGB;
       }
-    jpeg_set_defaults (&cinfo);
-    if (quality >= 0)
-	jpeg_set_quality (&cinfo, quality, TRUE);
-    jpeg_xgdIOCtx_dest (&cinfo, outfile);
-    row = (JSAMPROW) calloc (1, cinfo.image_width * cinfo.input_components
+    jpeg_set_defaults (cinfo);
+    jpeg_apply_options (cinfo, options);
+    jpeg_xgdIOCtx_dest (cinfo, outfile);
+    row = (JSAMPROW) calloc (1, cinfo->image_width * cinfo->input_components
 			     * sizeof (JSAMPLE));
     if (row == 0)
       {
-	  jpeg_destroy_compress (&cinfo);
+	  jpeg_destroy_compress (cinfo);
+	  free (jpeg_codec);
 	  return GGRAPH_INSUFFICIENT_MEMORY;
       }
-    jpeg_start_compress (&cinfo, TRUE);
+    jpeg_start_compress (cinfo, TRUE);
     sprintf (comment, "CREATOR: jpeg-wrapper (using IJG JPEG v%d),",
 	     JPEG_LIB_VERSION);
     if (quality >= 0)
 	sprintf (comment + strlen (comment), " quality = %d\n", quality);
     else
 	strcat (comment + strlen (comment), " default quality\n");
-    jpeg_write_marker (&cinfo, JPEG_COM, (unsigned char *) comment,
+    jpeg_write_marker (cinfo, JPEG_COM, (unsigned char *) comment,
 		       (unsigned int) strlen (comment));
 
-/* setting up the JPEG codec struct */
-    jpeg_codec = malloc (sizeof (struct jpeg_codec_data));
-    if (!jpeg_codec)
-      {
-	  jpeg_destroy_compress (&cinfo);
-	  free (row);
-	  gg_strip_image_destroy (img);
-	  return GGRAPH_INSUFFICIENT_MEMORY;
-      }
-    jpeg_codec->is_writer = 1;
-    memcpy (&(jpeg_codec->cmp_cinfo), &cinfo,
-	    sizeof (struct jpeg_compress_struct));
     jpeg_codec->row = row;
     jpeg_codec->io_ctx = outfile;
     img->codec_data = jpeg_codec;
@@ -625,8 +844,26 @@ CMYKToRGB (int c, int m, int y, int k, int inverted, unsigned char *red,
     *blue = (255 - y) * (255 - k) / 255;
 }
 
+static void
+jpeg_set_decode_mode (j_decompress_ptr cinfo, int decode_mode)
+{
+/* 
+/ selecting the speed / quality tradeoff of the decoder
+/ FAST: integer DCT, plain replicating upsampling and no block smoothing
+/ [good enough for previews and thumbnails; the speedup depends on the
+/ libjpeg build: it's within noise on SIMD libjpeg-turbo, and only
+/ older or non-SIMD builds really benefit]
+*/
+    if (decode_mode != GGRAPH_JPEG_DECODE_FAST)
+	return;
+    cinfo->dct_method = JDCT_IFAST;
+    cinfo->do_fancy_upsampling = FALSE;
+    cinfo->do_block_smoothing = FALSE;
+}
+
 static gGraphImageInfosPtr
-xgdImageInspectJpegCtx (xgdIOCtx * infile, int *errcode)
+xgdImageInspectJpegCtx (xgdIOCtx * infile, const void *mem_buf,
+			int mem_buf_size, int *errcode)
 {
     struct jpeg_decompress_struct cinfo;
     struct jpeg_error_mgr jerr;
@@ -646,7 +883,10 @@ xgdImageInspectJpegCtx (xgdIOCtx * infile, int *errcode)
       }
     cinfo.err->error_exit = fatal_jpeg_error;
     jpeg_create_decompress (&cinfo);
-    jpeg_xgdIOCtx_src (&cinfo, infile);
+    if (infile == NULL)
+	jpeg_xgdMemory_src (&cinfo, mem_buf, mem_buf_size);
+    else
+	jpeg_xgdIOCtx_src (&cinfo, infile);
     jpeg_save_markers (&cinfo, JPEG_APP0 + 14, 256);
     retval = jpeg_read_header (&cinfo, TRUE);
     if (retval != JPEG_HEADER_OK)
@@ -688,15 +928,19 @@ xgdImageInspectJpegCtx (xgdIOCtx * infile, int *errcode)
     infos->scale_1_2 = 1;
     infos->scale_1_4 = 1;
     infos->scale_1_8 = 1;
+    jpeg_destroy_decompress (&cinfo);
     return infos;
   error:
+    jpeg_destroy_decompress (&cinfo);
     if (infos)
 	gg_image_infos_destroy (infos);
     return NULL;
 }
 
 static gGraphImagePtr
-xgdImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, int scale)
+xgdImageCreateFromJpegCtx (xgdIOCtx * infile, const void *mem_buf,
+			   int mem_buf_size, int *errcode, int scale,
+			   int decode_mode)
 {
 /* decompressing a JPEG image */
     struct jpeg_decompress_struct cinfo;
@@ -727,7 +971,10 @@ xgdImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, int scale)
       }
     cinfo.err->error_exit = fatal_jpeg_error;
     jpeg_create_decompress (&cinfo);
-    jpeg_xgdIOCtx_src (&cinfo, infile);
+    if (infile == NULL)
+	jpeg_xgdMemory_src (&cinfo, mem_buf, mem_buf_size);
+    else
+	jpeg_xgdIOCtx_src (&cinfo, infile);
     jpeg_save_markers (&cinfo, JPEG_APP0 + 14, 256);
     retval = jpeg_read_header (&cinfo, TRUE);
     if (retval != JPEG_HEADER_OK)
@@ -763,6 +1010,7 @@ xgdImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, int scale)
 	  cinfo.scale_num = 8;
       }
     cinfo.scale_denom = 8;
+    jpeg_set_decode_mode (&cinfo, decode_mode);
     if ((cinfo.jpeg_color_space == JCS_CMYK) ||
 	(cinfo.jpeg_color_space == JCS_YCCK))
 	cinfo.out_color_space = JCS_CMYK;
@@ -882,46 +1130,27 @@ xgdImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, int scale)
 		  }
 	    }
       }
-    else if (cinfo.out_color_space == JCS_GRAYSCALE)
-      {
-	  for (i = 0; i < (int) cinfo.output_height; i++)
-	    {
-		register JSAMPROW currow = row;
-		unsigned char *p_out = img->pixels + (i * img->scanline_width);
-		nrows = jpeg_read_scanlines (&cinfo, rowptr, 1);
-		if (nrows != 1)
-		  {
-		      fprintf (stderr,
-			       "jpeg-wrapper: error: jpeg_read_scanlines returns %u, expected 1\n",
-			       nrows);
-		      *errcode = GGRAPH_JPEG_CODEC_ERROR;
-		      goto error;
-		  }
-		for (j = 0; j < (int) cinfo.output_width; j++, currow++)
-		    *p_out++ = currow[0];
-	    }
-      }
     else
       {
-	  for (i = 0; i < (int) cinfo.output_height; i++)
+	  /* RGB or GRAYSCALE: decoding directly into the image rows */
+	  while (cinfo.output_scanline < cinfo.output_height)
 	    {
-		register JSAMPROW currow = row;
-		unsigned char *p_out = img->pixels + (i * img->scanline_width);
-		nrows = jpeg_read_scanlines (&cinfo, rowptr, 1);
-		if (nrows != 1)
+		JSAMPROW rows[JPEG_ROWS_PER_READ];
+		int count = cinfo.output_height - cinfo.output_scanline;
+		if (count > JPEG_ROWS_PER_READ)
+		    count = JPEG_ROWS_PER_READ;
+		for (i = 0; i < count; i++)
+		    rows[i] =
+			img->pixels +
+			((cinfo.output_scanline + i) * img->scanline_width);
+		nrows = jpeg_read_scanlines (&cinfo, rows, count);
+		if (nrows == 0)
 		  {
 		      fprintf (stderr,
-			       "jpeg-wrapper: error: jpeg_read_scanlines returns %u, expected 1\n",
-			       nrows);
+			       "jpeg-wrapper: error: jpeg_read_scanlines returns 0 rows\n");
 		      *errcode = GGRAPH_JPEG_CODEC_ERROR;
 		      goto error;
 		  }
-		for (j = 0; j < (int) cinfo.output_width; j++, currow += 3)
-		  {
-		      *p_out++ = currow[0];
-		      *p_out++ = currow[1];
-		      *p_out++ = currow[2];
-		  }
 	    }
       }
     if (jpeg_finish_decompress (&cinfo) != TRUE)
@@ -940,7 +1169,8 @@ xgdImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, int scale)
 }
 
 static gGraphStripImagePtr
-xgdStripImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, FILE * file)
+xgdStripImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, FILE * file,
+				int decode_mode)
 {
 /* preparing to decompress a JPEG image [by strips] */
     struct jpeg_decompress_struct cinfo;
@@ -982,6 +1212,7 @@ xgdStripImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, FILE * file)
 		 cinfo.image_width);
     cinfo.scale_num = 8;
     cinfo.scale_denom = 8;
+    jpeg_set_decode_mode (&cinfo, decode_mode);
     if ((cinfo.jpeg_color_space == JCS_CMYK) ||
 	(cinfo.jpeg_color_space == JCS_YCCK))
 	cinfo.out_color_space = JCS_CMYK;
@@ -1085,6 +1316,8 @@ xgdStripImageCreateFromJpegCtx (xgdIOCtx * infile, int *errcode, FILE * file)
     jpeg_codec->is_writer = 0;
     memcpy (&(jpeg_codec->dec_cinfo), &cinfo,
 	    sizeof (struct jpeg_decompress_struct));
+    memcpy (&(jpeg_codec->jerr), &jerr, sizeof (struct jpeg_error_mgr));
+    jpeg_codec->dec_cinfo.err = &(jpeg_codec->jerr);
     jpeg_codec->row = row;
     jpeg_codec->io_ctx = infile;
     img->codec_data = jpeg_codec;
@@ -1206,13 +1439,14 @@ xgdStripImageReadFromJpegCtx (gGraphStripImagePtr img)
 
 GGRAPH_PRIVATE int
 gg_image_to_jpeg (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
-		  FILE * file, int dest_type, int quality)
+		  FILE * file, int dest_type,
+		  const gGraphJpegOptionsPtr options)
 {
 /* compressing an image as JPEG */
     int ret;
-    void *rv;
-    int size;
     xgdIOCtx *out;
+    struct jpeg_mem_output mem_out;
+    unsigned char *buf;
 
 /* checkings args for validity */
     if (dest_type == GG_TARGET_IS_FILE)
@@ -1228,38 +1462,55 @@ gg_image_to_jpeg (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
 	  *mem_buf_size = 0;
       }
 
-    if (dest_type == GG_TARGET_IS_FILE)
-	out = xgdNewDynamicCtx (0, file, dest_type);
-    else
-	out = xgdNewDynamicCtx (2048, NULL, dest_type);
-    ret = xgdImageJpegCtx (img, out, quality);
     if (dest_type == GG_TARGET_IS_FILE)
       {
+	  out = xgdNewDynamicCtx (0, file, dest_type);
+	  ret = xgdImageJpegCtx (img, out, NULL, options);
 	  out->xgd_free (out);
 	  return ret;
       }
 
-    if (ret == GGRAPH_OK)
-	rv = xgdDPExtractData (out, &size);
-    out->xgd_free (out);
-    *mem_buf = rv;
-    *mem_buf_size = size;
+/* compressing directly into a pre-reserved memory buffer */
+    mem_out.size = jpeg_estimate_size (img, options->quality);
+    mem_out.used = 0;
+    mem_out.buffer = malloc (mem_out.size);
+    if (mem_out.buffer == NULL)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    ret = xgdImageJpegCtx (img, NULL, &mem_out, options);
+    if (ret != GGRAPH_OK || mem_out.used > INT_MAX)
+      {
+	  free (mem_out.buffer);
+	  return (ret != GGRAPH_OK) ? ret : GGRAPH_JPEG_CODEC_ERROR;
+      }
+    if (mem_out.used < mem_out.size / 2)
+      {
+	  /* releasing a badly overestimated buffer */
+	  buf = realloc (mem_out.buffer, mem_out.used);
+	  if (buf != NULL)
+	      mem_out.buffer = buf;
+      }
+    *mem_buf = mem_out.buffer;
+    *mem_buf_size = (int) (mem_out.used);
     return ret;
 }
 
 GGRAPH_PRIVATE int
 gg_image_prepare_to_jpeg_by_strip (const gGraphStripImagePtr img, FILE * file,
-				   int quality)
+				   const gGraphJpegOptionsPtr options)
 {
 /* preparing to compress an image as JPEG [by strip] */
     xgdIOCtx *out;
+    int ret;
 
 /* checkings args for validity */
     if (!file)
 	return GGRAPH_ERROR;
 
     out = xgdNewDynamicCtx (0, file, GG_TARGET_IS_FILE);
-    return xgdStripImageJpegCtx (img, out, quality);
+    ret = xgdStripImageJpegCtx (img, out, options);
+    if (ret != GGRAPH_OK)
+	out->xgd_free (out);
+    return ret;
 }
 
 GGRAPH_PRIVATE int
@@ -1276,14 +1527,24 @@ gg_image_write_to_jpeg_by_strip (const gGraphStripImagePtr img, int *progress)
 
 GGRAPH_PRIVATE int
 gg_image_from_jpeg (int size, const void *data, int source_type,
-		    gGraphImagePtr * image_handle, int scale)
+		    gGraphImagePtr * image_handle, int scale, int decode_mode)
 {
 /* uncompressing a JPEG */
     int errcode = GGRAPH_OK;
     gGraphImagePtr img;
-    xgdIOCtx *in =
-	xgdNewDynamicCtxEx (size, data, XGD_CTX_DONT_FREE, source_type);
-    img = xgdImageCreateFromJpegCtx (in, &errcode, scale);
+    xgdIOCtx *in;
+    if (source_type == GG_TARGET_IS_MEMORY)
+      {
+	  /* decompressing directly from the caller's buffer */
+	  img =
+	      xgdImageCreateFromJpegCtx (NULL, data, size, &errcode, scale,
+					 decode_mode);
+	  *image_handle = img;
+	  return errcode;
+      }
+    in = xgdNewDynamicCtxEx (size, data, XGD_CTX_DONT_FREE, source_type);
+    img =
+	xgdImageCreateFromJpegCtx (in, NULL, 0, &errcode, scale, decode_mode);
     in->xgd_free (in);
     *image_handle = img;
     return errcode;
@@ -1296,16 +1557,23 @@ gg_image_infos_from_jpeg (int size, const void *data, int source_type,
 /* image infos from JPEG */
     int errcode = GGRAPH_OK;
     gGraphImageInfosPtr infos;
-    xgdIOCtx *in =
-	xgdNewDynamicCtxEx (size, data, XGD_CTX_DONT_FREE, source_type);
-    infos = xgdImageInspectJpegCtx (in, &errcode);
+    xgdIOCtx *in;
+    if (source_type == GG_TARGET_IS_MEMORY)
+      {
+	  /* inspecting directly the caller's buffer */
+	  infos = xgdImageInspectJpegCtx (NULL, data, size, &errcode);
+	  *infos_handle = infos;
+	  return errcode;
+      }
+    in = xgdNewDynamicCtxEx (size, data, XGD_CTX_DONT_FREE, source_type);
+    infos = xgdImageInspectJpegCtx (in, NULL, 0, &errcode);
     in->xgd_free (in);
     *infos_handle = infos;
     return errcode;
 }
 
 GGRAPH_PRIVATE int
-gg_image_strip_prepare_from_jpeg (FILE * file,
+gg_image_strip_prepare_from_jpeg (FILE * file, int decode_mode,
 				  gGraphStripImagePtr * image_handle)
 {
 /* preparing to uncompress a JPEG [by strips] */
@@ -1313,7 +1581,7 @@ gg_image_strip_prepare_from_jpeg (FILE * file,
     gGraphStripImagePtr img;
     xgdIOCtx *in =
 	xgdNewDynamicCtxEx (0, file, XGD_CTX_DONT_FREE, GG_TARGET_IS_FILE);
-    img = xgdStripImageCreateFromJpegCtx (in, &errcode, file);
+    img = xgdStripImageCreateFromJpegCtx (in, &errcode, file, decode_mode);
     *image_handle = img;
     return errcode;
 }
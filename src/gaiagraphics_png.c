@@ -30,6 +30,7 @@
 #include <stdlib.h>
 
 #include <png.h>
+#include <zlib.h>
 
 #define PNG_TRUE 1
 #define PNG_FALSE 0
@@ -1125,9 +1126,118 @@ xgdStripImageReadFromPngCtx (gGraphStripImagePtr img)
     return GGRAPH_OK;
 }
 
+GGRAPH_PRIVATE void
+gg_png_default_options (gGraphPngOptionsPtr options, int preset,
+			int compression_level)
+{
+/*
+/ initializing the PNG compression options
+/ any compression_level outside 0 to 9 selects the preset's own level
+*/
+    options->preset = preset;
+    options->filter = GGRAPH_PNG_FILTER_ADAPTIVE;
+    options->strategy = 0;
+    options->window_bits = 0;
+    options->mem_level = 0;
+    if (preset == GGRAPH_PNG_PRESET_FAST)
+      {
+	  /*
+	     / the "fast" preset is intended for map tiles, mostly
+	     / made of large flat areas: skipping the adaptive filter
+	     / heuristics saves most of the encoding time, and flat
+	     / areas compress well enough even when unfiltered
+	   */
+	  options->filter = GGRAPH_PNG_FILTER_NONE;
+	  if (compression_level < 0 || compression_level > 9)
+	      compression_level = 1;
+      }
+    if (compression_level < 0 || compression_level > 9)
+	compression_level = 4;
+    options->compression_level = compression_level;
+}
+
+GGRAPH_PRIVATE int
+gg_png_check_options (const gGraphPngOptionsPtr options)
+{
+/* checking the PNG compression options for validity */
+    if (options->preset != GGRAPH_PNG_PRESET_NONE
+	&& options->preset != GGRAPH_PNG_PRESET_FAST)
+	return 0;
+    if (options->filter < GGRAPH_PNG_FILTER_ADAPTIVE
+	|| options->filter > GGRAPH_PNG_FILTER_PAETH)
+	return 0;
+    if (options->strategy != 0
+	&& (options->strategy < GGRAPH_PNG_STRATEGY_DEFAULT
+	    || options->strategy > GGRAPH_PNG_STRATEGY_HUFFMAN_ONLY))
+	return 0;
+    if (options->window_bits != 0
+	&& (options->window_bits < 8 || options->window_bits > 15))
+	return 0;
+    if (options->mem_level < 0 || options->mem_level > 9)
+	return 0;
+    return 1;
+}
+
+static void
+png_apply_options (png_structp png_ptr, const gGraphPngOptionsPtr options,
+		   int single_byte)
+{
+/* 
+/ setting up the compressor accordingly to the given options
+/ ADAPTIVE filtering and DEFAULT strategy simply leave libpng's own choice
+/ single_byte: each pixel is stored as a single byte [palette, grayscale]
+*/
+    int strategy = options->strategy;
+    png_set_compression_level (png_ptr, options->compression_level);
+    if (strategy == 0)
+      {
+	  /* no strategy was forced: applying the preset's own choice */
+	  strategy = GGRAPH_PNG_STRATEGY_DEFAULT;
+	  if (single_byte && options->preset == GGRAPH_PNG_PRESET_FAST)
+	    {
+		/* flat areas are plain runs of identical bytes */
+		strategy = GGRAPH_PNG_STRATEGY_RLE;
+	    }
+      }
+    switch (options->filter)
+      {
+      case GGRAPH_PNG_FILTER_NONE:
+	  png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+	  break;
+      case GGRAPH_PNG_FILTER_SUB:
+	  png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+	  break;
+      case GGRAPH_PNG_FILTER_UP:
+	  png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_UP);
+	  break;
+      case GGRAPH_PNG_FILTER_AVERAGE:
+	  png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_AVG);
+	  break;
+      case GGRAPH_PNG_FILTER_PAETH:
+	  png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_PAETH);
+	  break;
+      };
+    switch (strategy)
+      {
+      case GGRAPH_PNG_STRATEGY_FILTERED:
+	  png_set_compression_strategy (png_ptr, Z_FILTERED);
+	  break;
+      case GGRAPH_PNG_STRATEGY_RLE:
+	  png_set_compression_strategy (png_ptr, Z_RLE);
+	  break;
+      case GGRAPH_PNG_STRATEGY_HUFFMAN_ONLY:
+	  png_set_compression_strategy (png_ptr, Z_HUFFMAN_ONLY);
+	  break;
+      };
+    if (options->window_bits > 0)
+	png_set_compression_window_bits (png_ptr, options->window_bits);
+    if (options->mem_level > 0)
+	png_set_compression_mem_level (png_ptr, options->mem_level);
+}
+
 static int
 xgdImagePngCtxPalette (gGraphImagePtr img, xgdIOCtx * outfile,
-		       int compression_level, int interlaced)
+		       const gGraphPngOptionsPtr options, int interlaced)
 {
 /* compressing a PNG image [palette] */
     int i, j, bit_depth = 0, interlace_type;
@@ -1166,7 +1276,7 @@ xgdImagePngCtxPalette (gGraphImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 1);
     if (colors <= 2)
 	bit_depth = 1;
     else if (colors <= 4)
@@ -1220,7 +1330,7 @@ xgdImagePngCtxPalette (gGraphImagePtr img, xgdIOCtx * outfile,
 
 static int
 xgdStripImagePngCtxPalette (gGraphStripImagePtr img, xgdIOCtx * outfile,
-			    int compression_level)
+			    const gGraphPngOptionsPtr options)
 {
 /* preparing to compress a PNG image [palette] (by strip) */
     int i, bit_depth = 0, interlace_type;
@@ -1258,7 +1368,7 @@ xgdStripImagePngCtxPalette (gGraphStripImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 1);
     if (colors <= 2)
 	bit_depth = 1;
     else if (colors <= 4)
@@ -1316,8 +1426,8 @@ xgdStripImagePngCtxPalette (gGraphStripImagePtr img, xgdIOCtx * outfile,
 
 static int
 xgdImagePngCtxGrayscale (gGraphImagePtr img, xgdIOCtx * outfile,
-			 int compression_level, int quantization_factor,
-			 int interlaced)
+			 const gGraphPngOptionsPtr options,
+			 int quantization_factor, int interlaced)
 {
 /* compressing a PNG image [grayscale] */
     int i, j, bit_depth = 0, interlace_type;
@@ -1349,7 +1459,7 @@ xgdImagePngCtxGrayscale (gGraphImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 1);
     bit_depth = 8;
     if (interlaced)
 	interlace_type = PNG_INTERLACE_ADAM7;
@@ -1402,7 +1512,8 @@ xgdImagePngCtxGrayscale (gGraphImagePtr img, xgdIOCtx * outfile,
 
 static int
 xgdStripImagePngCtxGrayscale (gGraphStripImagePtr img, xgdIOCtx * outfile,
-			      int compression_level, int quantization_factor)
+			      const gGraphPngOptionsPtr options,
+			      int quantization_factor)
 {
 /* preparing to compress a PNG image [grayscale] (by strip) */
     int bit_depth = 0, interlace_type;
@@ -1438,7 +1549,7 @@ xgdStripImagePngCtxGrayscale (gGraphStripImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 1);
     bit_depth = 8;
     interlace_type = PNG_INTERLACE_NONE;
     png_set_IHDR (png_ptr, info_ptr, width, height, bit_depth,
@@ -1482,7 +1593,7 @@ xgdStripImagePngCtxGrayscale (gGraphStripImagePtr img, xgdIOCtx * outfile,
 
 static int
 xgdImagePngCtxRgb (gGraphImagePtr img, xgdIOCtx * outfile,
-		   int compression_level, int quantization_factor,
+		   const gGraphPngOptionsPtr options, int quantization_factor,
 		   int interlaced)
 {
 /* compressing a PNG image [RGB] */
@@ -1520,7 +1631,7 @@ xgdImagePngCtxRgb (gGraphImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 0);
     bit_depth = 8;
     if (interlaced)
 	interlace_type = PNG_INTERLACE_ADAM7;
@@ -1605,7 +1716,8 @@ xgdImagePngCtxRgb (gGraphImagePtr img, xgdIOCtx * outfile,
 
 static int
 xgdStripImagePngCtxRgb (gGraphStripImagePtr img, xgdIOCtx * outfile,
-			int compression_level, int quantization_factor)
+			const gGraphPngOptionsPtr options,
+			int quantization_factor)
 {
 /* preparing to compress a PNG image [RGB] (by strip) */
     int bit_depth = 0, interlace_type;
@@ -1641,7 +1753,7 @@ xgdStripImagePngCtxRgb (gGraphStripImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 0);
     bit_depth = 8;
     interlace_type = PNG_INTERLACE_NONE;
     png_set_IHDR (png_ptr, info_ptr, width, height, bit_depth,
@@ -1685,8 +1797,8 @@ xgdStripImagePngCtxRgb (gGraphStripImagePtr img, xgdIOCtx * outfile,
 
 static int
 xgdImagePngCtxRgbAlpha (gGraphImagePtr img, xgdIOCtx * outfile,
-			int compression_level, int quantization_factor,
-			int interlaced)
+			const gGraphPngOptionsPtr options,
+			int quantization_factor, int interlaced)
 {
 /* compressing a PNG image [RGBA] */
     int i, j, bit_depth = 0, interlace_type;
@@ -1723,7 +1835,7 @@ xgdImagePngCtxRgbAlpha (gGraphImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 0);
     bit_depth = 8;
     if (interlaced)
 	interlace_type = PNG_INTERLACE_ADAM7;
@@ -1868,7 +1980,8 @@ xgdImagePngCtxRgbAlpha (gGraphImagePtr img, xgdIOCtx * outfile,
 
 static int
 xgdStripImagePngCtxRgbAlpha (gGraphStripImagePtr img, xgdIOCtx * outfile,
-			     int compression_level, int quantization_factor)
+			     const gGraphPngOptionsPtr options,
+			     int quantization_factor)
 {
 /* preparing to compress a PNG image [RGBA] (by strip) */
     int bit_depth = 0, interlace_type;
@@ -1904,7 +2017,7 @@ xgdStripImagePngCtxRgbAlpha (gGraphStripImagePtr img, xgdIOCtx * outfile,
 #endif
     png_set_write_fn (png_ptr, (void *) outfile, xgdPngWriteData,
 		      xgdPngFlushData);
-    png_set_compression_level (png_ptr, compression_level);
+    png_apply_options (png_ptr, options, 0);
     bit_depth = 8;
     interlace_type = PNG_INTERLACE_NONE;
     png_set_IHDR (png_ptr, info_ptr, width, height, bit_depth,
@@ -2056,7 +2169,7 @@ xgdStripImagePngCtx (gGraphStripImagePtr img)
 static int
 image_to_png_palette (const gGraphImagePtr img, void **mem_buf,
 		      int *mem_buf_size, FILE * file, int dest_type,
-		      int compression_level, int interlaced)
+		      const gGraphPngOptionsPtr options, int interlaced)
 {
 /* compressing an image as PNG PALETTE */
     int ret;
@@ -2082,9 +2195,7 @@ image_to_png_palette (const gGraphImagePtr img, void **mem_buf,
 	out = xgdNewDynamicCtx (0, file, dest_type);
     else
 	out = xgdNewDynamicCtx (2048, NULL, dest_type);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
-    ret = xgdImagePngCtxPalette (img, out, compression_level, interlaced);
+    ret = xgdImagePngCtxPalette (img, out, options, interlaced);
     if (dest_type == GG_TARGET_IS_FILE)
       {
 	  out->xgd_free (out);
@@ -2101,7 +2212,8 @@ image_to_png_palette (const gGraphImagePtr img, void **mem_buf,
 
 static int
 image_prepare_to_png_palette_by_strip (const gGraphStripImagePtr img,
-				       FILE * file, int compression_level)
+				       FILE * file,
+				       const gGraphPngOptionsPtr options)
 {
 /* preparing to compress an image as PNG PALETTE [by strip] */
     xgdIOCtx *out;
@@ -2111,16 +2223,14 @@ image_prepare_to_png_palette_by_strip (const gGraphStripImagePtr img,
 	return GGRAPH_ERROR;
 
     out = xgdNewDynamicCtx (0, file, GG_TARGET_IS_FILE);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
-    return xgdStripImagePngCtxPalette (img, out, compression_level);
+    return xgdStripImagePngCtxPalette (img, out, options);
 }
 
 static int
 image_to_png_grayscale (const gGraphImagePtr img, void **mem_buf,
 			int *mem_buf_size, FILE * file, int dest_type,
-			int compression_level, int quantization_factor,
-			int interlaced)
+			const gGraphPngOptionsPtr options,
+			int quantization_factor, int interlaced)
 {
 /* compressing an image as PNG GRAYSCALE */
     int ret;
@@ -2146,11 +2256,9 @@ image_to_png_grayscale (const gGraphImagePtr img, void **mem_buf,
 	out = xgdNewDynamicCtx (0, file, dest_type);
     else
 	out = xgdNewDynamicCtx (2048, NULL, dest_type);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
     ret =
-	xgdImagePngCtxGrayscale (img, out, compression_level,
-				 quantization_factor, interlaced);
+	xgdImagePngCtxGrayscale (img, out, options, quantization_factor,
+				 interlaced);
     if (dest_type == GG_TARGET_IS_FILE)
       {
 	  out->xgd_free (out);
@@ -2167,7 +2275,8 @@ image_to_png_grayscale (const gGraphImagePtr img, void **mem_buf,
 
 static int
 image_prepare_to_png_grayscale_by_strip (const gGraphStripImagePtr img,
-					 FILE * file, int compression_level,
+					 FILE * file,
+					 const gGraphPngOptionsPtr options,
 					 int quantization_factor)
 {
 /* preparing to compress an image as PNG GRAYSCALE [by strip] */
@@ -2178,16 +2287,15 @@ image_prepare_to_png_grayscale_by_strip (const gGraphStripImagePtr img,
 	return GGRAPH_ERROR;
 
     out = xgdNewDynamicCtx (0, file, GG_TARGET_IS_FILE);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
-    return xgdStripImagePngCtxGrayscale (img, out, compression_level,
+    return xgdStripImagePngCtxGrayscale (img, out, options,
 					 quantization_factor);
 }
 
 static int
 image_to_png_rgb (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
-		  FILE * file, int dest_type, int compression_level,
-		  int quantization_factor, int interlaced)
+		  FILE * file, int dest_type,
+		  const gGraphPngOptionsPtr options, int quantization_factor,
+		  int interlaced)
 {
 /* compressing an image as PNG RGB */
     int ret;
@@ -2213,10 +2321,8 @@ image_to_png_rgb (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
 	out = xgdNewDynamicCtx (0, file, dest_type);
     else
 	out = xgdNewDynamicCtx (2048, NULL, dest_type);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
     ret =
-	xgdImagePngCtxRgb (img, out, compression_level, quantization_factor,
+	xgdImagePngCtxRgb (img, out, options, quantization_factor,
 			   interlaced);
     if (dest_type == GG_TARGET_IS_FILE)
       {
@@ -2234,7 +2340,7 @@ image_to_png_rgb (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
 
 static int
 image_prepare_to_png_rgb_by_strip (const gGraphStripImagePtr img, FILE * file,
-				   int compression_level,
+				   const gGraphPngOptionsPtr options,
 				   int quantization_factor)
 {
 /* preparing to compress an image as PNG RGB [by strip] */
@@ -2245,16 +2351,14 @@ image_prepare_to_png_rgb_by_strip (const gGraphStripImagePtr img, FILE * file,
 	return GGRAPH_ERROR;
 
     out = xgdNewDynamicCtx (0, file, GG_TARGET_IS_FILE);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
-    return xgdStripImagePngCtxRgb (img, out, compression_level,
-				   quantization_factor);
+    return xgdStripImagePngCtxRgb (img, out, options, quantization_factor);
 }
 
 static int
 image_to_png_rgba (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
-		   FILE * file, int dest_type, int compression_level,
-		   int quantization_factor, int interlaced)
+		   FILE * file, int dest_type,
+		   const gGraphPngOptionsPtr options, int quantization_factor,
+		   int interlaced)
 {
 /* compressing an image as PNG RGBA */
     int ret;
@@ -2280,11 +2384,9 @@ image_to_png_rgba (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
 	out = xgdNewDynamicCtx (0, file, dest_type);
     else
 	out = xgdNewDynamicCtx (2048, NULL, dest_type);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
     ret =
-	xgdImagePngCtxRgbAlpha (img, out, compression_level,
-				quantization_factor, interlaced);
+	xgdImagePngCtxRgbAlpha (img, out, options, quantization_factor,
+				interlaced);
     if (dest_type == GG_TARGET_IS_FILE)
       {
 	  out->xgd_free (out);
@@ -2301,7 +2403,7 @@ image_to_png_rgba (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
 
 static int
 image_prepare_to_png_rgba_by_strip (const gGraphStripImagePtr img, FILE * file,
-				    int compression_level,
+				    const gGraphPngOptionsPtr options,
 				    int quantization_factor)
 {
 /* preparing to compress an image as PNG RGBA [by strip] */
@@ -2312,53 +2414,49 @@ image_prepare_to_png_rgba_by_strip (const gGraphStripImagePtr img, FILE * file,
 	return GGRAPH_ERROR;
 
     out = xgdNewDynamicCtx (0, file, GG_TARGET_IS_FILE);
-    if (compression_level < 0 || compression_level > 9)
-	compression_level = 4;
-    return xgdStripImagePngCtxRgbAlpha (img, out, compression_level,
+    return xgdStripImagePngCtxRgbAlpha (img, out, options,
 					quantization_factor);
 }
 
 GGRAPH_PRIVATE int
 gg_image_to_png (const gGraphImagePtr img, void **mem_buf, int *mem_buf_size,
-		 FILE * file, int dest_type, int compression_level,
-		 int quantization_factor, int interlaced, int is_transparent)
+		 FILE * file, int dest_type,
+		 const gGraphPngOptionsPtr options, int quantization_factor,
+		 int interlaced, int is_transparent)
 {
 /* dispatching PNG compression */
     if (img->pixel_format == GG_PIXEL_RGBA || img->pixel_format == GG_PIXEL_ARGB
 	|| img->pixel_format == GG_PIXEL_BGRA || is_transparent)
 	return image_to_png_rgba (img, mem_buf, mem_buf_size, file, dest_type,
-				  compression_level, quantization_factor,
-				  interlaced);
+				  options, quantization_factor, interlaced);
     if (img->pixel_format == GG_PIXEL_PALETTE)
 	return image_to_png_palette (img, mem_buf, mem_buf_size, file,
-				     dest_type, compression_level, interlaced);
+				     dest_type, options, interlaced);
     if (img->pixel_format == GG_PIXEL_GRAYSCALE)
 	return image_to_png_grayscale (img, mem_buf, mem_buf_size, file,
-				       dest_type, compression_level,
+				       dest_type, options,
 				       quantization_factor, interlaced);
     return image_to_png_rgb (img, mem_buf, mem_buf_size, file, dest_type,
-			     compression_level, quantization_factor,
-			     interlaced);
+			     options, quantization_factor, interlaced);
 }
 
 GGRAPH_PRIVATE int
 gg_image_prepare_to_png_by_strip (const gGraphStripImagePtr img,
-				  FILE * file, int compression_level,
+				  FILE * file,
+				  const gGraphPngOptionsPtr options,
 				  int quantization_factor)
 {
 /* dispatching PNG compression [by strip] */
     if (img->pixel_format == GG_PIXEL_PALETTE)
-	return image_prepare_to_png_palette_by_strip (img, file,
-						      compression_level);
+	return image_prepare_to_png_palette_by_strip (img, file, options);
     if (img->pixel_format == GG_PIXEL_GRAYSCALE)
-	return image_prepare_to_png_grayscale_by_strip (img, file,
-							compression_level,
+	return image_prepare_to_png_grayscale_by_strip (img, file, options,
 							quantization_factor);
     if (img->pixel_format == GG_PIXEL_RGBA || img->pixel_format == GG_PIXEL_ARGB
 	|| img->pixel_format == GG_PIXEL_BGRA)
-	return image_prepare_to_png_rgba_by_strip (img, file, compression_level,
+	return image_prepare_to_png_rgba_by_strip (img, file, options,
 						   quantization_factor);
-    return image_prepare_to_png_rgb_by_strip (img, file, compression_level,
+    return image_prepare_to_png_rgb_by_strip (img, file, options,
 					      quantization_factor);
 }
 
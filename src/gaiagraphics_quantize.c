@@ -54,6 +54,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 #include "gaiagraphics.h"
 #include "gaiagraphics_internals.h"
@@ -87,6 +94,19 @@
 #define MR 		HIST_G_ELEMS*HIST_B_ELEMS
 #define MG 		HIST_B_ELEMS
 
+/* the inverse colormap is filled by update boxes: 8 along each axis */
+#define UPDATE_BOX_LOG		3
+#define NUM_UPDATE_BOXES	(1 << (3 * UPDATE_BOX_LOG))
+#define UPDATE_BOX_SHIFT	(BITS_IN_SAMPLE - UPDATE_BOX_LOG)
+#define update_box_id(r, g, b) ((((r) >> UPDATE_BOX_SHIFT) << (2 * UPDATE_BOX_LOG)) \
+	+ (((g) >> UPDATE_BOX_SHIFT) << UPDATE_BOX_LOG) + ((b) >> UPDATE_BOX_SHIFT))
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION QuantizeLock;
+#else
+typedef pthread_mutex_t QuantizeLock;
+#endif
+
 typedef unsigned long ColorFreq;
 typedef ColorFreq *Histogram;
 
@@ -123,8 +143,16 @@ zero_histogram_rgb (Histogram histogram)
 }
 
 static void
-generate_histogram_rgb (Histogram histogram, gGraphImagePtr img)
+generate_histogram_rgb (Histogram histogram, unsigned char *boxes,
+			gGraphImagePtr img, int start_row, int end_row,
+			int sampling)
 {
+/*
+/ accumulating the histogram for a range of rows
+/ only one pixel every 'sampling' [both across and along rows] is counted
+/ if 'boxes' isn't NULL, every update box hit by any counted pixel
+/ will be marked
+*/
     int x;
     int y;
     int red;
@@ -133,14 +161,16 @@ generate_histogram_rgb (Histogram histogram, gGraphImagePtr img)
     unsigned char *p_in;
     ColorFreq *col;
 
-    zero_histogram_rgb (histogram);
-
-    for (y = 0; y < img->height; y++)
+    for (y = start_row; y < end_row; y++)
       {
-	  p_in = img->pixels + (y * img->scanline_width);
-	  for (x = 0; x < img->width; x++)
+	  if ((y % sampling) != 0)
+	      continue;
+	  for (x = 0; x < img->width; x += sampling)
 	    {
 		/* retrieving a pixel */
+		p_in =
+		    img->pixels + (y * img->scanline_width) +
+		    (x * img->pixel_size);
 		if (img->pixel_format == GG_PIXEL_RGB)
 		  {
 		      red = *p_in++;
@@ -187,6 +217,8 @@ generate_histogram_rgb (Histogram histogram, gGraphImagePtr img)
 		      green = img->palette_green[index];
 		      blue = img->palette_blue[index];
 		  }
+		if (boxes != NULL)
+		    boxes[update_box_id (red, green, blue)] = 1;
 		col = &histogram[(red >> R_SHIFT) * MR
 				 + (green >> G_SHIFT) * MG + (blue >> B_SHIFT)];
 		(*col)++;
@@ -571,9 +603,9 @@ select_colors_rgb (QuantizeObj * quantobj, Histogram histogram)
  */
 
 /* log2(histogram cells in update box) for each axis; this can be adjusted */
-#define BOX_R_LOG  (PRECISION_R-3)
-#define BOX_G_LOG  (PRECISION_G-3)
-#define BOX_B_LOG  (PRECISION_B-3)
+#define BOX_R_LOG  (PRECISION_R-UPDATE_BOX_LOG)
+#define BOX_G_LOG  (PRECISION_G-UPDATE_BOX_LOG)
+#define BOX_B_LOG  (PRECISION_B-UPDATE_BOX_LOG)
 
 #define BOX_R_ELEMS  (1<<BOX_R_LOG)	/* # of hist cells in update box */
 #define BOX_G_ELEMS  (1<<BOX_G_LOG)
@@ -908,16 +940,42 @@ fill_inverse_cmap_rgb (QuantizeObj * quantobj, Histogram histogram,
 static void
 median_cut_pass1_rgb (QuantizeObj * quantobj, gGraphImagePtr image)
 {
-    generate_histogram_rgb (quantobj->histogram, image);
+    zero_histogram_rgb (quantobj->histogram);
+    generate_histogram_rgb (quantobj->histogram, NULL, image, 0,
+			    image->height, 1);
     select_colors_rgb (quantobj, quantobj->histogram);
 }
 
 
+static void
+fill_inverse_cmap_locked (QuantizeObj * quantobj, Histogram histogram,
+			  int R, int G, int B, QuantizeLock * lock)
+{
+/*
+/ lazily filling an update box missed by the sampled histogram
+/ while other threads are mapping pixels
+*/
+#ifdef _WIN32
+    EnterCriticalSection (lock);
+#else
+    pthread_mutex_lock (lock);
+#endif
+    if (histogram[R * MR + G * MG + B] == 0)
+	fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+#ifdef _WIN32
+    LeaveCriticalSection (lock);
+#else
+    pthread_mutex_unlock (lock);
+#endif
+}
+
 /* Map some rows of pixels to the output colormapped representation. */
 static void
 median_cut_pass2_rgb (QuantizeObj * quantobj, gGraphImagePtr img,
-		      void *palette_pixels)
+		      void *palette_pixels, int start_row, int end_row,
+		      QuantizeLock * fill_lock)
  /* This version performs no dithering */
+ /* fill_lock is NULL unless other threads share the same cache */
 {
     Histogram histogram = quantobj->histogram;
     ColorFreq *cachep;
@@ -925,16 +983,13 @@ median_cut_pass2_rgb (QuantizeObj * quantobj, gGraphImagePtr img,
     int origR, origG, origB;
     int row, col;
     int width = img->width;
-    int height = img->height;
     unsigned char red;
     unsigned char green;
     unsigned char blue;
     unsigned char *p_in;
     unsigned char *p_out;
 
-    zero_histogram_rgb (histogram);
-
-    for (row = 0; row < height; row++)
+    for (row = start_row; row < end_row; row++)
       {
 	  p_in = img->pixels + (row * img->scanline_width);
 	  p_out = palette_pixels;
@@ -1001,7 +1056,12 @@ median_cut_pass2_rgb (QuantizeObj * quantobj, gGraphImagePtr img,
 		   colormap entry and update the cache */
 		if (*cachep == 0)
 		  {
-		      fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+		      if (fill_lock != NULL)
+			  fill_inverse_cmap_locked (quantobj, histogram, R,
+						    G, B, fill_lock);
+		      else
+			  fill_inverse_cmap_rgb (quantobj, histogram, R, G,
+						 B);
 		  }
 		/* Now emit the colormap index for this cell */
 		*p_out++ = *cachep - 1;
@@ -1009,6 +1069,101 @@ median_cut_pass2_rgb (QuantizeObj * quantobj, gGraphImagePtr img,
       }
 }
 
+/* Map all pixels applying Floyd-Steinberg error diffusion. */
+static int
+median_cut_pass2_fs_rgb (QuantizeObj * quantobj, gGraphImagePtr img,
+			 void *palette_pixels)
+{
+    gGraphPaletteCachePtr cache = NULL;
+    gGraphDitherPtr dither;
+    int row, col;
+    int i;
+    unsigned char red[MAXNUMCOLORS];
+    unsigned char green[MAXNUMCOLORS];
+    unsigned char blue[MAXNUMCOLORS];
+    unsigned char *p_in;
+    unsigned char *p_rgb;
+
+    for (i = 0; i < quantobj->max_cmap; i++)
+      {
+	  red[i] = color_get_red (quantobj->cmap[i]);
+	  green[i] = color_get_green (quantobj->cmap[i]);
+	  blue[i] = color_get_blue (quantobj->cmap[i]);
+      }
+    if (!gg_palette_cache_prepare (&cache, quantobj->max_cmap, 0, red, green,
+				   blue))
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    dither = gg_dither_create (img->width, 3);
+    if (!dither)
+      {
+	  gg_palette_cache_destroy (cache);
+	  return GGRAPH_INSUFFICIENT_MEMORY;
+      }
+
+    for (row = 0; row < img->height; row++)
+      {
+	  p_in = img->pixels + (row * img->scanline_width);
+	  p_rgb = dither->pixels;
+	  for (col = 0; col < img->width; col++)
+	    {
+		/* same channel order as median_cut_pass2_rgb */
+		if (img->pixel_format == GG_PIXEL_RGB)
+		  {
+		      *p_rgb++ = *p_in++;
+		      *p_rgb++ = *p_in++;
+		      *p_rgb++ = *p_in++;
+		  }
+		else if (img->pixel_format == GG_PIXEL_RGBA)
+		  {
+		      *p_rgb++ = *p_in++;
+		      *p_rgb++ = *p_in++;
+		      *p_rgb++ = *p_in++;
+		      p_in++;   /* skipping alpha */
+		  }
+		else if (img->pixel_format == GG_PIXEL_ARGB)
+		  {
+		      p_in++;   /* skipping alpha */
+		      *p_rgb++ = *p_in++;
+		      *p_rgb++ = *p_in++;
+		      *p_rgb++ = *p_in++;
+		  }
+		else if (img->pixel_format == GG_PIXEL_BGR)
+		  {
+		      *p_rgb++ = p_in[2];
+		      *p_rgb++ = p_in[1];
+		      *p_rgb++ = p_in[0];
+		      p_in += 3;
+		  }
+		else if (img->pixel_format == GG_PIXEL_BGRA)
+		  {
+		      *p_rgb++ = p_in[2];
+		      *p_rgb++ = p_in[1];
+		      *p_rgb++ = p_in[0];
+		      p_in += 4;
+		  }
+		else if (img->pixel_format == GG_PIXEL_GRAYSCALE)
+		  {
+		      *p_rgb++ = *p_in;
+		      *p_rgb++ = *p_in;
+		      *p_rgb++ = *p_in++;
+		  }
+		else if (img->pixel_format == GG_PIXEL_PALETTE)
+		  {
+		      int index = *p_in++;
+		      *p_rgb++ = img->palette_red[index];
+		      *p_rgb++ = img->palette_green[index];
+		      *p_rgb++ = img->palette_blue[index];
+		  }
+	    }
+	  gg_dither_rgb_row (dither,
+			     (unsigned char *) palette_pixels +
+			     (row * img->width), cache);
+      }
+    gg_dither_destroy (dither);
+    gg_palette_cache_destroy (cache);
+    return GGRAPH_OK;
+}
+
 static QuantizeObj *
 initialize_median_cut (int num_colors)
 {
@@ -1039,14 +1194,218 @@ quantize_object_free (QuantizeObj * quantobj)
     free (quantobj);
 }
 
+struct quantize_job
+{
+/* a struct wrapping a quantization job [a range of rows or boxes] */
+    QuantizeObj *quantobj;
+    gGraphImagePtr img;
+    Histogram histogram;
+    void *palette_pixels;
+    int *box_list;
+    int start;
+    int end;
+    int sampling;
+    QuantizeLock *fill_lock;
+    unsigned char boxes[NUM_UPDATE_BOXES];
+};
+
+static void
+quantize_histogram_job (void *arg)
+{
+/* threaded function: accumulating a partial histogram */
+    struct quantize_job *job = (struct quantize_job *) arg;
+    if (job->histogram != job->quantobj->histogram)
+	zero_histogram_rgb (job->histogram);
+    generate_histogram_rgb (job->histogram, job->boxes, job->img, job->start,
+			    job->end, job->sampling);
+}
+
+static void
+quantize_inverse_cmap_job (void *arg)
+{
+/* threaded function: filling a range of inverse-colormap update boxes */
+    struct quantize_job *job = (struct quantize_job *) arg;
+    int i;
+    int box;
+    int R;
+    int G;
+    int B;
+    int mask = (1 << UPDATE_BOX_LOG) - 1;
+    for (i = job->start; i < job->end; i++)
+      {
+	  box = job->box_list[i];
+	  R = ((box >> (2 * UPDATE_BOX_LOG)) & mask) << BOX_R_LOG;
+	  G = ((box >> UPDATE_BOX_LOG) & mask) << BOX_G_LOG;
+	  B = (box & mask) << BOX_B_LOG;
+	  fill_inverse_cmap_rgb (job->quantobj, job->histogram, R, G, B);
+      }
+}
+
+static void
+quantize_map_job (void *arg)
+{
+/* threaded function: mapping a range of rows into colormap indexes */
+    struct quantize_job *job = (struct quantize_job *) arg;
+    median_cut_pass2_rgb (job->quantobj, job->img, job->palette_pixels,
+			  job->start, job->end, job->fill_lock);
+}
+
+static void
+quantize_split_jobs (struct quantize_job *jobs, int num_jobs, int count)
+{
+/* evenly splitting 'count' items between jobs */
+    int i;
+    int step;
+    if (num_jobs <= 0)
+	return;
+    step = count / num_jobs;
+    for (i = 0; i < num_jobs; i++)
+      {
+	  jobs[i].start = i * step;
+	  jobs[i].end = (i == num_jobs - 1) ? count : (i + 1) * step;
+      }
+}
+
+static void
+quantize_by_threads (QuantizeObj * quantobj, gGraphImagePtr img,
+		     void *palette_pixels, int sampling,
+		     gGraphThreadPoolPtr pool, int num_threads)
+{
+/*
+/ multithreaded median cut
+/ - pass 1: each job accumulates its own histogram [may be, by sampling],
+/   then all partial histograms are merged together
+/ - any update box hit by some counted pixel is filled in advance
+/ - pass 2: rows are mapped in parallel, simply reading the inverse
+/   colormap; when sampling, any box missed by the counted pixels is
+/   filled on demand, holding a lock
+*/
+    struct quantize_job jobs[GG_MAX_THREADS];
+    QuantizeLock fill_lock;
+    int box_list[NUM_UPDATE_BOXES];
+    int num_jobs;
+    int num_boxes;
+    int i;
+    int j;
+    int cells = HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS;
+    Histogram histogram = quantobj->histogram;
+
+    if (pool != NULL)
+	num_threads = gg_thread_pool_size (pool);
+    if (num_threads > GG_MAX_THREADS)
+	num_threads = GG_MAX_THREADS;
+    if (num_threads < 1)
+	num_threads = 1;
+    if (sampling < 1)
+	sampling = 1;
+
+/* pass 1: partial histograms */
+    num_jobs = num_threads;
+    if (num_jobs > img->height)
+	num_jobs = img->height;
+    zero_histogram_rgb (histogram);
+    for (i = 0; i < num_jobs; i++)
+      {
+	  jobs[i].quantobj = quantobj;
+	  jobs[i].img = img;
+	  jobs[i].palette_pixels = palette_pixels;
+	  jobs[i].box_list = box_list;
+	  jobs[i].sampling = sampling;
+	  memset (jobs[i].boxes, 0, NUM_UPDATE_BOXES);
+	  if (i == 0)
+	      jobs[i].histogram = histogram;
+	  else
+	    {
+		jobs[i].histogram = malloc (sizeof (ColorFreq) * cells);
+		if (jobs[i].histogram == NULL)
+		    break;
+	    }
+      }
+    num_jobs = i;
+    quantize_split_jobs (jobs, num_jobs, img->height);
+    gg_thread_pool_run (pool, num_threads, quantize_histogram_job, jobs,
+			sizeof (struct quantize_job), num_jobs);
+    for (i = 1; i < num_jobs; i++)
+      {
+	  /* merging the partial histograms */
+	  for (j = 0; j < cells; j++)
+	      histogram[j] += jobs[i].histogram[j];
+	  for (j = 0; j < NUM_UPDATE_BOXES; j++)
+	      jobs[0].boxes[j] |= jobs[i].boxes[j];
+	  free (jobs[i].histogram);
+	  jobs[i].histogram = histogram;
+      }
+    select_colors_rgb (quantobj, histogram);
+
+/* filling the inverse colormap */
+    zero_histogram_rgb (histogram);
+    num_boxes = 0;
+    for (j = 0; j < NUM_UPDATE_BOXES; j++)
+      {
+	  if (jobs[0].boxes[j])
+	      box_list[num_boxes++] = j;
+      }
+    num_jobs = num_threads;
+    if (num_jobs > num_boxes)
+	num_jobs = num_boxes;
+    for (i = 0; i < num_jobs; i++)
+      {
+	  jobs[i].quantobj = quantobj;
+	  jobs[i].img = img;
+	  jobs[i].histogram = histogram;
+	  jobs[i].palette_pixels = palette_pixels;
+	  jobs[i].box_list = box_list;
+      }
+    quantize_split_jobs (jobs, num_jobs, num_boxes);
+    gg_thread_pool_run (pool, num_threads, quantize_inverse_cmap_job, jobs,
+			sizeof (struct quantize_job), num_jobs);
+
+/* pass 2: mapping pixels */
+    num_jobs = num_threads;
+    if (num_jobs > img->height)
+	num_jobs = img->height;
+    for (i = 0; i < num_jobs; i++)
+      {
+	  jobs[i].quantobj = quantobj;
+	  jobs[i].img = img;
+	  jobs[i].histogram = histogram;
+	  jobs[i].palette_pixels = palette_pixels;
+      }
+#ifdef _WIN32
+    InitializeCriticalSection (&fill_lock);
+#else
+    pthread_mutex_init (&fill_lock, NULL);
+#endif
+    for (i = 0; i < num_jobs; i++)
+	jobs[i].fill_lock = (sampling > 1) ? &fill_lock : NULL;
+    quantize_split_jobs (jobs, num_jobs, img->height);
+    gg_thread_pool_run (pool, num_threads, quantize_map_job, jobs,
+			sizeof (struct quantize_job), num_jobs);
+#ifdef _WIN32
+    DeleteCriticalSection (&fill_lock);
+#else
+    pthread_mutex_destroy (&fill_lock);
+#endif
+}
+
 GGRAPH_PRIVATE int
-gg_image_resample_as_palette (const gGraphImagePtr img, int num_colors)
+gg_image_resample_as_palette (const gGraphImagePtr img, int num_colors,
+			      int sampling, gGraphThreadPoolPtr pool,
+			      int num_threads, int dither)
 {
-/* applies quantization to the current image, so to get 256/16/4 colors */
+/*
+/ applies quantization to the current image, so to get 256/16/4 colors
+/ when a Thread Pool or more than a single thread are available, or
+/ when the histogram has to be sampled, the multithreaded median cut
+/ will be used
+/ when dithering is required pixels are mapped by Floyd-Steinberg
+/ error diffusion, which is inherently sequential
+*/
     QuantizeObj *quantobj;
     void *palette_pixels;
     int i;
     int safe_num_colors;
+    int ret;
 
     if (num_colors > 16)
 	safe_num_colors = 256;	/* 8 bits_per_sample */
@@ -1073,12 +1432,35 @@ gg_image_resample_as_palette (const gGraphImagePtr img, int num_colors)
 
     quantobj = initialize_median_cut (safe_num_colors);
     if (!quantobj)
-	return GGRAPH_INSUFFICIENT_MEMORY;
+      {
+	  free (palette_pixels);
+	  return GGRAPH_INSUFFICIENT_MEMORY;
+      }
 
-    median_cut_pass1_rgb (quantobj, img);
-    median_cut_pass2_rgb (quantobj, img, palette_pixels);
+    if (dither)
+      {
+	  median_cut_pass1_rgb (quantobj, img);
+	  ret = median_cut_pass2_fs_rgb (quantobj, img, palette_pixels);
+	  if (ret != GGRAPH_OK)
+	    {
+		quantize_object_free (quantobj);
+		free (palette_pixels);
+		return ret;
+	    }
+      }
+    else if (pool != NULL || num_threads > 1 || sampling > 1)
+	quantize_by_threads (quantobj, img, palette_pixels, sampling, pool,
+			     num_threads);
+    else
+      {
+	  median_cut_pass1_rgb (quantobj, img);
+	  zero_histogram_rgb (quantobj->histogram);
+	  median_cut_pass2_rgb (quantobj, img, palette_pixels, 0, img->height,
+				NULL);
+      }
 
 /* setting up the palette */
+    img->palette_version++;
     for (i = 0; i < quantobj->max_cmap; i++)
       {
 	  img->palette_red[i] = color_get_red (quantobj->cmap[i]);
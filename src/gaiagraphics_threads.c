@@ -0,0 +1,406 @@
+/* 
+/ gaiagraphics_threads.c
+/
+/ reusable worker threads pool
+/
+/ version 1.0, 2026 October 17
+/
+/ Author: Sandro Furieri a.furieri@lqt.it
+/
+/ Copyright (C) 2010  Alessandro Furieri
+/
+/    This program is free software: you can redistribute it and/or modify
+/    it under the terms of the GNU Lesser General Public License as published by
+/    the Free Software Foundation, either version 3 of the License, or
+/    (at your option) any later version.
+/
+/    This program is distributed in the hope that it will be useful,
+/    but WITHOUT ANY WARRANTY; without even the implied warranty of
+/    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/    GNU Lesser General Public License for more details.
+/
+/    You should have received a copy of the GNU Lesser General Public License
+/    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "gaiagraphics.h"
+#include "gaiagraphics_internals.h"
+
+struct gaia_graphics_thread_pool
+{
+/* a pool of reusable worker threads */
+    int signature;
+    int num_threads;
+    int num_workers;
+#ifdef _WIN32
+    HANDLE *workers;
+    CRITICAL_SECTION lock;
+    CRITICAL_SECTION dispatch;
+    CONDITION_VARIABLE work_ready;
+    CONDITION_VARIABLE work_done;
+#else
+    pthread_t *workers;
+    pthread_mutex_t lock;
+    pthread_mutex_t dispatch;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+#endif
+    void (*job) (void *);
+    unsigned char *args;
+    int arg_size;
+    int num_jobs;
+    int next_job;
+    int pending_jobs;
+    int shutdown;
+};
+
+static void
+pool_lock (gGraphThreadPoolPtr pool)
+{
+#ifdef _WIN32
+    EnterCriticalSection (&(pool->lock));
+#else
+    pthread_mutex_lock (&(pool->lock));
+#endif
+}
+
+static void
+pool_unlock (gGraphThreadPoolPtr pool)
+{
+#ifdef _WIN32
+    LeaveCriticalSection (&(pool->lock));
+#else
+    pthread_mutex_unlock (&(pool->lock));
+#endif
+}
+
+static int
+pool_run_next_job (gGraphThreadPoolPtr pool)
+{
+/*
+/ executing the next pending job (if any)
+/ must be called while holding the pool lock
+*/
+    void (*job) (void *);
+    void *arg;
+    if (pool->next_job >= pool->num_jobs)
+	return 0;
+    job = pool->job;
+    arg = pool->args + (pool->next_job * pool->arg_size);
+    pool->next_job += 1;
+    pool_unlock (pool);
+    job (arg);
+    pool_lock (pool);
+    pool->pending_jobs -= 1;
+    if (pool->pending_jobs == 0)
+      {
+#ifdef _WIN32
+	  WakeAllConditionVariable (&(pool->work_done));
+#else
+	  pthread_cond_broadcast (&(pool->work_done));
+#endif
+      }
+    return 1;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+#else
+static void *
+#endif
+pool_worker (void *arg)
+{
+/* threaded function: the worker's main loop */
+    gGraphThreadPoolPtr pool = (gGraphThreadPoolPtr) arg;
+    pool_lock (pool);
+    while (1)
+      {
+	  if (pool->shutdown)
+	      break;
+	  if (pool_run_next_job (pool))
+	      continue;
+	  /* waiting for some further work to be dispatched */
+#ifdef _WIN32
+	  SleepConditionVariableCS (&(pool->work_ready), &(pool->lock),
+				    INFINITE);
+#else
+	  pthread_cond_wait (&(pool->work_ready), &(pool->lock));
+#endif
+      }
+    pool_unlock (pool);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+GGRAPH_PRIVATE gGraphThreadPoolPtr
+gg_thread_pool_create (int num_threads)
+{
+/*
+/ allocating a Thread Pool
+/ the calling thread always takes part to the work, so
+/ only (num_threads - 1) worker threads are actually started
+*/
+    int i;
+    gGraphThreadPoolPtr pool;
+
+    if (num_threads > GG_MAX_THREADS)
+	num_threads = GG_MAX_THREADS;
+    if (num_threads < 1)
+	num_threads = 1;
+
+    pool = malloc (sizeof (gGraphThreadPool));
+    if (!pool)
+	return NULL;
+    pool->signature = GG_THREAD_POOL_MAGIC_SIGNATURE;
+    pool->num_threads = num_threads;
+    pool->num_workers = 0;
+    pool->job = NULL;
+    pool->args = NULL;
+    pool->arg_size = 0;
+    pool->num_jobs = 0;
+    pool->next_job = 0;
+    pool->pending_jobs = 0;
+    pool->shutdown = 0;
+    pool->workers = NULL;
+#ifdef _WIN32
+    InitializeCriticalSection (&(pool->lock));
+    InitializeCriticalSection (&(pool->dispatch));
+    InitializeConditionVariable (&(pool->work_ready));
+    InitializeConditionVariable (&(pool->work_done));
+#else
+    pthread_mutex_init (&(pool->lock), NULL);
+    pthread_mutex_init (&(pool->dispatch), NULL);
+    pthread_cond_init (&(pool->work_ready), NULL);
+    pthread_cond_init (&(pool->work_done), NULL);
+#endif
+    if (num_threads < 2)
+	return pool;
+
+    pool->workers = malloc (sizeof (*(pool->workers)) * (num_threads - 1));
+    if (!pool->workers)
+	goto error;
+    for (i = 0; i < num_threads - 1; i++)
+      {
+#ifdef _WIN32
+	  DWORD thread_id;
+	  pool->workers[i] =
+	      CreateThread (NULL, 0, pool_worker, pool, 0, &thread_id);
+	  if (pool->workers[i] == NULL)
+	      goto error;
+#else
+	  if (pthread_create (&(pool->workers[i]), NULL, pool_worker, pool) !=
+	      0)
+	      goto error;
+#endif
+	  pool->num_workers += 1;
+      }
+    return pool;
+
+  error:
+    gg_thread_pool_destroy (pool);
+    return NULL;
+}
+
+GGRAPH_PRIVATE void
+gg_thread_pool_destroy (gGraphThreadPoolPtr pool)
+{
+/* destroying a Thread Pool */
+    int i;
+    if (!pool)
+	return;
+    pool_lock (pool);
+    pool->shutdown = 1;
+#ifdef _WIN32
+    WakeAllConditionVariable (&(pool->work_ready));
+#else
+    pthread_cond_broadcast (&(pool->work_ready));
+#endif
+    pool_unlock (pool);
+    for (i = 0; i < pool->num_workers; i++)
+      {
+	  /* waiting until any worker thread terminates */
+#ifdef _WIN32
+	  WaitForSingleObject (pool->workers[i], INFINITE);
+	  CloseHandle (pool->workers[i]);
+#else
+	  pthread_join (pool->workers[i], NULL);
+#endif
+      }
+    if (pool->workers)
+	free (pool->workers);
+#ifdef _WIN32
+    DeleteCriticalSection (&(pool->lock));
+    DeleteCriticalSection (&(pool->dispatch));
+#else
+    pthread_mutex_destroy (&(pool->lock));
+    pthread_mutex_destroy (&(pool->dispatch));
+    pthread_cond_destroy (&(pool->work_ready));
+    pthread_cond_destroy (&(pool->work_done));
+#endif
+    free (pool);
+}
+
+GGRAPH_PRIVATE int
+gg_thread_pool_size (gGraphThreadPoolPtr pool)
+{
+/* returning how many threads are supported by a Thread Pool */
+    if (!pool)
+	return 1;
+    return pool->num_threads;
+}
+
+static void
+pool_dispatch (gGraphThreadPoolPtr pool, void (*job) (void *), void *args,
+	       int arg_size, int num_jobs)
+{
+/* dispatching a whole batch of jobs, then waiting for completion */
+#ifdef _WIN32
+    EnterCriticalSection (&(pool->dispatch));
+#else
+    pthread_mutex_lock (&(pool->dispatch));
+#endif
+    pool_lock (pool);
+    pool->job = job;
+    pool->args = args;
+    pool->arg_size = arg_size;
+    pool->num_jobs = num_jobs;
+    pool->next_job = 0;
+    pool->pending_jobs = num_jobs;
+#ifdef _WIN32
+    WakeAllConditionVariable (&(pool->work_ready));
+#else
+    pthread_cond_broadcast (&(pool->work_ready));
+#endif
+    while (pool_run_next_job (pool))
+	;
+    while (pool->pending_jobs > 0)
+      {
+	  /* waiting until any outstanding job terminates */
+#ifdef _WIN32
+	  SleepConditionVariableCS (&(pool->work_done), &(pool->lock),
+				    INFINITE);
+#else
+	  pthread_cond_wait (&(pool->work_done), &(pool->lock));
+#endif
+      }
+    pool->job = NULL;
+    pool->args = NULL;
+    pool->num_jobs = 0;
+    pool->next_job = 0;
+    pool_unlock (pool);
+#ifdef _WIN32
+    LeaveCriticalSection (&(pool->dispatch));
+#else
+    pthread_mutex_unlock (&(pool->dispatch));
+#endif
+}
+
+GGRAPH_PRIVATE void
+gg_thread_pool_run (gGraphThreadPoolPtr pool, int num_threads,
+		    void (*job) (void *), void *args, int arg_size,
+		    int num_jobs)
+{
+/*
+/ executing an array of jobs (may be, in a multithreaded way)
+/
+/ - if a Thread Pool is available all jobs will be dispatched to it
+/ - otherwise a transient Thread Pool supporting num_threads will be used
+/
+/ a job must never dispatch further work to the same Thread Pool
+*/
+    int i;
+    gGraphThreadPoolPtr transient;
+    unsigned char *p = args;
+
+    if (num_jobs <= 0)
+	return;
+    if (pool != NULL)
+      {
+	  if (pool->num_workers > 0 && num_jobs > 1)
+	    {
+		pool_dispatch (pool, job, args, arg_size, num_jobs);
+		return;
+	    }
+	  num_threads = 1;
+      }
+    if (num_threads > num_jobs)
+	num_threads = num_jobs;
+    if (num_threads > 1)
+      {
+	  transient = gg_thread_pool_create (num_threads);
+	  if (transient != NULL)
+	    {
+		pool_dispatch (transient, job, args, arg_size, num_jobs);
+		gg_thread_pool_destroy (transient);
+		return;
+	    }
+      }
+/* not using multithreading */
+    for (i = 0; i < num_jobs; i++)
+	job (p + (i * arg_size));
+}
+
+GGRAPH_PRIVATE int
+gg_is_valid_thread_pool (const void *ptr)
+{
+/* checking for a valid Thread Pool object */
+    gGraphThreadPoolPtr pool = (gGraphThreadPoolPtr) ptr;
+    if (pool == NULL)
+	return 0;
+    if (pool->signature != GG_THREAD_POOL_MAGIC_SIGNATURE)
+	return 0;
+    return 1;
+}
+
+GGRAPH_DECLARE int
+gGraphCreateThreadPool (int num_threads, const void **thread_pool)
+{
+/* creating a Thread Pool object */
+    gGraphThreadPoolPtr pool;
+
+    *thread_pool = NULL;
+    pool = gg_thread_pool_create (num_threads);
+    if (!pool)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    *thread_pool = pool;
+    return GGRAPH_OK;
+}
+
+GGRAPH_DECLARE void
+gGraphDestroyThreadPool (const void *thread_pool)
+{
+/* destroying a Thread Pool object */
+    gGraphThreadPoolPtr pool = (gGraphThreadPoolPtr) thread_pool;
+
+    if (!gg_is_valid_thread_pool (pool))
+	return;
+    gg_thread_pool_destroy (pool);
+}
+
+GGRAPH_DECLARE int
+gGraphGetThreadPoolSize (const void *thread_pool, int *num_threads)
+{
+/* returning how many threads are supported by a Thread Pool object */
+    gGraphThreadPoolPtr pool = (gGraphThreadPoolPtr) thread_pool;
+
+    *num_threads = 0;
+    if (!gg_is_valid_thread_pool (pool))
+	return GGRAPH_INVALID_THREAD_POOL;
+    *num_threads = gg_thread_pool_size (pool);
+    return GGRAPH_OK;
+}
@@ -30,6 +30,8 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include <zlib.h>
+
 /*
 / the following patch supporting GeoTiff headers
 / was kindly contributed by Brad Hards: 2011-09-02
@@ -66,6 +68,74 @@
 #define TIFF_TYPE_RGB			4
 #define TIFF_TYPE_GRID			5
 
+#define TIFF_LZW_CLEAR		256
+#define TIFF_LZW_EOI		257
+#define TIFF_LZW_FIRST		258
+#define TIFF_LZW_FULL		4094
+#define TIFF_LZW_HASH_SIZE	8192
+
+struct tiff_overview
+{
+/* a struct used to build a single Overview level */
+    int width;
+    int height;
+    int scanline_width;
+    int in_width;
+    int in_scanline_width;
+    int rows_out;
+    int has_pending;
+    unsigned char *pending;	/* the first row of the current pair */
+    unsigned char *row;		/* the latest reduced row */
+    FILE *tmp;			/* temporary storage for reduced rows */
+};
+
+struct tiff_overviews
+{
+/* a struct used to build TIFF Overviews [reduced-resolution IFDs] */
+    int num_levels;
+    int tiff_type;
+    int pixel_unit;
+    int sample_format;
+    int bits_per_sample;
+    double no_data_value;
+    struct tiff_overview levels[GG_TIFF_MAX_OVERVIEWS];
+};
+
+struct tiff_compress_job
+{
+/* a single strip or tile to be compressed */
+    uint16 compression;
+    unsigned char *raw;
+    size_t raw_size;
+    unsigned char *compressed;
+    size_t compressed_max;
+    size_t compressed_size;
+    int *lzw_keys;		/* LZW hash table, reused by each call */
+    unsigned short *lzw_codes;
+    z_stream *zstream;		/* DEFLATE stream, reused by each call */
+};
+
+struct tiff_parallel
+{
+/*
+/ a struct used to compress many strips or tiles at once [multithreaded]
+/ then writing them in order as raw data
+*/
+    gGraphThreadPoolPtr pool;
+    int own_pool;
+    int num_threads;
+    uint16 compression;		/* zero: plain libtiff encoding */
+    int height;
+    uint32 rows_per_strip;
+    tsize_t scanline_size;
+    tsize_t block_size;		/* a full uncompressed strip or tile */
+    int max_blocks;
+    int num_blocks;		/* how many strips or tiles are staged */
+    uint32 first_block;		/* the index of the first staged one */
+    unsigned char *staging;
+    struct tiff_compress_job *jobs;
+};
+
 struct tiff_codec_data
 {
 /* a struct used by TIFF codec */
@@ -75,7 +145,10 @@ struct tiff_codec_data
     GTIF *geotiff_handle;
     void *tiff_buffer;
     int is_tiled;
+    int is_native;
     int tiff_type;
+    struct tiff_overviews *overviews;
+    struct tiff_parallel *parallel;
 };
 
 struct memfile
@@ -201,6 +274,330 @@ unmapproc (thandle_t clientdata, tdata_t data, toff_t offset)
     return;
 }
 
+struct tiff_layout
+{
+/* a struct describing the layout of the current TIFF directory */
+    uint32 width;
+    uint32 height;
+    int is_tiled;
+    uint32 tile_width;
+    uint32 tile_height;
+    uint32 rows_strip;
+    uint16 bits_per_sample;
+    uint16 samples_per_pixel;
+    uint16 photometric;
+    uint16 compression;
+    int type;
+    int gg_sample_format;
+    int is_native;
+};
+
+static int
+tiff_is_native (TIFF * in, int type, uint16 bits_per_sample,
+		uint16 photometric)
+{
+/*
+/ checking if the current TIFF directory can be decoded in its native
+/ format [8 bit RGB, GRAYSCALE or PALETTE, top-down oriented], so that
+/ samples and palette indices are simply copied as they are
+*/
+    uint16 orientation;
+    uint16 *red;
+    uint16 *green;
+    uint16 *blue;
+
+    if (bits_per_sample != 8)
+	return 0;
+    if (TIFFGetFieldDefaulted (in, TIFFTAG_ORIENTATION, &orientation) == 0)
+	orientation = ORIENTATION_TOPLEFT;
+    if (orientation != ORIENTATION_TOPLEFT)
+	return 0;
+    switch (type)
+      {
+      case GG_PIXEL_RGB:
+	  if (photometric == PHOTOMETRIC_RGB)
+	      return 1;
+	  break;
+      case GG_PIXEL_GRAYSCALE:
+	  if (photometric == PHOTOMETRIC_MINISBLACK)
+	      return 1;
+	  break;
+      case GG_PIXEL_PALETTE:
+	  if (photometric == PHOTOMETRIC_PALETTE
+	      && TIFFGetField (in, TIFFTAG_COLORMAP, &red, &green, &blue))
+	      return 1;
+	  break;
+      };
+    return 0;
+}
+
+static void
+tiff_get_layout (TIFF * in, struct tiff_layout *layout)
+{
+/* retrieving the layout of the current TIFF directory */
+    uint16 planar_config;
+    uint16 sample_format;
+
+    layout->width = 0;
+    layout->height = 0;
+    layout->tile_width = 0;
+    layout->tile_height = 0;
+    layout->rows_strip = 0;
+    layout->photometric = PHOTOMETRIC_MINISBLACK;
+    layout->compression = COMPRESSION_NONE;
+    layout->is_tiled = TIFFIsTiled (in);
+    TIFFGetField (in, TIFFTAG_IMAGELENGTH, &(layout->height));
+    TIFFGetField (in, TIFFTAG_IMAGEWIDTH, &(layout->width));
+    if (layout->is_tiled)
+      {
+	  TIFFGetField (in, TIFFTAG_TILEWIDTH, &(layout->tile_width));
+	  TIFFGetField (in, TIFFTAG_TILELENGTH, &(layout->tile_height));
+      }
+    else
+      {
+	  if (TIFFGetField (in, TIFFTAG_ROWSPERSTRIP, &(layout->rows_strip)) ==
+	      0 || layout->rows_strip > layout->height)
+	      layout->rows_strip = layout->height;
+      }
+    if (TIFFGetField (in, TIFFTAG_BITSPERSAMPLE, &(layout->bits_per_sample))
+	== 0)
+	layout->bits_per_sample = 1;
+    if (TIFFGetField (in, TIFFTAG_SAMPLESPERPIXEL, &(layout->samples_per_pixel))
+	== 0)
+      {
+	  /* attempting to recover badly formatted TIFFs */
+	  layout->samples_per_pixel = 1;
+      }
+    TIFFGetField (in, TIFFTAG_PHOTOMETRIC, &(layout->photometric));
+    TIFFGetField (in, TIFFTAG_COMPRESSION, &(layout->compression));
+    if (TIFFGetField (in, TIFFTAG_PLANARCONFIG, &planar_config) == 0)
+      {
+	  /* attempting to recover badly formatted TIFFs */
+	  planar_config = PLANARCONFIG_CONTIG;
+      }
+    if (TIFFGetField (in, TIFFTAG_SAMPLEFORMAT, &sample_format) == 0)
+	sample_format = SAMPLEFORMAT_UINT;
+    if (planar_config == PLANARCONFIG_CONTIG)
+      {
+	  if (sample_format == SAMPLEFORMAT_UINT)
+	    {
+		if (layout->bits_per_sample == 1
+		    && layout->samples_per_pixel == 1)
+		    layout->type = GG_PIXEL_PALETTE;
+		else if (layout->bits_per_sample == 8
+			 && layout->samples_per_pixel == 1
+			 && layout->photometric == 3)
+		    layout->type = GG_PIXEL_PALETTE;
+		else if (layout->bits_per_sample == 8
+			 && layout->samples_per_pixel == 1
+			 && layout->photometric < 2)
+		    layout->type = GG_PIXEL_GRAYSCALE;
+		else if (layout->bits_per_sample == 8
+			 && layout->samples_per_pixel == 3)
+		    layout->type = GG_PIXEL_RGB;
+		else
+		    layout->type = GG_PIXEL_UNKNOWN;
+	    }
+	  else if (layout->samples_per_pixel == 1)
+	      layout->type = GG_PIXEL_GRID;
+	  else
+	      layout->type = GG_PIXEL_UNKNOWN;
+      }
+    else
+	layout->type = GG_PIXEL_UNKNOWN;
+    switch (sample_format)
+      {
+      case SAMPLEFORMAT_UINT:
+	  layout->gg_sample_format = GGRAPH_SAMPLE_UINT;
+	  break;
+      case SAMPLEFORMAT_INT:
+	  layout->gg_sample_format = GGRAPH_SAMPLE_INT;
+	  break;
+      case SAMPLEFORMAT_IEEEFP:
+	  layout->gg_sample_format = GGRAPH_SAMPLE_FLOAT;
+	  break;
+      default:
+	  layout->gg_sample_format = GGRAPH_SAMPLE_UNKNOWN;
+	  break;
+      };
+    if (layout->type == GG_PIXEL_GRID)
+      {
+	  /* only 8, 16, 32 and 64 bit samples are supported */
+	  if (layout->bits_per_sample == 8 || layout->bits_per_sample == 16
+	      || layout->bits_per_sample == 32)
+	      ;
+	  else if (layout->bits_per_sample == 64
+		   && layout->gg_sample_format == GGRAPH_SAMPLE_FLOAT)
+	      ;
+	  else
+	      layout->type = GG_PIXEL_UNKNOWN;
+      }
+    if (layout->is_tiled
+	&& (layout->tile_width == 0 || layout->tile_height == 0))
+	layout->type = GG_PIXEL_UNKNOWN;
+    if (!layout->is_tiled && layout->rows_strip == 0)
+	layout->type = GG_PIXEL_UNKNOWN;
+    layout->is_native =
+	tiff_is_native (in, layout->type, layout->bits_per_sample,
+			layout->photometric);
+}
+
+static int
+tiff_compression_from_layout (const struct tiff_layout *layout)
+{
+/* mapping the TIFF compression into the corresponding GGRAPH constant */
+    switch (layout->compression)
+      {
+      case COMPRESSION_NONE:
+	  return GGRAPH_TIFF_COMPRESSION_NONE;
+      case COMPRESSION_LZW:
+	  return GGRAPH_TIFF_COMPRESSION_LZW;
+      case COMPRESSION_DEFLATE:
+	  return GGRAPH_TIFF_COMPRESSION_DEFLATE;
+      case COMPRESSION_JPEG:
+	  return GGRAPH_TIFF_COMPRESSION_JPEG;
+      case COMPRESSION_CCITTFAX3:
+	  return GGRAPH_TIFF_COMPRESSION_CCITTFAX3;
+      case COMPRESSION_CCITTFAX4:
+	  return GGRAPH_TIFF_COMPRESSION_CCITTFAX4;
+      };
+    return GGRAPH_TIFF_COMPRESSION_UNKNOWN;
+}
+
+struct tiff_overview_ifd
+{
+/* a struct identifying a reduced-resolution TIFF directory */
+    int found;
+    int is_subifd;
+    tdir_t dir;
+    toff_t offset;
+    uint32 width;
+    uint32 height;
+    uint32 main_width;
+    uint32 main_height;
+};
+
+static void
+tiff_check_overview (TIFF * in, const struct tiff_layout *main_layout,
+		     uint32 min_width, uint32 min_height, int is_subifd,
+		     tdir_t dir, toff_t offset, struct tiff_overview_ifd *ovr)
+{
+/* checking if the current TIFF directory is a better Overview */
+    struct tiff_layout layout;
+    uint32 subfile_type = 0;
+
+    TIFFGetField (in, TIFFTAG_SUBFILETYPE, &subfile_type);
+    if (!(subfile_type & FILETYPE_REDUCEDIMAGE))
+	return;
+    tiff_get_layout (in, &layout);
+    if (layout.type != main_layout->type
+	|| layout.bits_per_sample != main_layout->bits_per_sample
+	|| layout.samples_per_pixel != main_layout->samples_per_pixel
+	|| layout.gg_sample_format != main_layout->gg_sample_format)
+	return;
+    if (layout.width >= main_layout->width
+	|| layout.height >= main_layout->height)
+	return;
+    if (layout.width < min_width || layout.height < min_height)
+	return;
+    if (ovr->found && layout.width >= ovr->width)
+	return;
+    ovr->found = 1;
+    ovr->is_subifd = is_subifd;
+    ovr->dir = dir;
+    ovr->offset = offset;
+    ovr->width = layout.width;
+    ovr->height = layout.height;
+}
+
+static void
+tiff_find_overview (TIFF * in, int scale, struct tiff_overview_ifd *ovr)
+{
+/*
+/ searching the smallest Overview still covering a 1:scale reduction
+/ both SubIFDs of the main IFD and further top-level IFDs are
+/ checked; the TIFF is always positioned back on the main IFD
+*/
+    struct tiff_layout main_layout;
+    uint32 min_width;
+    uint32 min_height;
+    tdir_t dir;
+    tdir_t num_dirs;
+    uint16 num_subifds = 0;
+    toff_t *p_offsets;
+    toff_t *offsets = NULL;
+    int i;
+
+    ovr->found = 0;
+    ovr->main_width = 0;
+    ovr->main_height = 0;
+    if (!TIFFSetDirectory (in, 0))
+	return;
+    tiff_get_layout (in, &main_layout);
+    ovr->main_width = main_layout.width;
+    ovr->main_height = main_layout.height;
+    if (scale <= 1 || main_layout.type == GG_PIXEL_UNKNOWN)
+	return;
+    min_width = main_layout.width / scale;
+    min_height = main_layout.height / scale;
+
+    if (TIFFGetField (in, TIFFTAG_SUBIFD, &num_subifds, &p_offsets)
+	&& num_subifds > 0)
+      {
+	  /* the offsets will be invalidated by changing directory */
+	  offsets = malloc (sizeof (toff_t) * num_subifds);
+	  if (offsets)
+	      memcpy (offsets, p_offsets, sizeof (toff_t) * num_subifds);
+      }
+    if (offsets)
+      {
+	  for (i = 0; i < num_subifds; i++)
+	    {
+		if (!TIFFSetSubDirectory (in, offsets[i]))
+		    continue;
+		tiff_check_overview (in, &main_layout, min_width, min_height,
+				     1, 0, offsets[i], ovr);
+	    }
+	  free (offsets);
+	  TIFFSetDirectory (in, 0);
+      }
+
+    num_dirs = TIFFNumberOfDirectories (in);
+    for (dir = 1; dir < num_dirs; dir++)
+      {
+	  if (!TIFFSetDirectory (in, dir))
+	      break;
+	  tiff_check_overview (in, &main_layout, min_width, min_height, 0,
+			       dir, 0, ovr);
+      }
+    TIFFSetDirectory (in, 0);
+}
+
+static int
+tiff_goto_overview (TIFF * in, const struct tiff_overview_ifd *ovr)
+{
+/* positioning the TIFF on some Overview */
+    if (!ovr->found)
+	return 1;
+    if (ovr->is_subifd)
+	return TIFFSetSubDirectory (in, ovr->offset);
+    return TIFFSetDirectory (in, ovr->dir);
+}
+
+static int
+tiff_has_overview (TIFF * in, int scale)
+{
+/* checking if an Overview supports a cheap 1:scale reduction */
+    struct tiff_overview_ifd ovr;
+    tiff_find_overview (in, scale, &ovr);
+    if (!ovr.found)
+	return 0;
+    if (ovr.width > (ovr.main_width + scale - 1) / scale
+	|| ovr.height > (ovr.main_height + scale - 1) / scale)
+	return 0;
+    return 1;
+}
+
 GGRAPH_PRIVATE int
 gg_image_infos_from_mem_tiff (int size, const void *data,
 			      gGraphImageInfosPtr * infos_handle)
@@ -396,6 +793,10 @@ gg_image_infos_from_mem_tiff (int size, const void *data,
 	  infos->palette_blue[i] = blue[i];
       }
     infos->max_palette = max_palette;
+/* checking for Overviews supporting reduced scales */
+    infos->scale_1_2 = tiff_has_overview (in, 2);
+    infos->scale_1_4 = tiff_has_overview (in, 4);
+    infos->scale_1_8 = tiff_has_overview (in, 8);
     TIFFClose (in);
     *infos_handle = infos;
     return GGRAPH_OK;
@@ -588,6 +989,10 @@ gg_image_infos_from_tiff (const char *path, gGraphImageInfosPtr * infos_handle)
 	  infos->palette_blue[i] = blue[i];
       }
     infos->max_palette = max_palette;
+/* checking for Overviews supporting reduced scales */
+    infos->scale_1_2 = tiff_has_overview (in, 2);
+    infos->scale_1_4 = tiff_has_overview (in, 4);
+    infos->scale_1_8 = tiff_has_overview (in, 8);
     TIFFClose (in);
     *infos_handle = infos;
     return GGRAPH_OK;
@@ -859,6 +1264,10 @@ gg_image_infos_from_geo_tiff (const char *path,
     infos->upper_left_y = upper_left_y;
     infos->pixel_x_size = pixel_x;
     infos->pixel_y_size = pixel_y;
+/* checking for Overviews supporting reduced scales */
+    infos->scale_1_2 = tiff_has_overview (in, 2);
+    infos->scale_1_4 = tiff_has_overview (in, 4);
+    infos->scale_1_8 = tiff_has_overview (in, 8);
     TIFFClose (in);
     GTIFFree (gtif);
     *infos_handle = infos;
@@ -1024,6 +1433,146 @@ common_read_from_tiff_grid (TIFF * in, gGraphImagePtr img, uint32 width,
     return ret;
 }
 
+static void
+tiff_get_image_palette (TIFF * in, gGraphImagePtr img)
+{
+/* populating the image palette from the TIFF colormap [8 bit indices] */
+    int i;
+    uint16 *red;
+    uint16 *green;
+    uint16 *blue;
+    if (!TIFFGetField (in, TIFFTAG_COLORMAP, &red, &green, &blue))
+	return;
+    for (i = 0; i < 256; i++)
+      {
+	  if (red[i] < 256)
+	      img->palette_red[i] = red[i];
+	  else
+	      img->palette_red[i] = red[i] / 256;
+	  if (green[i] < 256)
+	      img->palette_green[i] = green[i];
+	  else
+	      img->palette_green[i] = green[i] / 256;
+	  if (blue[i] < 256)
+	      img->palette_blue[i] = blue[i];
+	  else
+	      img->palette_blue[i] = blue[i] / 256;
+      }
+    img->max_palette = 256;
+}
+
+static int
+window_read_from_tiff_native (TIFF * in, const struct tiff_layout *layout,
+			      gGraphImagePtr img, int win_x, int win_y)
+{
+/*
+/ common utility: decoding a TIFF raster window [GRID or native format]
+/ only the tiles or strips intersecting the window are actually decoded
+*/
+    unsigned char *raster = NULL;
+    tsize_t buf_size;
+    int sample_size =
+	(layout->bits_per_sample / 8) * layout->samples_per_pixel;
+    int row_size = sample_size * img->width;
+    int x0;
+    int x1;
+    int y0;
+    int y1;
+    int y;
+    int tile_x;
+    int tile_y;
+    int strip_y;
+    int rows;
+    unsigned char *p_in;
+    unsigned char *p_out;
+
+    if (layout->is_tiled)
+	buf_size = TIFFTileSize (in);
+    else
+	buf_size = TIFFStripSize (in);
+    raster = malloc (buf_size);
+    if (!raster)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+
+    if (layout->is_tiled)
+      {
+	  for (tile_y = (win_y / layout->tile_height) * layout->tile_height;
+	       tile_y < win_y + img->height; tile_y += layout->tile_height)
+	    {
+		/* scanning the intersecting tiles by row */
+		y0 = tile_y;
+		if (y0 < win_y)
+		    y0 = win_y;
+		y1 = tile_y + layout->tile_height;
+		if (y1 > win_y + img->height)
+		    y1 = win_y + img->height;
+		for (tile_x =
+		     (win_x / layout->tile_width) * layout->tile_width;
+		     tile_x < win_x + img->width; tile_x += layout->tile_width)
+		  {
+		      /* decoding a TIFF tile */
+		      if (TIFFReadEncodedTile
+			  (in, TIFFComputeTile (in, tile_x, tile_y, 0, 0),
+			   raster, (tsize_t) - 1) < 0)
+			  goto error;
+		      x0 = tile_x;
+		      if (x0 < win_x)
+			  x0 = win_x;
+		      x1 = tile_x + layout->tile_width;
+		      if (x1 > win_x + img->width)
+			  x1 = win_x + img->width;
+		      for (y = y0; y < y1; y++)
+			{
+			    p_in =
+				raster +
+				((((y - tile_y) * layout->tile_width) +
+				  (x0 - tile_x)) * sample_size);
+			    p_out =
+				img->pixels + ((y - win_y) * row_size) +
+				((x0 - win_x) * sample_size);
+			    memcpy (p_out, p_in, (x1 - x0) * sample_size);
+			}
+		  }
+	    }
+      }
+    else
+      {
+	  for (strip_y = (win_y / layout->rows_strip) * layout->rows_strip;
+	       strip_y < win_y + img->height; strip_y += layout->rows_strip)
+	    {
+		/* decoding a TIFF strip */
+		if (TIFFReadEncodedStrip
+		    (in, TIFFComputeStrip (in, strip_y, 0), raster,
+		     (tsize_t) - 1) < 0)
+		    goto error;
+		rows = layout->rows_strip;
+		if (strip_y + rows > (int) (layout->height))
+		    rows = layout->height - strip_y;
+		y0 = strip_y;
+		if (y0 < win_y)
+		    y0 = win_y;
+		y1 = strip_y + rows;
+		if (y1 > win_y + img->height)
+		    y1 = win_y + img->height;
+		for (y = y0; y < y1; y++)
+		  {
+		      p_in =
+			  raster +
+			  ((((y - strip_y) * layout->width) +
+			    win_x) * sample_size);
+		      p_out = img->pixels + ((y - win_y) * row_size);
+		      memcpy (p_out, p_in, row_size);
+		  }
+	    }
+      }
+    free (raster);
+    return GGRAPH_OK;
+
+  error:
+    free (raster);
+    return GGRAPH_TIFF_CODEC_ERROR;
+}
+
 static int
 common_read_from_tiff (TIFF * in, gGraphImagePtr img, uint32 width,
 		       uint32 height, int is_tiled, int type,
@@ -1031,6 +1580,7 @@ common_read_from_tiff (TIFF * in, gGraphImagePtr img, uint32 width,
 		       uint32 tile_width, uint32 tile_height, uint32 rows_strip)
 {
 /* common utility: decoding a TIFF raster */
+    struct tiff_layout layout;
     uint32 *raster = NULL;
     uint32 *scanline;
     int x;
@@ -1052,6 +1602,14 @@ common_read_from_tiff (TIFF * in, gGraphImagePtr img, uint32 width,
 	return common_read_from_tiff_grid (in, img, width, height, is_tiled,
 					   gg_sample_format, bits_per_sample,
 					   tile_width, tile_height, rows_strip);
+    tiff_get_layout (in, &layout);
+    if (layout.is_native && layout.type == type)
+      {
+	  /* copying samples and palette indices as they are */
+	  if (type == GG_PIXEL_PALETTE)
+	      tiff_get_image_palette (in, img);
+	  return window_read_from_tiff_native (in, &layout, img, 0, 0);
+      }
 
 /* allocating read buffer [plain ordinary image] */
     if (is_tiled)
@@ -1341,63 +1899,470 @@ gg_image_from_mem_tiff (int size, const void *data,
     return ret;
 }
 
-GGRAPH_PRIVATE int
-gg_image_strip_prepare_from_tiff (const char *path,
-				  gGraphStripImagePtr * image_handle)
+static void
+window_store_rgba_pixel (gGraphImagePtr img, unsigned char *p_out,
+			 uint32 pixel)
 {
-/* preparing to decode a TIFF [by meta-strips] */
-    gGraphStripImagePtr img = NULL;
-    uint16 bits_per_sample;
-    uint16 samples_per_pixel;
-    uint16 photometric;
-    uint16 compression;
-    uint16 planar_config;
-    uint16 sample_format;
-    uint32 width = 0;
-    uint32 height = 0;
-    uint32 rows_strip = 0;
-    int is_tiled;
-    uint32 tile_width;
-    uint32 tile_height;
-    int type;
-    int gg_sample_format;
-    struct tiff_codec_data *tiff_codec = NULL;
-    tsize_t buf_size;
-    void *tiff_buffer = NULL;
-    int ret = GGRAPH_TIFF_CODEC_ERROR;
-    TIFF *in = (TIFF *) 0;
-    *image_handle = NULL;
-
-/* suppressing TIFF warnings */
-    TIFFSetWarningHandler (NULL);
-
-/* reading from file */
-    in = TIFFOpen (path, "r");
-    if (in == NULL)
-	return GGRAPH_TIFF_CODEC_ERROR;
-    is_tiled = TIFFIsTiled (in);
-/* retrieving the TIFF dimensions */
-    TIFFGetField (in, TIFFTAG_IMAGELENGTH, &height);
-    TIFFGetField (in, TIFFTAG_IMAGEWIDTH, &width);
-    if (is_tiled)
+/* storing an RGBA pixel into the output image */
+    unsigned char red = TIFFGetR (pixel);
+    unsigned char green = TIFFGetG (pixel);
+    unsigned char blue = TIFFGetB (pixel);
+    if (img->pixel_format == GG_PIXEL_PALETTE)
       {
-	  TIFFGetField (in, TIFFTAG_TILEWIDTH, &tile_width);
-	  TIFFGetField (in, TIFFTAG_TILELENGTH, &tile_height);
+	  /* PALETTE image */
+	  *p_out = gg_match_palette (img, red, green, blue);
       }
-    else
-	TIFFGetField (in, TIFFTAG_ROWSPERSTRIP, &rows_strip);
-    TIFFGetField (in, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
-    if (TIFFGetField (in, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel) == 0)
+    else if (img->pixel_format == GG_PIXEL_GRAYSCALE)
       {
-	  /* attempting to recover badly formatted TIFFs */
-	  samples_per_pixel = 1;
+	  /* GRAYSCALE  image */
+	  *p_out = red;
       }
-    TIFFGetField (in, TIFFTAG_PHOTOMETRIC, &photometric);
-    TIFFGetField (in, TIFFTAG_COMPRESSION, &compression);
-    if (TIFFGetField (in, TIFFTAG_PLANARCONFIG, &planar_config) == 0)
+    else
       {
-	  /* attempting to recover badly formatted TIFFs */
-	  planar_config = PLANARCONFIG_CONTIG;
+	  /* should be an RGB image */
+	  *p_out++ = red;
+	  *p_out++ = green;
+	  *p_out = blue;
+      }
+}
+
+static int
+window_read_from_tiff (TIFF * in, const struct tiff_layout *layout,
+		       gGraphImagePtr img, int win_x, int win_y)
+{
+/*
+/ common utility: decoding a TIFF raster window
+/ only the tiles or strips intersecting the window are actually decoded
+*/
+    uint32 *raster = NULL;
+    uint32 *scanline;
+    int x0;
+    int x1;
+    int x;
+    int y;
+    int img_y;
+    int tile_x;
+    int tile_y;
+    int strip_y;
+    int rows;
+    unsigned char *p_out;
+
+    if (layout->type == GG_PIXEL_GRID)
+	return window_read_from_tiff_native (in, layout, img, win_x, win_y);
+    if (layout->is_native)
+      {
+	  /* copying samples and palette indices as they are */
+	  if (layout->type == GG_PIXEL_PALETTE)
+	      tiff_get_image_palette (in, img);
+	  return window_read_from_tiff_native (in, layout, img, win_x, win_y);
+      }
+
+/* allocating read buffer [plain ordinary image] */
+    if (layout->is_tiled)
+	raster =
+	    malloc (sizeof (uint32) * layout->tile_width * layout->tile_height);
+    else
+	raster = malloc (sizeof (uint32) * layout->width * layout->rows_strip);
+    if (!raster)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+
+    if (layout->is_tiled)
+      {
+	  for (tile_y = (win_y / layout->tile_height) * layout->tile_height;
+	       tile_y < win_y + img->height; tile_y += layout->tile_height)
+	    {
+		/* scanning the intersecting tiles by row */
+		for (tile_x =
+		     (win_x / layout->tile_width) * layout->tile_width;
+		     tile_x < win_x + img->width; tile_x += layout->tile_width)
+		  {
+		      /* decoding a TIFF tile */
+		      if (!TIFFReadRGBATile (in, tile_x, tile_y, raster))
+			  goto error;
+		      x0 = tile_x;
+		      if (x0 < win_x)
+			  x0 = win_x;
+		      x1 = tile_x + layout->tile_width;
+		      if (x1 > win_x + img->width)
+			  x1 = win_x + img->width;
+		      for (y = 0; y < (int) (layout->tile_height); y++)
+			{
+			    /* RGBA tiles are bottom-up oriented */
+			    img_y = tile_y + (layout->tile_height - y) - 1;
+			    if (img_y < win_y || img_y >= win_y + img->height)
+				continue;
+			    scanline = raster + (y * layout->tile_width);
+			    p_out =
+				img->pixels +
+				((img_y - win_y) * img->scanline_width) +
+				((x0 - win_x) * img->pixel_size);
+			    for (x = x0; x < x1; x++)
+			      {
+				  window_store_rgba_pixel (img, p_out,
+							   scanline[x -
+								    tile_x]);
+				  p_out += img->pixel_size;
+			      }
+			}
+		  }
+	    }
+      }
+    else
+      {
+	  for (strip_y = (win_y / layout->rows_strip) * layout->rows_strip;
+	       strip_y < win_y + img->height; strip_y += layout->rows_strip)
+	    {
+		/* decoding a TIFF strip */
+		if (!TIFFReadRGBAStrip (in, strip_y, raster))
+		    goto error;
+		rows = layout->rows_strip;
+		if (strip_y + rows > (int) (layout->height))
+		    rows = layout->height - strip_y;
+		for (y = 0; y < rows; y++)
+		  {
+		      /* RGBA strips are bottom-up oriented */
+		      img_y = (strip_y + rows) - (y + 1);
+		      if (img_y < win_y || img_y >= win_y + img->height)
+			  continue;
+		      scanline = raster + (y * layout->width);
+		      p_out =
+			  img->pixels + ((img_y - win_y) * img->scanline_width);
+		      for (x = win_x; x < win_x + img->width; x++)
+			{
+			    window_store_rgba_pixel (img, p_out, scanline[x]);
+			    p_out += img->pixel_size;
+			}
+		  }
+	    }
+      }
+    free (raster);
+    return GGRAPH_OK;
+
+  error:
+    free (raster);
+    return GGRAPH_TIFF_CODEC_ERROR;
+}
+
+static int
+tiff_get_georeferencing (GTIF * gtif, gGraphImagePtr img,
+			 const struct tiff_overview_ifd *ovr,
+			 const struct tiff_layout *layout, int win_x,
+			 int win_y)
+{
+/*
+/ retrieving the GeoTIFF georeferencing [adjusted to some window]
+/ the TIFF must be positioned on the main IFD; layout describes
+/ the IFD actually decoded [may be, some Overview]
+*/
+    int epsg = -1;
+    double cx;
+    double cy;
+    double upper_left_x;
+    double upper_left_y;
+    double upper_right_x;
+    double lower_left_y;
+    double pixel_x;
+    double pixel_y;
+    char srs_name[1024];
+    const char *proj4text;
+    int len;
+    GTIFDefn definition;
+
+    if (!GTIFGetDefn (gtif, &definition))
+	return GGRAPH_GEOTIFF_CODEC_ERROR;
+
+/* retrieving the EPSG code */
+    if (definition.PCS == 32767)
+      {
+	  if (definition.GCS != 32767)
+	      epsg = definition.GCS;
+      }
+    else
+	epsg = definition.PCS;
+    *srs_name = '\0';
+    if (definition.PCS == 32767)
+      {
+	  /* Get the GCS name if possible */
+	  char *pszName = NULL;
+	  GTIFGetGCSInfo (definition.GCS, &pszName, NULL, NULL, NULL);
+	  if (pszName != NULL)
+	      strcpy (srs_name, pszName);
+	  CPLFree (pszName);
+      }
+    else
+      {
+	  /* Get the PCS name if possible */
+	  char *pszPCSName = NULL;
+	  GTIFGetPCSInfo (definition.PCS, &pszPCSName, NULL, NULL, NULL);
+	  if (pszPCSName != NULL)
+	      strcpy (srs_name, pszPCSName);
+	  CPLFree (pszPCSName);
+      }
+/* retrieving the PROJ.4 params */
+    proj4text = GTIFGetProj4Defn (&definition);
+
+/* computing the corners coords */
+    cx = 0.0;
+    cy = 0.0;
+    GTIFImageToPCS (gtif, &cx, &cy);
+    upper_left_x = cx;
+    upper_left_y = cy;
+    cx = 0.0;
+    cy = ovr->main_height;
+    GTIFImageToPCS (gtif, &cx, &cy);
+    lower_left_y = cy;
+    cx = ovr->main_width;
+    cy = 0.0;
+    GTIFImageToPCS (gtif, &cx, &cy);
+    upper_right_x = cx;
+/* computing the pixel size */
+    pixel_x = (upper_right_x - upper_left_x) / (double) (layout->width);
+    pixel_y = (upper_left_y - lower_left_y) / (double) (layout->height);
+
+    if (img->srs_name)
+	free (img->srs_name);
+    img->srs_name = NULL;
+    len = strlen (srs_name);
+    if (len > 0)
+      {
+	  img->srs_name = malloc (len + 1);
+	  if (img->srs_name)
+	      strcpy (img->srs_name, srs_name);
+      }
+    if (img->proj4text)
+	free (img->proj4text);
+    img->proj4text = NULL;
+    if (proj4text != NULL)
+      {
+	  len = strlen (proj4text);
+	  if (len > 0)
+	    {
+		img->proj4text = malloc (len + 1);
+		if (img->proj4text)
+		    strcpy (img->proj4text, proj4text);
+	    }
+      }
+    img->is_georeferenced = 1;
+    img->srid = epsg;
+    img->upper_left_x = upper_left_x + ((double) win_x * pixel_x);
+    img->upper_left_y = upper_left_y - ((double) win_y * pixel_y);
+    img->pixel_x_size = pixel_x;
+    img->pixel_y_size = pixel_y;
+    return GGRAPH_OK;
+}
+
+static int
+image_from_tiff (const char *path, int is_geotiff, int scale,
+		 int whole_image, int x, int y, int width, int height,
+		 gGraphImagePtr * image_handle)
+{
+/*
+/ decoding a TIFF or GeoTIFF file
+/ - either the whole image [from the best Overview for 1:scale]
+/ - or else a rectangular window [full resolution]
+*/
+    gGraphImagePtr img = NULL;
+    struct tiff_layout layout;
+    struct tiff_overview_ifd ovr;
+    int ret = GGRAPH_TIFF_CODEC_ERROR;
+    TIFF *in = (TIFF *) 0;
+    GTIF *gtif = (GTIF *) 0;
+    *image_handle = NULL;
+
+    if (is_geotiff)
+	ret = GGRAPH_GEOTIFF_CODEC_ERROR;
+
+/* suppressing TIFF warnings */
+    TIFFSetWarningHandler (NULL);
+
+/* reading from file */
+    if (is_geotiff)
+	in = XTIFFOpen (path, "r");
+    else
+	in = TIFFOpen (path, "r");
+    if (in == NULL)
+	return ret;
+    if (is_geotiff)
+      {
+	  gtif = GTIFNew (in);
+	  if (gtif == NULL)
+	      goto error;
+      }
+    if (!whole_image)
+	scale = 1;
+    tiff_find_overview (in, scale, &ovr);
+    if (!tiff_goto_overview (in, &ovr))
+	goto error;
+    tiff_get_layout (in, &layout);
+    if (layout.type == GG_PIXEL_UNKNOWN)
+      {
+	  ret = GGRAPH_UNSUPPORTED_TIFF_LAYOUT;
+	  goto error;
+      }
+
+    if (whole_image)
+      {
+	  x = 0;
+	  y = 0;
+	  width = layout.width;
+	  height = layout.height;
+      }
+/* checking the window */
+    if (x < 0 || y < 0 || width <= 0 || height <= 0
+	|| x + width > (int) (layout.width)
+	|| y + height > (int) (layout.height))
+      {
+	  ret = GGRAPH_ERROR;
+	  goto error;
+      }
+
+    img =
+	gg_image_create (layout.type, width, height, layout.bits_per_sample,
+			 layout.samples_per_pixel, layout.gg_sample_format,
+			 NULL, NULL);
+    if (!img)
+      {
+	  ret = GGRAPH_INSUFFICIENT_MEMORY;
+	  goto error;
+      }
+    if (layout.is_tiled)
+      {
+	  img->tile_width = layout.tile_width;
+	  img->tile_height = layout.tile_height;
+      }
+    else
+	img->rows_per_strip = layout.rows_strip;
+    img->compression = tiff_compression_from_layout (&layout);
+    if (gtif)
+      {
+	  /* the GeoTIFF tags only belong to the main IFD */
+	  if (ovr.found)
+	    {
+		if (!TIFFSetDirectory (in, 0))
+		    goto error;
+	    }
+	  ret = tiff_get_georeferencing (gtif, img, &ovr, &layout, x, y);
+	  if (ret != GGRAPH_OK)
+	      goto error;
+	  ret = GGRAPH_GEOTIFF_CODEC_ERROR;
+	  if (!tiff_goto_overview (in, &ovr))
+	      goto error;
+      }
+
+    ret = window_read_from_tiff (in, &layout, img, x, y);
+    if (ret != GGRAPH_OK)
+	goto error;
+
+    if (gtif)
+      {
+	  XTIFFClose (in);
+	  GTIFFree (gtif);
+      }
+    else
+	TIFFClose (in);
+    *image_handle = img;
+    return GGRAPH_OK;
+
+  error:
+    if (is_geotiff)
+	XTIFFClose (in);
+    else
+	TIFFClose (in);
+    if (gtif)
+	GTIFFree (gtif);
+    if (img)
+	gGraphDestroyImage (img);
+    return ret;
+}
+
+GGRAPH_PRIVATE int
+gg_image_window_from_tiff (const char *path, int is_geotiff, int x, int y,
+			   int width, int height,
+			   gGraphImagePtr * image_handle)
+{
+/* decoding a rectangular window from a TIFF or GeoTIFF file */
+    return image_from_tiff (path, is_geotiff, 1, 0, x, y, width, height,
+			    image_handle);
+}
+
+GGRAPH_PRIVATE int
+gg_image_from_tiff (const char *path, int is_geotiff, int scale,
+		    gGraphImagePtr * image_handle)
+{
+/*
+/ decoding a whole TIFF or GeoTIFF file
+/ when a reduced scale [2, 4, 8] is requested the smallest Overview
+/ still covering 1:scale will be decoded instead of the main IFD
+/ [full resolution will be returned if no suitable Overview exists]
+*/
+    return image_from_tiff (path, is_geotiff, scale, 1, 0, 0, 0, 0,
+			    image_handle);
+}
+
+GGRAPH_PRIVATE int
+gg_image_strip_prepare_from_tiff (const char *path, int scale,
+				  gGraphStripImagePtr * image_handle)
+{
+/*
+/ preparing to decode a TIFF [by meta-strips]
+/ when a reduced scale is requested the best Overview will be used
+*/
+    gGraphStripImagePtr img = NULL;
+    uint16 bits_per_sample;
+    uint16 samples_per_pixel;
+    uint16 photometric;
+    uint16 compression;
+    uint16 planar_config;
+    uint16 sample_format;
+    uint32 width = 0;
+    uint32 height = 0;
+    uint32 rows_strip = 0;
+    int is_tiled;
+    uint32 tile_width;
+    uint32 tile_height;
+    int type;
+    int gg_sample_format;
+    struct tiff_codec_data *tiff_codec = NULL;
+    tsize_t buf_size;
+    void *tiff_buffer = NULL;
+    int ret = GGRAPH_TIFF_CODEC_ERROR;
+    TIFF *in = (TIFF *) 0;
+    struct tiff_overview_ifd ovr;
+    *image_handle = NULL;
+
+/* suppressing TIFF warnings */
+    TIFFSetWarningHandler (NULL);
+
+/* reading from file */
+    in = TIFFOpen (path, "r");
+    if (in == NULL)
+	return GGRAPH_TIFF_CODEC_ERROR;
+    tiff_find_overview (in, scale, &ovr);
+    if (!tiff_goto_overview (in, &ovr))
+	goto error;
+    is_tiled = TIFFIsTiled (in);
+/* retrieving the TIFF dimensions */
+    TIFFGetField (in, TIFFTAG_IMAGELENGTH, &height);
+    TIFFGetField (in, TIFFTAG_IMAGEWIDTH, &width);
+    if (is_tiled)
+      {
+	  TIFFGetField (in, TIFFTAG_TILEWIDTH, &tile_width);
+	  TIFFGetField (in, TIFFTAG_TILELENGTH, &tile_height);
+      }
+    else
+	TIFFGetField (in, TIFFTAG_ROWSPERSTRIP, &rows_strip);
+    TIFFGetField (in, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+    if (TIFFGetField (in, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel) == 0)
+      {
+	  /* attempting to recover badly formatted TIFFs */
+	  samples_per_pixel = 1;
+      }
+    TIFFGetField (in, TIFFTAG_PHOTOMETRIC, &photometric);
+    TIFFGetField (in, TIFFTAG_COMPRESSION, &compression);
+    if (TIFFGetField (in, TIFFTAG_PLANARCONFIG, &planar_config) == 0)
+      {
+	  /* attempting to recover badly formatted TIFFs */
+	  planar_config = PLANARCONFIG_CONTIG;
       }
     if (TIFFGetField (in, TIFFTAG_SAMPLEFORMAT, &sample_format) == 0)
 	sample_format = SAMPLEFORMAT_UINT;
@@ -1577,7 +2542,11 @@ gg_image_strip_prepare_from_tiff (const char *path,
     tiff_codec->tiff_handle = in;
     tiff_codec->geotiff_handle = (GTIF *) 0;
     tiff_codec->tiff_buffer = NULL;
+    tiff_codec->overviews = NULL;
+    tiff_codec->parallel = NULL;
     tiff_codec->is_tiled = is_tiled;
+    tiff_codec->is_native =
+	tiff_is_native (in, type, bits_per_sample, photometric);
     img->codec_data = tiff_codec;
 
 /* allocating the TIFF read buffer */
@@ -1588,6 +2557,13 @@ gg_image_strip_prepare_from_tiff (const char *path,
 	  else
 	      buf_size = TIFFScanlineSize (in);
       }
+    else if (tiff_codec->is_native)
+      {
+	  if (is_tiled)
+	      buf_size = TIFFTileSize (in);
+	  else
+	      buf_size = TIFFStripSize (in);
+      }
     else
       {
 	  if (is_tiled)
@@ -1611,10 +2587,13 @@ gg_image_strip_prepare_from_tiff (const char *path,
 }
 
 GGRAPH_PRIVATE int
-gg_image_strip_prepare_from_geotiff (const char *path,
+gg_image_strip_prepare_from_geotiff (const char *path, int scale,
 				     gGraphStripImagePtr * image_handle)
 {
-/* preparing to decode a GeoTIFF [by meta-strips] */
+/*
+/ preparing to decode a GeoTIFF [by meta-strips]
+/ when a reduced scale is requested the best Overview will be used
+*/
     gGraphStripImagePtr img = NULL;
     uint16 bits_per_sample;
     uint16 samples_per_pixel;
@@ -1648,6 +2627,7 @@ gg_image_strip_prepare_from_geotiff (const char *path,
     TIFF *in = (TIFF *) 0;
     GTIF *gtif = (GTIF *) 0;
     GTIFDefn definition;
+    struct tiff_overview_ifd ovr;
     *image_handle = NULL;
 
 /* suppressing TIFF warnings */
@@ -1694,6 +2674,24 @@ gg_image_strip_prepare_from_geotiff (const char *path,
 /* retrieving the PROJ.4 params */
     strcpy (proj4text, GTIFGetProj4Defn (&definition));
 
+/* computing the corners coords [the GeoTIFF tags belong to the main IFD] */
+    tiff_find_overview (in, scale, &ovr);
+    cx = 0.0;
+    cy = 0.0;
+    GTIFImageToPCS (gtif, &cx, &cy);
+    upper_left_x = cx;
+    upper_left_y = cy;
+    cx = 0.0;
+    cy = ovr.main_height;
+    GTIFImageToPCS (gtif, &cx, &cy);
+    lower_left_y = cy;
+    cx = ovr.main_width;
+    cy = 0.0;
+    GTIFImageToPCS (gtif, &cx, &cy);
+    upper_right_x = cx;
+    if (!tiff_goto_overview (in, &ovr))
+	goto error;
+
     is_tiled = TIFFIsTiled (in);
 /* retrieving the TIFF dimensions */
     TIFFGetField (in, TIFFTAG_IMAGELENGTH, &height);
@@ -1760,24 +2758,7 @@ gg_image_strip_prepare_from_geotiff (const char *path,
 	  break;
       };
 
-/* computing the corners coords */
-    cx = 0.0;
-    cy = 0.0;
-    GTIFImageToPCS (gtif, &cx, &cy);
-    upper_left_x = cx;
-    upper_left_y = cy;
-    cx = 0.0;
-    cy = height;
-    GTIFImageToPCS (gtif, &cx, &cy);
-    lower_left_y = cy;
-    cx = width;
-    cy = 0.0;
-    GTIFImageToPCS (gtif, &cx, &cy);
-    upper_right_x = cx;
-    cx = width;
-    cy = height;
-    GTIFImageToPCS (gtif, &cx, &cy);
-/* computing the pixel size */
+/* computing the pixel size [the Overview could be smaller] */
     pixel_x = (upper_right_x - upper_left_x) / (double) width;
     pixel_y = (upper_left_y - lower_left_y) / (double) height;
     if (type == GG_PIXEL_UNKNOWN)
@@ -1920,7 +2901,11 @@ gg_image_strip_prepare_from_geotiff (const char *path,
     tiff_codec->tiff_handle = in;
     tiff_codec->geotiff_handle = gtif;
     tiff_codec->tiff_buffer = NULL;
+    tiff_codec->overviews = NULL;
+    tiff_codec->parallel = NULL;
     tiff_codec->is_tiled = is_tiled;
+    tiff_codec->is_native =
+	tiff_is_native (in, type, bits_per_sample, photometric);
     img->codec_data = tiff_codec;
 
 /* allocating the TIFF read buffer */
@@ -1931,6 +2916,13 @@ gg_image_strip_prepare_from_geotiff (const char *path,
 	  else
 	      buf_size = TIFFScanlineSize (in);
       }
+    else if (tiff_codec->is_native)
+      {
+	  if (is_tiled)
+	      buf_size = TIFFTileSize (in);
+	  else
+	      buf_size = TIFFStripSize (in);
+      }
     else
       {
 	  if (is_tiled)
@@ -1955,6 +2947,66 @@ gg_image_strip_prepare_from_geotiff (const char *path,
     return ret;
 }
 
+static void
+tiff_parallel_free_blocks (struct tiff_parallel *par)
+{
+/* freeing the staged strips or tiles */
+    int i;
+    if (par->jobs)
+      {
+	  for (i = 0; i < par->max_blocks; i++)
+	    {
+		struct tiff_compress_job *job = par->jobs + i;
+		if (job->compressed)
+		    free (job->compressed);
+		if (job->lzw_keys)
+		    free (job->lzw_keys);
+		if (job->lzw_codes)
+		    free (job->lzw_codes);
+		if (job->zstream)
+		  {
+		      deflateEnd (job->zstream);
+		      free (job->zstream);
+		  }
+	    }
+	  free (par->jobs);
+      }
+    if (par->staging)
+	free (par->staging);
+    par->jobs = NULL;
+    par->staging = NULL;
+    par->max_blocks = 0;
+    par->num_blocks = 0;
+}
+
+static void
+tiff_parallel_destroy (struct tiff_parallel *par)
+{
+/* destroying the TIFF multithreaded compression struct */
+    tiff_parallel_free_blocks (par);
+    if (par->own_pool)
+	gg_thread_pool_destroy (par->pool);
+    free (par);
+}
+
+static void
+tiff_overviews_destroy (struct tiff_overviews *ovr)
+{
+/* destroying the TIFF Overviews struct */
+    int level;
+    for (level = 0; level < ovr->num_levels; level++)
+      {
+	  struct tiff_overview *lvl = ovr->levels + level;
+	  if (lvl->pending)
+	      free (lvl->pending);
+	  if (lvl->row)
+	      free (lvl->row);
+	  if (lvl->tmp)
+	      fclose (lvl->tmp);
+      }
+    free (ovr);
+}
+
 GGRAPH_PRIVATE void
 gg_tiff_codec_destroy (void *p)
 {
@@ -1971,6 +3023,10 @@ gg_tiff_codec_destroy (void *p)
 	TIFFClose (codec->tiff_handle);
     if (codec->tiff_buffer)
 	free (codec->tiff_buffer);
+    if (codec->overviews)
+	tiff_overviews_destroy (codec->overviews);
+    if (codec->parallel)
+	tiff_parallel_destroy (codec->parallel);
     free (codec);
 }
 
@@ -2305,52 +3361,117 @@ gg_match_strip_palette (const gGraphStripImagePtr img, unsigned char r,
 			unsigned char g, unsigned char b)
 {
 /* handling palette colors */
-    int index;
-    double min_dist = DBL_MAX;
-    double dist;
-    int min_index;
-    for (index = 0; index < img->max_palette; index++)
-      {
-	  /* searching if already defined */
-	  if (img->palette_red[index] == r && img->palette_green[index] == g
-	      && img->palette_blue[index] == b)
-	      return (unsigned char) index;
-      }
-    if (img->max_palette < 255)
+    return gg_palette_cache_match (&(img->palette_cache), &(img->max_palette),
+				   img->palette_version, img->palette_red,
+				   img->palette_green, img->palette_blue, r,
+				   g, b);
+}
+
+static int
+common_strip_read_from_tiff_native (TIFF * in, void *tiff_buffer,
+				    gGraphStripImagePtr img, uint32 width,
+				    uint32 height, int is_tiled,
+				    uint32 tile_width, uint32 tile_height,
+				    uint32 rows_strip)
+{
+/*
+/ common utility: decoding a TIFF raster [native format] by meta-strip
+/ samples and palette indices are simply copied as they are
+*/
+    unsigned char *raster = tiff_buffer;
+    int x1;
+    int y0;
+    int y1;
+    int y;
+    int tile_x;
+    int tile_y;
+    int strip_y;
+    int rows;
+    unsigned char *p_in;
+    unsigned char *p_out;
+    int begin_row = img->next_row;
+    int end_row = img->next_row + img->rows_per_block;
+
+    if (end_row > img->height)
+	end_row = img->height;
+
+    if (is_tiled)
       {
-	  /* inserting a new palette entry */
-	  unsigned char i = img->max_palette;
-	  img->max_palette += 1;
-	  img->palette_red[i] = r;
-	  img->palette_green[i] = g;
-	  img->palette_blue[i] = b;
-	  return i;
+	  for (tile_y = (begin_row / tile_height) * tile_height;
+	       tile_y < end_row; tile_y += tile_height)
+	    {
+		/* scanning the intersecting tiles by row */
+		y0 = tile_y;
+		if (y0 < begin_row)
+		    y0 = begin_row;
+		y1 = tile_y + tile_height;
+		if (y1 > end_row)
+		    y1 = end_row;
+		for (tile_x = 0; tile_x < (int) width; tile_x += tile_width)
+		  {
+		      /* decoding a TIFF tile */
+		      if (TIFFReadEncodedTile
+			  (in, TIFFComputeTile (in, tile_x, tile_y, 0, 0),
+			   raster, (tsize_t) - 1) < 0)
+			  return GGRAPH_TIFF_CODEC_ERROR;
+		      x1 = tile_x + tile_width;
+		      if (x1 > (int) width)
+			  x1 = width;
+		      for (y = y0; y < y1; y++)
+			{
+			    p_in =
+				raster +
+				((y - tile_y) * tile_width * img->pixel_size);
+			    p_out =
+				img->pixels +
+				((y - begin_row) * img->scanline_width) +
+				(tile_x * img->pixel_size);
+			    memcpy (p_out, p_in,
+				    (x1 - tile_x) * img->pixel_size);
+			}
+		  }
+	    }
       }
-/* all right, the palette is already fully populated */
-    for (index = 0; index < img->max_palette; index++)
+    else
       {
-	  /* computing the minimal euclidean distance */
-	  dist =
-	      sqrt (((img->palette_red[index] - r) * (img->palette_red[index] -
-						      r)) +
-		    ((img->palette_green[index] -
-		      g) * (img->palette_green[index] - g)) +
-		    ((img->palette_blue[index] -
-		      b) * (img->palette_blue[index] - b)));
-	  if (dist < min_dist)
+	  if (rows_strip > height)
+	      rows_strip = height;
+	  for (strip_y = (begin_row / rows_strip) * rows_strip;
+	       strip_y < end_row; strip_y += rows_strip)
 	    {
-		min_dist = dist;
-		min_index = index;
+		/* decoding a TIFF strip */
+		if (TIFFReadEncodedStrip
+		    (in, TIFFComputeStrip (in, strip_y, 0), raster,
+		     (tsize_t) - 1) < 0)
+		    return GGRAPH_TIFF_CODEC_ERROR;
+		rows = rows_strip;
+		if (strip_y + rows > (int) height)
+		    rows = height - strip_y;
+		y0 = strip_y;
+		if (y0 < begin_row)
+		    y0 = begin_row;
+		y1 = strip_y + rows;
+		if (y1 > end_row)
+		    y1 = end_row;
+		for (y = y0; y < y1; y++)
+		  {
+		      p_in = raster + ((y - strip_y) * width * img->pixel_size);
+		      p_out =
+			  img->pixels + ((y - begin_row) * img->scanline_width);
+		      memcpy (p_out, p_in, width * img->pixel_size);
+		  }
 	    }
       }
-    return (unsigned char) min_index;
+    img->next_row += end_row - begin_row;
+    img->current_available_rows = end_row - begin_row;
+    return GGRAPH_OK;
 }
 
 static int
 common_strip_read_from_tiff (TIFF * in, void *tiff_buffer,
 			     gGraphStripImagePtr img, uint32 width,
-			     uint32 height, int is_tiled, int type,
-			     uint32 tile_width, uint32 tile_height,
+			     uint32 height, int is_tiled, int is_native,
+			     int type, uint32 tile_width, uint32 tile_height,
 			     uint32 rows_strip)
 {
 /* common utility: decoding a TIFF raster [by meta-strip] */
@@ -2375,6 +3496,10 @@ common_strip_read_from_tiff (TIFF * in, void *tiff_buffer,
 	return common_strip_read_from_tiff_grid (in, tiff_buffer, img, width,
 						 height, is_tiled, tile_width,
 						 tile_height);
+    if (is_native)
+	return common_strip_read_from_tiff_native (in, tiff_buffer, img, width,
+						   height, is_tiled, tile_width,
+						   tile_height, rows_strip);
 
     if (end_row > img->height)
 	end_row = img->height;
@@ -2520,8 +3645,8 @@ gg_image_strip_read_from_tiff (gGraphStripImagePtr img, int *progress)
 
     int ret =
 	common_strip_read_from_tiff (in, tiff_codec->tiff_buffer, img, width,
-				     height, is_tiled, type, tile_width,
-				     tile_height, rows_strip);
+				     height, is_tiled, tiff_codec->is_native,
+				     type, tile_width, tile_height, rows_strip);
 
     if (ret == GGRAPH_OK && progress != NULL)
 	*progress =
@@ -2693,6 +3818,9 @@ gg_image_prepare_to_tiff_by_strip (const gGraphStripImagePtr img,
     tiff_codec->tiff_handle = out;
     tiff_codec->geotiff_handle = (GTIF *) 0;
     tiff_codec->tiff_buffer = NULL;
+    tiff_codec->overviews = NULL;
+    tiff_codec->parallel = NULL;
+    tiff_codec->is_native = 0;
     if (layout == GGRAPH_TIFF_LAYOUT_TILES)
 	tiff_codec->is_tiled = 1;
     else
@@ -2934,6 +4062,9 @@ gg_image_prepare_to_geotiff_by_strip (const gGraphStripImagePtr img,
     tiff_codec->tiff_handle = out;
     tiff_codec->geotiff_handle = (GTIF *) 0;
     tiff_codec->tiff_buffer = NULL;
+    tiff_codec->overviews = NULL;
+    tiff_codec->parallel = NULL;
+    tiff_codec->is_native = 0;
     if (layout == GGRAPH_TIFF_LAYOUT_TILES)
 	tiff_codec->is_tiled = 1;
     else
@@ -2941,34 +4072,379 @@ gg_image_prepare_to_geotiff_by_strip (const gGraphStripImagePtr img,
     tiff_codec->tiff_type = tiff_type;
     img->codec_data = tiff_codec;
 
-/* allocating the TIFF write buffer */
-    if (img->pixel_format == GG_PIXEL_GRID)
-      {
-	  if (tiff_codec->is_tiled)
-	      buf_size = TIFFTileSize (out);
-	  else
-	      buf_size = TIFFScanlineSize (out);
-      }
-    else
+/* allocating the TIFF write buffer */
+    if (img->pixel_format == GG_PIXEL_GRID)
+      {
+	  if (tiff_codec->is_tiled)
+	      buf_size = TIFFTileSize (out);
+	  else
+	      buf_size = TIFFScanlineSize (out);
+      }
+    else
+      {
+	  if (tiff_codec->is_tiled)
+	      buf_size = TIFFTileSize (out);
+	  else
+	      buf_size = TIFFScanlineSize (out);
+      }
+    tiff_buffer = malloc (buf_size);
+    if (!tiff_buffer)
+	goto error;
+    tiff_codec->tiff_buffer = tiff_buffer;
+
+    return GGRAPH_OK;
+
+  error:
+    if (gtif)
+	GTIFFree (gtif);
+    if (out)
+	XTIFFClose (out);
+    return GGRAPH_TIFF_CODEC_ERROR;
+}
+
+struct tiff_lzw_state
+{
+/* TIFF LZW encoder: the output bit stream */
+    unsigned char *out;
+    size_t out_max;
+    size_t out_size;
+    unsigned long next_data;
+    int next_bits;
+    int nbits;
+    int overflow;
+};
+
+static void
+tiff_lzw_put_code (struct tiff_lzw_state *st, int code)
+{
+/* appending a code to the LZW bit stream [MSB first] */
+    st->next_data = (st->next_data << st->nbits) | code;
+    st->next_bits += st->nbits;
+    while (st->next_bits >= 8)
+      {
+	  st->next_bits -= 8;
+	  if (st->out_size >= st->out_max)
+	    {
+		st->overflow = 1;
+		continue;
+	    }
+	  st->out[st->out_size++] =
+	      (unsigned char) ((st->next_data >> st->next_bits) & 0xff);
+      }
+}
+
+static size_t
+tiff_lzw_encode (const unsigned char *in, size_t in_size, unsigned char *out,
+		 size_t out_max, int *keys, unsigned short *codes)
+{
+/*
+/ compressing a strip or tile using the TIFF flavor of LZW
+/ [9 to 12 bit codes, "early change" of the code width]
+/ returns the compressed size, zero on failure
+*/
+    struct tiff_lzw_state st;
+    int free_ent = TIFF_LZW_FIRST;
+    int max_code = 511;
+    int ent;
+    int key;
+    int h;
+    size_t i;
+
+    memset (keys, 0xff, sizeof (int) * TIFF_LZW_HASH_SIZE);
+    st.out = out;
+    st.out_max = out_max;
+    st.out_size = 0;
+    st.next_data = 0;
+    st.next_bits = 0;
+    st.nbits = 9;
+    st.overflow = 0;
+
+    tiff_lzw_put_code (&st, TIFF_LZW_CLEAR);
+    if (in_size > 0)
+      {
+	  ent = in[0];
+	  for (i = 1; i < in_size; i++)
+	    {
+		key = (ent << 8) | in[i];
+		h = ((in[i] << 5) ^ ent) & (TIFF_LZW_HASH_SIZE - 1);
+		while (keys[h] != -1 && keys[h] != key)
+		    h = (h + 1) & (TIFF_LZW_HASH_SIZE - 1);
+		if (keys[h] == key)
+		  {
+		      /* extending the current string */
+		      ent = codes[h];
+		      continue;
+		  }
+		tiff_lzw_put_code (&st, ent);
+		ent = in[i];
+		keys[h] = key;
+		codes[h] = free_ent++;
+		if (free_ent == TIFF_LZW_FULL)
+		  {
+		      /* the table is full: restarting */
+		      memset (keys, 0xff, sizeof (int) * TIFF_LZW_HASH_SIZE);
+		      tiff_lzw_put_code (&st, TIFF_LZW_CLEAR);
+		      free_ent = TIFF_LZW_FIRST;
+		      st.nbits = 9;
+		      max_code = 511;
+		  }
+		else if (free_ent > max_code)
+		  {
+		      st.nbits++;
+		      max_code = (1 << st.nbits) - 1;
+		  }
+	    }
+	  /* the decoder will add a further entry after the last code */
+	  tiff_lzw_put_code (&st, ent);
+	  free_ent++;
+	  if (free_ent == TIFF_LZW_FULL)
+	    {
+		tiff_lzw_put_code (&st, TIFF_LZW_CLEAR);
+		st.nbits = 9;
+	    }
+	  else if (free_ent > max_code)
+	      st.nbits++;
+      }
+    tiff_lzw_put_code (&st, TIFF_LZW_EOI);
+    if (st.next_bits > 0)
+      {
+	  if (st.out_size < st.out_max)
+	      st.out[st.out_size++] =
+		  (unsigned char) ((st.next_data << (8 - st.next_bits)) &
+				   0xff);
+	  else
+	      st.overflow = 1;
+      }
+    if (st.overflow)
+	return 0;
+    return st.out_size;
+}
+
+static void
+tiff_compress_block (void *arg)
+{
+/* threaded function: compressing a single strip or tile */
+    struct tiff_compress_job *job = (struct tiff_compress_job *) arg;
+    z_stream *zs;
+
+    job->compressed_size = 0;
+    if (job->compression == COMPRESSION_LZW)
+      {
+	  if (job->lzw_keys == NULL)
+	      job->lzw_keys = malloc (sizeof (int) * TIFF_LZW_HASH_SIZE);
+	  if (job->lzw_codes == NULL)
+	      job->lzw_codes =
+		  malloc (sizeof (unsigned short) * TIFF_LZW_HASH_SIZE);
+	  if (job->lzw_keys == NULL || job->lzw_codes == NULL)
+	      return;
+	  job->compressed_size =
+	      tiff_lzw_encode (job->raw, job->raw_size, job->compressed,
+			       job->compressed_max, job->lzw_keys,
+			       job->lzw_codes);
+	  return;
+      }
+
+    if (job->zstream == NULL)
+      {
+	  /* initializing the DEFLATE stream just once */
+	  zs = malloc (sizeof (z_stream));
+	  if (zs == NULL)
+	      return;
+	  memset (zs, 0, sizeof (z_stream));
+	  if (deflateInit (zs, Z_DEFAULT_COMPRESSION) != Z_OK)
+	    {
+		free (zs);
+		return;
+	    }
+	  job->zstream = zs;
+      }
+    else
+      {
+	  zs = job->zstream;
+	  if (deflateReset (zs) != Z_OK)
+	      return;
+      }
+    zs->next_in = job->raw;
+    zs->avail_in = job->raw_size;
+    zs->next_out = job->compressed;
+    zs->avail_out = job->compressed_max;
+    if (deflate (zs, Z_FINISH) == Z_STREAM_END)
+	job->compressed_size = zs->total_out;
+}
+
+static int
+tiff_parallel_setup (struct tiff_parallel *par, TIFF * out, int is_tiled,
+		     int width, int height)
+{
+/*
+/ preparing to stage the strips or tiles of the current IFD
+/ only LZW and DEFLATE are supported, anything else will simply
+/ be encoded by libtiff as usual
+*/
+    uint16 compression;
+    uint32 tile_width;
+    size_t max_size;
+    int i;
+
+    tiff_parallel_free_blocks (par);
+    par->compression = 0;
+    par->height = height;
+    if (!TIFFGetField (out, TIFFTAG_COMPRESSION, &compression))
+	return 1;
+    if (compression != COMPRESSION_LZW && compression != COMPRESSION_DEFLATE
+	&& compression != COMPRESSION_ADOBE_DEFLATE)
+	return 1;
+    if (is_tiled)
+      {
+	  /* a whole row of tiles */
+	  TIFFGetField (out, TIFFTAG_TILEWIDTH, &tile_width);
+	  par->block_size = TIFFTileSize (out);
+	  par->max_blocks = (width + tile_width - 1) / tile_width;
+      }
+    else
+      {
+	  TIFFGetField (out, TIFFTAG_ROWSPERSTRIP, &(par->rows_per_strip));
+	  if (par->rows_per_strip < 1)
+	      par->rows_per_strip = 1;
+	  if (par->rows_per_strip > (uint32) height)
+	      par->rows_per_strip = height;
+	  par->scanline_size = TIFFScanlineSize (out);
+	  par->block_size = par->scanline_size * par->rows_per_strip;
+	  par->max_blocks = par->num_threads * 2;
+      }
+    if (par->block_size <= 0 || par->max_blocks < 1)
+	return 0;
+
+/* worst case: 12 bit LZW codes for each byte */
+    max_size = par->block_size + (par->block_size / 2) + 64;
+    if (max_size < compressBound (par->block_size))
+	max_size = compressBound (par->block_size);
+    par->staging = malloc (par->block_size * par->max_blocks);
+    par->jobs = malloc (sizeof (struct tiff_compress_job) * par->max_blocks);
+    if (!(par->staging) || !(par->jobs))
+	goto error;
+    for (i = 0; i < par->max_blocks; i++)
+      {
+	  par->jobs[i].compressed = NULL;
+	  par->jobs[i].lzw_keys = NULL;
+	  par->jobs[i].lzw_codes = NULL;
+	  par->jobs[i].zstream = NULL;
+      }
+    for (i = 0; i < par->max_blocks; i++)
+      {
+	  struct tiff_compress_job *job = par->jobs + i;
+	  job->compression = compression;
+	  job->raw = par->staging + (i * par->block_size);
+	  job->raw_size = par->block_size;
+	  job->compressed_max = max_size;
+	  job->compressed = malloc (max_size);
+	  if (!(job->compressed))
+	      goto error;
+      }
+    par->compression = compression;
+    return 1;
+
+  error:
+    tiff_parallel_free_blocks (par);
+    return 0;
+}
+
+static int
+tiff_parallel_flush (struct tiff_parallel *par, TIFF * out, int is_tiled)
+{
+/* compressing all staged strips or tiles, then writing them in order */
+    int i;
+    uint32 block;
+    struct tiff_compress_job *job;
+
+    if (par == NULL || par->num_blocks == 0)
+	return 1;
+    gg_thread_pool_run (par->pool, par->num_threads, tiff_compress_block,
+			par->jobs, sizeof (struct tiff_compress_job),
+			par->num_blocks);
+    for (i = 0; i < par->num_blocks; i++)
       {
-	  if (tiff_codec->is_tiled)
-	      buf_size = TIFFTileSize (out);
+	  job = par->jobs + i;
+	  block = par->first_block + i;
+	  if (job->compressed_size == 0)
+	      return 0;
+	  if (is_tiled)
+	    {
+		if (TIFFWriteRawTile
+		    (out, block, job->compressed,
+		     job->compressed_size) != (tsize_t) job->compressed_size)
+		    return 0;
+	    }
 	  else
-	      buf_size = TIFFScanlineSize (out);
+	    {
+		if (TIFFWriteRawStrip
+		    (out, block, job->compressed,
+		     job->compressed_size) != (tsize_t) job->compressed_size)
+		    return 0;
+	    }
       }
-    tiff_buffer = malloc (buf_size);
-    if (!tiff_buffer)
-	goto error;
-    tiff_codec->tiff_buffer = tiff_buffer;
+    par->num_blocks = 0;
+    return 1;
+}
 
-    return GGRAPH_OK;
+static int
+tiff_put_tile (const gGraphStripImagePtr img, void *tile, uint32 tile_x,
+	       uint32 tile_y)
+{
+/* writing a tile, or staging it for multithreaded compression */
+    struct tiff_codec_data *tiff_codec =
+	(struct tiff_codec_data *) (img->codec_data);
+    struct tiff_parallel *par = tiff_codec->parallel;
+    TIFF *out = tiff_codec->tiff_handle;
+    uint32 tile_no;
+    int slot;
 
-  error:
-    if (gtif)
-	GTIFFree (gtif);
-    if (out)
-	XTIFFClose (out);
-    return GGRAPH_TIFF_CODEC_ERROR;
+    if (par == NULL || par->compression == 0)
+	return (TIFFWriteTile (out, tile, tile_x, tile_y, 0, 0) < 0) ? 0 : 1;
+    tile_no = TIFFComputeTile (out, tile_x, tile_y, 0, 0);
+    if (par->num_blocks == 0)
+	par->first_block = tile_no;
+    slot = tile_no - par->first_block;
+    if (slot < 0 || slot >= par->max_blocks)
+	return 0;
+    memcpy (par->jobs[slot].raw, tile, par->block_size);
+    par->jobs[slot].raw_size = par->block_size;
+    par->num_blocks = slot + 1;
+    return 1;
+}
+
+static int
+tiff_put_scanline (const gGraphStripImagePtr img, void *scanline, int row)
+{
+/* writing a scanline, or staging it for multithreaded compression */
+    struct tiff_codec_data *tiff_codec =
+	(struct tiff_codec_data *) (img->codec_data);
+    struct tiff_parallel *par = tiff_codec->parallel;
+    TIFF *out = tiff_codec->tiff_handle;
+    uint32 strip;
+    int slot;
+    int row_in_strip;
+    int rows;
+
+    if (par == NULL || par->compression == 0)
+	return (TIFFWriteScanline (out, scanline, row, 0) < 0) ? 0 : 1;
+    strip = row / par->rows_per_strip;
+    row_in_strip = row % par->rows_per_strip;
+    if (par->num_blocks == 0)
+	par->first_block = strip;
+    slot = strip - par->first_block;
+    if (slot < 0 || slot >= par->max_blocks)
+	return 0;
+    memcpy (par->jobs[slot].raw + (row_in_strip * par->scanline_size),
+	    scanline, par->scanline_size);
+    rows = row_in_strip + 1;
+    par->jobs[slot].raw_size = par->scanline_size * rows;
+    par->num_blocks = slot + 1;
+    if (row == par->height - 1)
+	return tiff_parallel_flush (par, out, 0);
+    if (rows == (int) (par->rows_per_strip) && slot == par->max_blocks - 1)
+	return tiff_parallel_flush (par, out, 0);
+    return 1;
 }
 
 static int
@@ -2977,7 +4453,6 @@ tiff_write_tile_grid (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [tiles] GRID data */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int tile_width = img->tile_width;
     int tile_height = img->tile_height;
     int row;
@@ -3133,7 +4608,7 @@ tiff_write_tile_grid (const gGraphStripImagePtr img)
 			};
 		  }
 	    }
-	  if (TIFFWriteTile (out, tile, tile_x, tile_y, 0, 0) < 0)
+	  if (!tiff_put_tile (img, tile, tile_x, tile_y))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += num_rows;
@@ -3146,7 +4621,6 @@ tiff_write_strip_grid (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [strips] GRID data */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int row;
     int col;
     void *scanline = tiff_codec->tiff_buffer;
@@ -3272,7 +4746,7 @@ tiff_write_strip_grid (const gGraphStripImagePtr img)
 		      break;
 		  };
 	    }
-	  if (TIFFWriteScanline (out, scanline, img->next_row + row, 0) < 0)
+	  if (!tiff_put_scanline (img, scanline, img->next_row + row))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += img->current_available_rows;
@@ -3370,7 +4844,7 @@ tiff_write_tile_monochrome (const gGraphStripImagePtr img)
 		if (pos > 0)	/* exporting the last octet */
 		    *line_ptr++ = byte;
 	    }
-	  if (TIFFWriteTile (out, tile, tile_x, tile_y, 0, 0) < 0)
+	  if (!tiff_put_tile (img, tile, tile_x, tile_y))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += num_rows;
@@ -3383,7 +4857,6 @@ tiff_write_strip_monochrome (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [strips] MONOCHROME */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int row;
     int col;
     int pixel;
@@ -3443,7 +4916,7 @@ tiff_write_strip_monochrome (const gGraphStripImagePtr img)
 	    }
 	  if (pos > 0)		/* exporting the last octet */
 	      *line_ptr++ = byte;
-	  if (TIFFWriteScanline (out, scanline, img->next_row + row, 0) < 0)
+	  if (!tiff_put_scanline (img, scanline, img->next_row + row))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += img->current_available_rows;
@@ -3456,7 +4929,6 @@ tiff_write_tile_palette (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [tiles] PALETTE */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int tile_width = img->tile_width;
     int tile_height = img->tile_height;
     int row;
@@ -3494,7 +4966,7 @@ tiff_write_tile_palette (const gGraphStripImagePtr img)
 		      *line_ptr++ = *p_in++;	/* expected to be a PALETTE image anyway */
 		  }
 	    }
-	  if (TIFFWriteTile (out, tile, tile_x, tile_y, 0, 0) < 0)
+	  if (!tiff_put_tile (img, tile, tile_x, tile_y))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += num_rows;
@@ -3507,7 +4979,6 @@ tiff_write_strip_palette (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [strips] PALETTE */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int row;
     int col;
     unsigned char *scanline = tiff_codec->tiff_buffer;
@@ -3518,7 +4989,7 @@ tiff_write_strip_palette (const gGraphStripImagePtr img)
 	  line_ptr = scanline;
 	  for (col = 0; col < img->width; col++)
 	      *line_ptr++ = *p_in++;	/* expected to be a PALETTE image anyway */
-	  if (TIFFWriteScanline (out, scanline, img->next_row + row, 0) < 0)
+	  if (!tiff_put_scanline (img, scanline, img->next_row + row))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += img->current_available_rows;
@@ -3531,7 +5002,6 @@ tiff_write_tile_grayscale (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [tiles] GRAYSCALE */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int tile_width = img->tile_width;
     int tile_height = img->tile_height;
     int row;
@@ -3569,7 +5039,7 @@ tiff_write_tile_grayscale (const gGraphStripImagePtr img)
 		      *line_ptr++ = *p_in++;	/* expected to be a GRAYSCALE image anyway */
 		  }
 	    }
-	  if (TIFFWriteTile (out, tile, tile_x, tile_y, 0, 0) < 0)
+	  if (!tiff_put_tile (img, tile, tile_x, tile_y))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += num_rows;
@@ -3582,7 +5052,6 @@ tiff_write_strip_grayscale (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [strips] GRAYSCALE */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int row;
     int col;
     unsigned char *scanline = tiff_codec->tiff_buffer;
@@ -3594,7 +5063,7 @@ tiff_write_strip_grayscale (const gGraphStripImagePtr img)
 	  line_ptr = scanline;
 	  for (col = 0; col < img->width; col++)
 	      *line_ptr++ = *p_in++;	/* expected to be a GRAYSCALE image anyway */
-	  if (TIFFWriteScanline (out, scanline, img->next_row + row, 0) < 0)
+	  if (!tiff_put_scanline (img, scanline, img->next_row + row))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += img->current_available_rows;
@@ -3607,7 +5076,6 @@ tiff_write_tile_rgb (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [tiles] RGB */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int tile_width = img->tile_width;
     int tile_height = img->tile_height;
     int row;
@@ -3685,7 +5153,7 @@ tiff_write_tile_rgb (const gGraphStripImagePtr img)
 		      *line_ptr++ = b;
 		  }
 	    }
-	  if (TIFFWriteTile (out, tile, tile_x, tile_y, 0, 0) < 0)
+	  if (!tiff_put_tile (img, tile, tile_x, tile_y))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += num_rows;
@@ -3698,7 +5166,6 @@ tiff_write_strip_rgb (const gGraphStripImagePtr img)
 /* scanline(s) TIFF compression [strips] RGB */
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
-    TIFF *out = tiff_codec->tiff_handle;
     int row;
     int col;
     unsigned char *scanline = tiff_codec->tiff_buffer;
@@ -3750,18 +5217,18 @@ tiff_write_strip_rgb (const gGraphStripImagePtr img)
 		*line_ptr++ = g;
 		*line_ptr++ = b;
 	    }
-	  if (TIFFWriteScanline (out, scanline, img->next_row + row, 0) < 0)
+	  if (!tiff_put_scanline (img, scanline, img->next_row + row))
 	      return GGRAPH_TIFF_CODEC_ERROR;
       }
     img->next_row += img->current_available_rows;
     return GGRAPH_OK;
 }
 
-GGRAPH_PRIVATE int
-gg_image_write_to_tiff_by_strip (const gGraphStripImagePtr img, int *progress)
+static int
+tiff_write_block (const gGraphStripImagePtr img)
 {
-/* scanline(s) TIFF compression [by strip] */
-    int ret;
+/* writing a block of scanline(s) into the current IFD */
+    int ret = GGRAPH_TIFF_CODEC_ERROR;
     struct tiff_codec_data *tiff_codec =
 	(struct tiff_codec_data *) (img->codec_data);
     if (tiff_codec->tiff_type == TIFF_TYPE_RGB)
@@ -3799,9 +5266,561 @@ gg_image_write_to_tiff_by_strip (const gGraphStripImagePtr img, int *progress)
 	  else
 	      ret = tiff_write_strip_grid (img);
       }
+    if (ret == GGRAPH_OK && tiff_codec->is_tiled)
+      {
+	  /* a whole row of tiles has been staged */
+	  if (!tiff_parallel_flush
+	      (tiff_codec->parallel, tiff_codec->tiff_handle, 1))
+	      ret = GGRAPH_TIFF_CODEC_ERROR;
+      }
+    return ret;
+}
+
+static double
+overview_get_grid_value (const unsigned char *p, int sample_format,
+			 int bits_per_sample)
+{
+/* fetching a GRID cell value */
+    switch (sample_format)
+      {
+      case GGRAPH_SAMPLE_INT:
+	  if (bits_per_sample == 8)
+	      return *((signed char *) p);
+	  if (bits_per_sample == 16)
+	      return *((short *) p);
+	  return *((int *) p);
+      case GGRAPH_SAMPLE_UINT:
+	  if (bits_per_sample == 8)
+	      return *p;
+	  if (bits_per_sample == 16)
+	      return *((unsigned short *) p);
+	  return *((unsigned int *) p);
+      case GGRAPH_SAMPLE_FLOAT:
+	  if (bits_per_sample == 32)
+	      return *((float *) p);
+	  return *((double *) p);
+      };
+    return 0.0;
+}
+
+static void
+overview_set_grid_value (unsigned char *p, int sample_format,
+			 int bits_per_sample, double value)
+{
+/* storing a GRID cell value [integers are rounded to nearest] */
+    if (sample_format == GGRAPH_SAMPLE_INT
+	|| sample_format == GGRAPH_SAMPLE_UINT)
+	value = floor (value + 0.5);
+    switch (sample_format)
+      {
+      case GGRAPH_SAMPLE_INT:
+	  if (bits_per_sample == 8)
+	      *((signed char *) p) = (signed char) value;
+	  else if (bits_per_sample == 16)
+	      *((short *) p) = (short) value;
+	  else
+	      *((int *) p) = (int) value;
+	  break;
+      case GGRAPH_SAMPLE_UINT:
+	  if (bits_per_sample == 8)
+	      *p = (unsigned char) value;
+	  else if (bits_per_sample == 16)
+	      *((unsigned short *) p) = (unsigned short) value;
+	  else
+	      *((unsigned int *) p) = (unsigned int) value;
+	  break;
+      case GGRAPH_SAMPLE_FLOAT:
+	  if (bits_per_sample == 32)
+	      *((float *) p) = (float) value;
+	  else
+	      *((double *) p) = value;
+	  break;
+      };
+}
+
+static void
+tiff_overview_reduce (struct tiff_overviews *ovr, int level,
+		      const unsigned char *row0, const unsigned char *row1)
+{
+/*
+/ reducing a pair of rows by a 2x2 factor
+/ row1 is NULL when the input has an odd number of rows
+/
+/ - RGB and GRAYSCALE: averaging each sample [rounded to nearest]
+/ - GRID: averaging each cell, NoData wins if present in the block
+/ - PALETTE and MONOCHROME: nearest (upper-left) pixel
+*/
+    struct tiff_overview *lvl = ovr->levels + level;
+    int unit = ovr->pixel_unit;
+    unsigned char *p_out = lvl->row;
+    int x;
+    int i;
+    int n;
+    for (x = 0; x < lvl->width; x++)
+      {
+	  const unsigned char *p_in[4];
+	  int x2 = x * 2;
+	  n = 0;
+	  p_in[n++] = row0 + (x2 * unit);
+	  if (x2 + 1 < lvl->in_width)
+	      p_in[n++] = row0 + ((x2 + 1) * unit);
+	  if (row1 != NULL)
+	    {
+		p_in[n++] = row1 + (x2 * unit);
+		if (x2 + 1 < lvl->in_width)
+		    p_in[n++] = row1 + ((x2 + 1) * unit);
+	    }
+	  if (ovr->tiff_type == TIFF_TYPE_RGB
+	      || ovr->tiff_type == TIFF_TYPE_GRAYSCALE)
+	    {
+		int sample;
+		for (sample = 0; sample < unit; sample++)
+		  {
+		      unsigned int avg = 0;
+		      for (i = 0; i < n; i++)
+			  avg += *(p_in[i] + sample);
+		      *(p_out + sample) = (unsigned char) ((avg + n / 2) / n);
+		  }
+	    }
+	  else if (ovr->tiff_type == TIFF_TYPE_GRID)
+	    {
+		double avg = 0.0;
+		int is_nodata = 0;
+		for (i = 0; i < n; i++)
+		  {
+		      double value =
+			  overview_get_grid_value (p_in[i], ovr->sample_format,
+						   ovr->bits_per_sample);
+		      if (value == ovr->no_data_value)
+			  is_nodata = 1;
+		      avg += value;
+		  }
+		if (is_nodata)
+		    avg = ovr->no_data_value;
+		else
+		    avg /= (double) n;
+		overview_set_grid_value (p_out, ovr->sample_format,
+					 ovr->bits_per_sample, avg);
+	    }
+	  else
+	      memcpy (p_out, p_in[0], unit);
+	  p_out += unit;
+      }
+}
+
+static int
+tiff_overview_store (struct tiff_overview *lvl)
+{
+/* storing the latest reduced row into the temporary file */
+    if (lvl->rows_out >= lvl->height)
+	return 0;
+    if (fwrite (lvl->row, lvl->scanline_width, 1, lvl->tmp) != 1)
+	return 0;
+    lvl->rows_out += 1;
+    return 1;
+}
+
+static int
+tiff_overview_feed (struct tiff_overviews *ovr, int level,
+		    const unsigned char *row)
+{
+/* feeding a single row into some Overview level */
+    struct tiff_overview *lvl;
+    if (level >= ovr->num_levels)
+	return 1;
+    lvl = ovr->levels + level;
+    if (!lvl->has_pending)
+      {
+	  /* this one is the first row of a pair */
+	  memcpy (lvl->pending, row, lvl->in_scanline_width);
+	  lvl->has_pending = 1;
+	  return 1;
+      }
+    tiff_overview_reduce (ovr, level, lvl->pending, row);
+    lvl->has_pending = 0;
+    if (!tiff_overview_store (lvl))
+	return 0;
+/* the reduced row will then feed the next level */
+    return tiff_overview_feed (ovr, level + 1, lvl->row);
+}
+
+static int
+tiff_overviews_flush (struct tiff_overviews *ovr)
+{
+/* reducing any trailing odd row, level by level */
+    int level;
+    for (level = 0; level < ovr->num_levels; level++)
+      {
+	  struct tiff_overview *lvl = ovr->levels + level;
+	  if (!lvl->has_pending)
+	      continue;
+	  tiff_overview_reduce (ovr, level, lvl->pending, NULL);
+	  lvl->has_pending = 0;
+	  if (!tiff_overview_store (lvl))
+	      return 0;
+	  if (!tiff_overview_feed (ovr, level + 1, lvl->row))
+	      return 0;
+      }
+    for (level = 0; level < ovr->num_levels; level++)
+      {
+	  if (ovr->levels[level].rows_out != ovr->levels[level].height)
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+tiff_write_overviews (const gGraphStripImagePtr img)
+{
+/*
+/ writing the Overviews as further reduced-resolution IFDs
+/ following the main (full resolution) one
+*/
+    struct tiff_codec_data *tiff_codec =
+	(struct tiff_codec_data *) (img->codec_data);
+    struct tiff_overviews *ovr = tiff_codec->overviews;
+    TIFF *out = tiff_codec->tiff_handle;
+    gGraphStripImagePtr lvl_img = NULL;
+    uint16 bits_per_sample;
+    uint16 samples_per_pixel;
+    uint16 photometric;
+    uint16 compression;
+    uint16 sample_format = SAMPLEFORMAT_UINT;
+    uint16 fill_order = FILLORDER_MSB2LSB;
+    uint16 *red;
+    uint16 *green;
+    uint16 *blue;
+    uint16 r_plt[256];
+    uint16 g_plt[256];
+    uint16 b_plt[256];
+    uint32 tile_width = 0;
+    uint32 tile_height = 0;
+    uint32 rows_per_strip = 0;
+    int has_colormap = 0;
+    int level;
+    int i;
+
+    if (!tiff_overviews_flush (ovr))
+	return GGRAPH_TIFF_CODEC_ERROR;
+
+/* saving the main IFD's tags to be replicated */
+    TIFFGetField (out, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+    TIFFGetField (out, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+    TIFFGetField (out, TIFFTAG_PHOTOMETRIC, &photometric);
+    TIFFGetField (out, TIFFTAG_COMPRESSION, &compression);
+    TIFFGetField (out, TIFFTAG_SAMPLEFORMAT, &sample_format);
+    TIFFGetField (out, TIFFTAG_FILLORDER, &fill_order);
+    if (tiff_codec->is_tiled)
+      {
+	  TIFFGetField (out, TIFFTAG_TILEWIDTH, &tile_width);
+	  TIFFGetField (out, TIFFTAG_TILELENGTH, &tile_height);
+      }
+    else
+	TIFFGetField (out, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+    if (photometric == PHOTOMETRIC_PALETTE && bits_per_sample <= 8)
+      {
+	  if (TIFFGetField (out, TIFFTAG_COLORMAP, &red, &green, &blue))
+	    {
+		for (i = 0; i < (1 << bits_per_sample); i++)
+		  {
+		      r_plt[i] = red[i];
+		      g_plt[i] = green[i];
+		      b_plt[i] = blue[i];
+		  }
+		has_colormap = 1;
+	    }
+      }
+    if (!TIFFWriteDirectory (out))
+	return GGRAPH_TIFF_CODEC_ERROR;
+
+    for (level = 0; level < ovr->num_levels; level++)
+      {
+	  struct tiff_overview *lvl = ovr->levels + level;
+	  int block;
+
+	  /* setting up the reduced-resolution IFD */
+	  TIFFSetField (out, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+	  TIFFSetField (out, TIFFTAG_IMAGEWIDTH, lvl->width);
+	  TIFFSetField (out, TIFFTAG_IMAGELENGTH, lvl->height);
+	  TIFFSetField (out, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	  TIFFSetField (out, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+	  TIFFSetField (out, TIFFTAG_SAMPLEFORMAT, sample_format);
+	  TIFFSetField (out, TIFFTAG_SAMPLESPERPIXEL, samples_per_pixel);
+	  TIFFSetField (out, TIFFTAG_BITSPERSAMPLE, bits_per_sample);
+	  TIFFSetField (out, TIFFTAG_PHOTOMETRIC, photometric);
+	  if (tiff_codec->tiff_type == TIFF_TYPE_MONOCHROME)
+	      TIFFSetField (out, TIFFTAG_FILLORDER, fill_order);
+	  if (has_colormap)
+	      TIFFSetField (out, TIFFTAG_COLORMAP, r_plt, g_plt, b_plt);
+	  TIFFSetField (out, TIFFTAG_COMPRESSION, compression);
+	  TIFFSetField (out, TIFFTAG_SOFTWARE, "GaiaGraphics-tools");
+	  if (tiff_codec->is_tiled)
+	    {
+		TIFFSetField (out, TIFFTAG_TILEWIDTH, tile_width);
+		TIFFSetField (out, TIFFTAG_TILELENGTH, tile_height);
+		block = tile_height;
+	    }
+	  else
+	    {
+		TIFFSetField (out, TIFFTAG_ROWSPERSTRIP, rows_per_strip);
+		block = rows_per_strip;
+	    }
+	  if (block < 1)
+	      block = 1;
+	  if (block > lvl->height)
+	      block = lvl->height;
+	  if (tiff_codec->parallel)
+	    {
+		if (!tiff_parallel_setup
+		    (tiff_codec->parallel, out, tiff_codec->is_tiled,
+		     lvl->width, lvl->height))
+		    goto error;
+	    }
+
+	  /* using a transient Strip Image sharing the same TIFF codec */
+	  lvl_img =
+	      gg_strip_image_create (NULL, img->codec_id, img->pixel_format,
+				     lvl->width, lvl->height,
+				     img->bits_per_sample,
+				     img->samples_per_pixel,
+				     img->sample_format, NULL, NULL);
+	  if (!lvl_img)
+	      goto error;
+	  lvl_img->max_palette = img->max_palette;
+	  for (i = 0; i < img->max_palette; i++)
+	    {
+		lvl_img->palette_red[i] = img->palette_red[i];
+		lvl_img->palette_green[i] = img->palette_green[i];
+		lvl_img->palette_blue[i] = img->palette_blue[i];
+	    }
+	  lvl_img->tile_width = tile_width;
+	  lvl_img->tile_height = tile_height;
+	  lvl_img->rows_per_strip = rows_per_strip;
+	  if (gGraphStripImageAllocPixels (lvl_img, block) != GGRAPH_OK)
+	      goto error;
+	  lvl_img->codec_data = tiff_codec;
+
+	  rewind (lvl->tmp);
+	  while (lvl_img->next_row < lvl->height)
+	    {
+		int rows = lvl->height - lvl_img->next_row;
+		if (rows > block)
+		    rows = block;
+		if (fread (lvl_img->pixels, lvl_img->scanline_width, rows,
+			   lvl->tmp) != (size_t) rows)
+		    goto error;
+		lvl_img->current_available_rows = rows;
+		if (tiff_write_block (lvl_img) != GGRAPH_OK)
+		    goto error;
+	    }
+	  lvl_img->codec_data = NULL;
+	  gg_strip_image_destroy (lvl_img);
+	  lvl_img = NULL;
+
+	  /* the last IFD will be written when closing the TIFF */
+	  if (level < ovr->num_levels - 1)
+	    {
+		if (!TIFFWriteDirectory (out))
+		    return GGRAPH_TIFF_CODEC_ERROR;
+	    }
+      }
+    return GGRAPH_OK;
+
+  error:
+    if (lvl_img)
+      {
+	  lvl_img->codec_data = NULL;
+	  gg_strip_image_destroy (lvl_img);
+      }
+    return GGRAPH_TIFF_CODEC_ERROR;
+}
+
+GGRAPH_PRIVATE int
+gg_image_write_to_tiff_by_strip (const gGraphStripImagePtr img, int *progress)
+{
+/* scanline(s) TIFF compression [by strip] */
+    int ret;
+    int row;
+    struct tiff_codec_data *tiff_codec =
+	(struct tiff_codec_data *) (img->codec_data);
+    struct tiff_overviews *ovr = tiff_codec->overviews;
+
+    ret = tiff_write_block (img);
+    if (ret == GGRAPH_OK && ovr != NULL)
+      {
+	  /* feeding the Overviews */
+	  for (row = 0; row < img->current_available_rows; row++)
+	    {
+		if (!tiff_overview_feed
+		    (ovr, 0, img->pixels + (row * img->scanline_width)))
+		  {
+		      ret = GGRAPH_TIFF_CODEC_ERROR;
+		      break;
+		  }
+	    }
+	  if (ret == GGRAPH_OK && img->next_row >= img->height)
+	      ret = tiff_write_overviews (img);
+      }
     if (ret == GGRAPH_OK && progress != NULL)
 	*progress =
 	    (int) (((double) (img->next_row + 1) * 100.0) /
 		   (double) (img->height));
     return ret;
 }
+
+GGRAPH_PRIVATE int
+gg_tiff_set_overviews (const gGraphStripImagePtr img, int num_levels,
+		       double no_data_value)
+{
+/*
+/ enabling the Overviews for a TIFF being written [by strips]
+/ each level halves the previous one, until 1x1 is reached
+/ must be called before writing the first strip
+*/
+    struct tiff_codec_data *tiff_codec;
+    struct tiff_overviews *ovr;
+    int width;
+    int height;
+    int in_scanline_width;
+    int level;
+
+    if (img->codec_id == GGRAPH_IMAGE_TIFF
+	|| img->codec_id == GGRAPH_IMAGE_GEOTIFF)
+	;
+    else
+	return GGRAPH_INVALID_IMAGE;
+    tiff_codec = (struct tiff_codec_data *) (img->codec_data);
+    if (tiff_codec == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (!tiff_codec->is_writer || img->next_row != 0)
+	return GGRAPH_TIFF_CODEC_ERROR;
+    if (num_levels < 0)
+	return GGRAPH_ERROR;
+
+    if (tiff_codec->overviews)
+	tiff_overviews_destroy (tiff_codec->overviews);
+    tiff_codec->overviews = NULL;
+    if (num_levels == 0)
+	return GGRAPH_OK;
+    if (num_levels > GG_TIFF_MAX_OVERVIEWS)
+	num_levels = GG_TIFF_MAX_OVERVIEWS;
+
+    ovr = malloc (sizeof (struct tiff_overviews));
+    if (!ovr)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    ovr->num_levels = 0;
+    ovr->tiff_type = tiff_codec->tiff_type;
+    if (img->pixel_format == GG_PIXEL_GRID)
+	ovr->pixel_unit = img->bits_per_sample / 8;
+    else
+	ovr->pixel_unit = img->pixel_size;
+    ovr->sample_format = img->sample_format;
+    ovr->bits_per_sample = img->bits_per_sample;
+    ovr->no_data_value = no_data_value;
+
+    width = img->width;
+    height = img->height;
+    in_scanline_width = img->scanline_width;
+    for (level = 0; level < num_levels; level++)
+      {
+	  struct tiff_overview *lvl = ovr->levels + level;
+	  if (width <= 1 && height <= 1)
+	      break;
+	  lvl->in_width = width;
+	  lvl->in_scanline_width = in_scanline_width;
+	  width = (width + 1) / 2;
+	  height = (height + 1) / 2;
+	  lvl->width = width;
+	  lvl->height = height;
+	  lvl->scanline_width = width * ovr->pixel_unit;
+	  lvl->rows_out = 0;
+	  lvl->has_pending = 0;
+	  lvl->pending = NULL;
+	  lvl->row = NULL;
+	  lvl->tmp = NULL;
+	  ovr->num_levels += 1;
+	  lvl->pending = malloc (lvl->in_scanline_width);
+	  lvl->row = malloc (lvl->scanline_width);
+	  lvl->tmp = tmpfile ();
+	  if (!(lvl->pending) || !(lvl->row) || !(lvl->tmp))
+	    {
+		tiff_overviews_destroy (ovr);
+		return GGRAPH_INSUFFICIENT_MEMORY;
+	    }
+	  in_scanline_width = lvl->scanline_width;
+      }
+    tiff_codec->overviews = ovr;
+    return GGRAPH_OK;
+}
+
+GGRAPH_PRIVATE int
+gg_tiff_set_threads (const gGraphStripImagePtr img, gGraphThreadPoolPtr pool,
+		     int num_threads)
+{
+/*
+/ enabling multithreaded compression for a TIFF being written [by strips]
+/ LZW or DEFLATE strips (or tiles) will be compressed in parallel,
+/ then written in order as raw data
+/ must be called before writing the first strip
+*/
+    struct tiff_codec_data *tiff_codec;
+    struct tiff_parallel *par;
+
+    if (img->codec_id == GGRAPH_IMAGE_TIFF
+	|| img->codec_id == GGRAPH_IMAGE_GEOTIFF)
+	;
+    else
+	return GGRAPH_INVALID_IMAGE;
+    tiff_codec = (struct tiff_codec_data *) (img->codec_data);
+    if (tiff_codec == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (!tiff_codec->is_writer || img->next_row != 0)
+	return GGRAPH_TIFF_CODEC_ERROR;
+
+    if (tiff_codec->parallel)
+	tiff_parallel_destroy (tiff_codec->parallel);
+    tiff_codec->parallel = NULL;
+    if (pool != NULL)
+	num_threads = gg_thread_pool_size (pool);
+    if (num_threads > GG_MAX_THREADS)
+	num_threads = GG_MAX_THREADS;
+    if (num_threads < 2)
+	return GGRAPH_OK;
+
+    par = malloc (sizeof (struct tiff_parallel));
+    if (!par)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    par->pool = pool;
+    par->own_pool = 0;
+    par->num_threads = num_threads;
+    par->compression = 0;
+    par->height = 0;
+    par->rows_per_strip = 0;
+    par->scanline_size = 0;
+    par->block_size = 0;
+    par->max_blocks = 0;
+    par->num_blocks = 0;
+    par->first_block = 0;
+    par->staging = NULL;
+    par->jobs = NULL;
+    if (pool == NULL)
+      {
+	  /* a private Thread Pool, reused by each block */
+	  par->pool = gg_thread_pool_create (num_threads);
+	  if (par->pool == NULL)
+	    {
+		free (par);
+		return GGRAPH_INSUFFICIENT_MEMORY;
+	    }
+	  par->own_pool = 1;
+      }
+    if (!tiff_parallel_setup
+	(par, tiff_codec->tiff_handle, tiff_codec->is_tiled, img->width,
+	 img->height))
+      {
+	  tiff_parallel_destroy (par);
+	  return GGRAPH_INSUFFICIENT_MEMORY;
+      }
+    tiff_codec->parallel = par;
+    return GGRAPH_OK;
+}
@@ -0,0 +1,626 @@
+/* 
+/ gaiagraphics_uniform.c
+/
+/ uniform images detection and encoded tiles cache
+/
+/ version 1.0, 2026 October 17
+/
+/ Author: Sandro Furieri a.furieri@lqt.it
+/
+/ Copyright (C) 2010  Alessandro Furieri
+/
+/    This program is free software: you can redistribute it and/or modify
+/    it under the terms of the GNU Lesser General Public License as published by
+/    the Free Software Foundation, either version 3 of the License, or
+/    (at your option) any later version.
+/
+/    This program is distributed in the hope that it will be useful,
+/    but WITHOUT ANY WARRANTY; without even the implied warranty of
+/    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+/    GNU Lesser General Public License for more details.
+/
+/    You should have received a copy of the GNU Lesser General Public License
+/    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "gaiagraphics.h"
+#include "gaiagraphics_internals.h"
+
+#define GG_TILE_CACHE_PNG       1
+#define GG_TILE_CACHE_JPEG      2
+
+struct uniform_tile_key
+{
+/* anything affecting the encoded tile: always compared as a whole */
+    int codec;
+    int params[4];
+    int pixel_format;
+    int width;
+    int height;
+    unsigned char pixel[8];
+    unsigned char transparent_red;
+    unsigned char transparent_green;
+    unsigned char transparent_blue;
+    int max_palette;
+    unsigned char palette[768];
+};
+
+struct uniform_tile_entry
+{
+/* a cached encoded tile */
+    struct uniform_tile_key key;
+    unsigned char *buffer;
+    int size;
+    unsigned int last_used;
+};
+
+struct gaia_graphics_tile_cache
+{
+/* a cache of encoded uniform tiles */
+    int signature;
+    int max_entries;
+    int num_entries;
+    unsigned int clock;
+    struct uniform_tile_entry *entries;
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+static int
+image_pixel_bytes (const gGraphImagePtr img)
+{
+/* 
+/ returning the actual size of a pixel
+/ [pixel_size always is 8 for FLOAT grids, even when 32 bits]
+*/
+    return img->scanline_width / img->width;
+}
+
+static int
+uniform_pixels (const gGraphImagePtr img)
+{
+/*
+/ checking if all pixels are identical to the first one
+/ memcmp() is SIMD code in any modern C library, and stops
+/ at the first mismatch
+*/
+    int y;
+    int pixel_bytes = image_pixel_bytes (img);
+    int row_bytes = img->width * pixel_bytes;
+    const unsigned char *row0 = img->pixels;
+/* the first row has to be a sequence of identical pixels */
+    if (memcmp (row0 + pixel_bytes, row0, row_bytes - pixel_bytes) != 0)
+	return 0;
+/* any other row has to be identical to the first one */
+    for (y = 1; y < img->height; y++)
+      {
+	  if (memcmp (img->pixels + (y * img->scanline_width), row0, row_bytes)
+	      != 0)
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+alpha_offset (int pixel_format)
+{
+/* returning the offset of the Alpha byte [-1 if there is no Alpha] */
+    switch (pixel_format)
+      {
+      case GG_PIXEL_RGBA:
+      case GG_PIXEL_BGRA:
+	  return 3;
+      case GG_PIXEL_ARGB:
+	  return 0;
+      };
+    return -1;
+}
+
+static int
+fully_transparent (const gGraphImagePtr img, int alpha)
+{
+/* checking if all pixels have a zero Alpha */
+    int x;
+    int y;
+    unsigned char any;
+    const unsigned char *p_in;
+    for (y = 0; y < img->height; y++)
+      {
+	  /* no early exit within a row, so to allow vectorization */
+	  any = 0;
+	  p_in = img->pixels + (y * img->scanline_width) + alpha;
+	  for (x = 0; x < img->width; x++)
+	      any |= p_in[x * 4];
+	  if (any)
+	      return 0;
+      }
+    return 1;
+}
+
+static int
+grid_no_data (const gGraphImagePtr img)
+{
+/* checking if the first GRID cell is NoData */
+    double value;
+    switch (img->sample_format)
+      {
+      case GGRAPH_SAMPLE_INT:
+	  if (img->bits_per_sample == 8)
+	      value = *((signed char *) (img->pixels));
+	  else if (img->bits_per_sample == 16)
+	      value = *((short *) (img->pixels));
+	  else
+	      value = *((int *) (img->pixels));
+	  break;
+      case GGRAPH_SAMPLE_UINT:
+	  if (img->bits_per_sample == 8)
+	      value = *(img->pixels);
+	  else if (img->bits_per_sample == 16)
+	      value = *((unsigned short *) (img->pixels));
+	  else
+	      value = *((unsigned int *) (img->pixels));
+	  break;
+      case GGRAPH_SAMPLE_FLOAT:
+	  if (img->bits_per_sample == 32)
+	      value = *((float *) (img->pixels));
+	  else
+	      value = *((double *) (img->pixels));
+	  break;
+      default:
+	  return 0;
+      };
+    return value == img->no_data_value;
+}
+
+static void
+uniform_scan (const gGraphImagePtr img, int *is_uniform, int *is_transparent)
+{
+/* scanning the image for uniformity and/or full transparency */
+    int alpha = alpha_offset (img->pixel_format);
+    *is_uniform = uniform_pixels (img);
+    *is_transparent = 0;
+    if (alpha >= 0)
+      {
+	  if (img->pixels[alpha] == 0)
+	    {
+		if (*is_uniform)
+		    *is_transparent = 1;
+		else
+		    *is_transparent = fully_transparent (img, alpha);
+	    }
+      }
+    else if (img->pixel_format == GG_PIXEL_GRID && *is_uniform)
+	*is_transparent = grid_no_data (img);
+}
+
+static void
+first_pixel_color (const gGraphImagePtr img, unsigned char *red,
+		   unsigned char *green, unsigned char *blue,
+		   unsigned char *alpha)
+{
+/* returning the color of the first pixel */
+    const unsigned char *p = img->pixels;
+    *red = 0;
+    *green = 0;
+    *blue = 0;
+    *alpha = 255;
+    switch (img->pixel_format)
+      {
+      case GG_PIXEL_RGB:
+	  *red = p[0];
+	  *green = p[1];
+	  *blue = p[2];
+	  break;
+      case GG_PIXEL_RGBA:
+	  *red = p[0];
+	  *green = p[1];
+	  *blue = p[2];
+	  *alpha = p[3];
+	  break;
+      case GG_PIXEL_ARGB:
+	  *alpha = p[0];
+	  *red = p[1];
+	  *green = p[2];
+	  *blue = p[3];
+	  break;
+      case GG_PIXEL_BGR:
+	  *blue = p[0];
+	  *green = p[1];
+	  *red = p[2];
+	  break;
+      case GG_PIXEL_BGRA:
+	  *blue = p[0];
+	  *green = p[1];
+	  *red = p[2];
+	  *alpha = p[3];
+	  break;
+      case GG_PIXEL_GRAYSCALE:
+	  *red = p[0];
+	  *green = p[0];
+	  *blue = p[0];
+	  break;
+      case GG_PIXEL_PALETTE:
+	  *red = img->palette_red[p[0]];
+	  *green = img->palette_green[p[0]];
+	  *blue = img->palette_blue[p[0]];
+	  break;
+      };
+}
+
+GGRAPH_DECLARE int
+gGraphImageIsUniform (const void *ptr, int *is_uniform, int *is_transparent,
+		      unsigned char *red, unsigned char *green,
+		      unsigned char *blue, unsigned char *alpha)
+{
+/*
+/ checking if an image is uniform [all pixels of the same color]
+/ and/or fully transparent [all Alphas are zero; for GRID images:
+/ all cells are NoData]
+/ the returned color always is the one of the first pixel
+*/
+    gGraphImagePtr img = (gGraphImagePtr) ptr;
+
+    *is_uniform = 0;
+    *is_transparent = 0;
+    if (img == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    if (img->width <= 0 || img->height <= 0)
+	return GGRAPH_INVALID_IMAGE;
+
+    uniform_scan (img, is_uniform, is_transparent);
+    first_pixel_color (img, red, green, blue, alpha);
+    return GGRAPH_OK;
+}
+
+static void
+tile_cache_lock (gGraphTileCachePtr cache)
+{
+#ifdef _WIN32
+    EnterCriticalSection (&(cache->lock));
+#else
+    pthread_mutex_lock (&(cache->lock));
+#endif
+}
+
+static void
+tile_cache_unlock (gGraphTileCachePtr cache)
+{
+#ifdef _WIN32
+    LeaveCriticalSection (&(cache->lock));
+#else
+    pthread_mutex_unlock (&(cache->lock));
+#endif
+}
+
+static int
+tile_cache_key (const gGraphImagePtr img, int codec, int param1, int param2,
+		int param3, int param4, struct uniform_tile_key *key)
+{
+/*
+/ building the Tile Cache key for an image
+/ returns 0 if the image isn't uniform, and thus can't be cached
+/ for PNG any fully transparent image [all Alphas are zero] shares
+/ the same key whatever its hidden colors are: 2 is then returned,
+/ and an all-zero tile has to be encoded in place of the image
+*/
+    int is_uniform;
+    int is_transparent;
+    int canonical;
+    int i;
+    if (img->width <= 0 || img->height <= 0)
+	return 0;
+    uniform_scan (img, &is_uniform, &is_transparent);
+    canonical = codec == GG_TILE_CACHE_PNG && is_transparent
+	&& alpha_offset (img->pixel_format) >= 0;
+    if (!is_uniform && !canonical)
+	return 0;
+    memset (key, 0, sizeof (struct uniform_tile_key));
+    key->codec = codec;
+    key->params[0] = param1;
+    key->params[1] = param2;
+    key->params[2] = param3;
+    key->params[3] = param4;
+    key->pixel_format = img->pixel_format;
+    key->width = img->width;
+    key->height = img->height;
+    if (!canonical)
+	memcpy (key->pixel, img->pixels, image_pixel_bytes (img));
+    key->transparent_red = img->transparent_red;
+    key->transparent_green = img->transparent_green;
+    key->transparent_blue = img->transparent_blue;
+    if (img->pixel_format == GG_PIXEL_PALETTE)
+      {
+	  /* the whole palette is encoded */
+	  key->max_palette = img->max_palette;
+	  for (i = 0; i < img->max_palette; i++)
+	    {
+		key->palette[i * 3] = img->palette_red[i];
+		key->palette[(i * 3) + 1] = img->palette_green[i];
+		key->palette[(i * 3) + 2] = img->palette_blue[i];
+	    }
+      }
+    return canonical ? 2 : 1;
+}
+
+static int
+transparent_tile_to_png (const gGraphImagePtr img, void **mem_buf,
+			 int *mem_buf_size, int compression_level,
+			 int quantization_factor, int interlaced,
+			 int is_transparent)
+{
+/*
+/ exporting a fully transparent image as an all-zero tile
+/ [a shallow copy of the image is encoded, so to leave it untouched]
+*/
+    gGraphImage canonical;
+    int ret;
+    memcpy (&canonical, img, sizeof (gGraphImage));
+    canonical.palette_cache = NULL;
+    canonical.pixels = calloc (img->height, img->scanline_width);
+    if (!canonical.pixels)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    ret =
+	gGraphImageToPngMemBuf (&canonical, mem_buf, mem_buf_size,
+				compression_level, quantization_factor,
+				interlaced, is_transparent);
+    free (canonical.pixels);
+    return ret;
+}
+
+static struct uniform_tile_entry *
+tile_cache_find (gGraphTileCachePtr cache, const struct uniform_tile_key *key)
+{
+/*
+/ searching a Tile Cache entry
+/ must be called while holding the Tile Cache lock
+*/
+    int i;
+    for (i = 0; i < cache->num_entries; i++)
+      {
+	  struct uniform_tile_entry *entry = cache->entries + i;
+	  if (memcmp (&(entry->key), key, sizeof (struct uniform_tile_key)) ==
+	      0)
+	      return entry;
+      }
+    return NULL;
+}
+
+static int
+tile_cache_fetch (gGraphTileCachePtr cache, const struct uniform_tile_key *key,
+		  void **mem_buf, int *mem_buf_size)
+{
+/* returning a copy of some cached encoded tile [if any] */
+    struct uniform_tile_entry *entry;
+    unsigned char *buf = NULL;
+    int size = 0;
+    tile_cache_lock (cache);
+    entry = tile_cache_find (cache, key);
+    if (entry)
+      {
+	  buf = malloc (entry->size);
+	  if (buf)
+	    {
+		memcpy (buf, entry->buffer, entry->size);
+		size = entry->size;
+		cache->clock += 1;
+		entry->last_used = cache->clock;
+	    }
+      }
+    tile_cache_unlock (cache);
+    if (!buf)
+	return 0;
+    *mem_buf = buf;
+    *mem_buf_size = size;
+    return 1;
+}
+
+static void
+tile_cache_store (gGraphTileCachePtr cache, const struct uniform_tile_key *key,
+		  const void *mem_buf, int mem_buf_size)
+{
+/*
+/ storing a copy of some encoded tile into the Tile Cache
+/ the least recently used entry is replaced when the cache is full
+*/
+    int i;
+    struct uniform_tile_entry *entry;
+    unsigned char *buf = malloc (mem_buf_size);
+    if (!buf)
+	return;
+    memcpy (buf, mem_buf, mem_buf_size);
+    tile_cache_lock (cache);
+    if (tile_cache_find (cache, key) != NULL)
+      {
+	  /* already stored by some other thread */
+	  tile_cache_unlock (cache);
+	  free (buf);
+	  return;
+      }
+    if (cache->num_entries < cache->max_entries)
+      {
+	  entry = cache->entries + cache->num_entries;
+	  cache->num_entries += 1;
+      }
+    else
+      {
+	  entry = cache->entries;
+	  for (i = 1; i < cache->num_entries; i++)
+	    {
+		if (cache->entries[i].last_used < entry->last_used)
+		    entry = cache->entries + i;
+	    }
+	  free (entry->buffer);
+      }
+    memcpy (&(entry->key), key, sizeof (struct uniform_tile_key));
+    entry->buffer = buf;
+    entry->size = mem_buf_size;
+    cache->clock += 1;
+    entry->last_used = cache->clock;
+    tile_cache_unlock (cache);
+}
+
+GGRAPH_PRIVATE int
+gg_is_valid_tile_cache (const void *ptr)
+{
+/* checking for a valid Tile Cache object */
+    gGraphTileCachePtr cache = (gGraphTileCachePtr) ptr;
+    if (cache == NULL)
+	return 0;
+    if (cache->signature != GG_TILE_CACHE_MAGIC_SIGNATURE)
+	return 0;
+    return 1;
+}
+
+GGRAPH_DECLARE int
+gGraphCreateTileCache (int max_entries, const void **tile_cache)
+{
+/* creating a Tile Cache object */
+    gGraphTileCachePtr cache;
+
+    *tile_cache = NULL;
+    if (max_entries < 1)
+	return GGRAPH_ERROR;
+    cache = malloc (sizeof (gGraphTileCache));
+    if (!cache)
+	return GGRAPH_INSUFFICIENT_MEMORY;
+    cache->entries = malloc (sizeof (struct uniform_tile_entry) * max_entries);
+    if (!cache->entries)
+      {
+	  free (cache);
+	  return GGRAPH_INSUFFICIENT_MEMORY;
+      }
+    cache->signature = GG_TILE_CACHE_MAGIC_SIGNATURE;
+    cache->max_entries = max_entries;
+    cache->num_entries = 0;
+    cache->clock = 0;
+#ifdef _WIN32
+    InitializeCriticalSection (&(cache->lock));
+#else
+    pthread_mutex_init (&(cache->lock), NULL);
+#endif
+    *tile_cache = cache;
+    return GGRAPH_OK;
+}
+
+GGRAPH_DECLARE void
+gGraphDestroyTileCache (const void *tile_cache)
+{
+/* destroying a Tile Cache object */
+    int i;
+    gGraphTileCachePtr cache = (gGraphTileCachePtr) tile_cache;
+
+    if (!gg_is_valid_tile_cache (cache))
+	return;
+    for (i = 0; i < cache->num_entries; i++)
+	free (cache->entries[i].buffer);
+    free (cache->entries);
+#ifdef _WIN32
+    DeleteCriticalSection (&(cache->lock));
+#else
+    pthread_mutex_destroy (&(cache->lock));
+#endif
+    free (cache);
+}
+
+GGRAPH_DECLARE int
+gGraphImageToPngMemBufCached (const void *ptr, void **mem_buf,
+			      int *mem_buf_size, int compression_level,
+			      int quantization_factor, int interlaced,
+			      int is_transparent, const void *tile_cache)
+{
+/*
+/ exporting an image into a PNG compressed memory buffer
+/ uniform and fully transparent images are served by the Tile Cache
+*/
+    gGraphImagePtr img = (gGraphImagePtr) ptr;
+    gGraphTileCachePtr cache = (gGraphTileCachePtr) tile_cache;
+    struct uniform_tile_key key;
+    int cacheable = 0;
+    int ret;
+
+    *mem_buf = NULL;
+    *mem_buf_size = 0;
+    if (img == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    if (cache != NULL && !gg_is_valid_tile_cache (cache))
+	return GGRAPH_INVALID_TILE_CACHE;
+
+    if (cache != NULL)
+	cacheable =
+	    tile_cache_key (img, GG_TILE_CACHE_PNG, compression_level,
+			    quantization_factor, interlaced, is_transparent,
+			    &key);
+    if (!cacheable)
+	return gGraphImageToPngMemBuf (img, mem_buf, mem_buf_size,
+				       compression_level, quantization_factor,
+				       interlaced, is_transparent);
+    if (tile_cache_fetch (cache, &key, mem_buf, mem_buf_size))
+	return GGRAPH_OK;
+    if (cacheable == 2)
+	ret =
+	    transparent_tile_to_png (img, mem_buf, mem_buf_size,
+				     compression_level, quantization_factor,
+				     interlaced, is_transparent);
+    else
+	ret =
+	    gGraphImageToPngMemBuf (img, mem_buf, mem_buf_size,
+				    compression_level, quantization_factor,
+				    interlaced, is_transparent);
+    if (ret == GGRAPH_OK)
+	tile_cache_store (cache, &key, *mem_buf, *mem_buf_size);
+    return ret;
+}
+
+GGRAPH_DECLARE int
+gGraphImageToJpegMemBufCached (const void *ptr, void **mem_buf,
+			       int *mem_buf_size, int jpeg_quality,
+			       const void *tile_cache)
+{
+/*
+/ exporting an image into a JPEG compressed memory buffer
+/ uniform images are served by the Tile Cache
+*/
+    gGraphImagePtr img = (gGraphImagePtr) ptr;
+    gGraphTileCachePtr cache = (gGraphTileCachePtr) tile_cache;
+    struct uniform_tile_key key;
+    int ret;
+
+    *mem_buf = NULL;
+    *mem_buf_size = 0;
+    if (img == NULL)
+	return GGRAPH_INVALID_IMAGE;
+    if (img->signature != GG_IMAGE_MAGIC_SIGNATURE)
+	return GGRAPH_INVALID_IMAGE;
+    if (cache != NULL && !gg_is_valid_tile_cache (cache))
+	return GGRAPH_INVALID_TILE_CACHE;
+
+    if (cache == NULL
+	|| !tile_cache_key (img, GG_TILE_CACHE_JPEG, jpeg_quality, 0, 0, 0,
+			    &key))
+	return gGraphImageToJpegMemBuf (img, mem_buf, mem_buf_size,
+					jpeg_quality);
+    if (tile_cache_fetch (cache, &key, mem_buf, mem_buf_size))
+	return GGRAPH_OK;
+    ret = gGraphImageToJpegMemBuf (img, mem_buf, mem_buf_size, jpeg_quality);
+    if (ret == GGRAPH_OK)
+	tile_cache_store (cache, &key, *mem_buf, *mem_buf_size);
+    return ret;
+}